@@ -5,9 +5,16 @@
 
 #include <unordered_map>
 #include <memory>
+#include <algorithm>
+#include <limits>
+#include <atomic>
 
 #include "group/GroupId.h"
 #include "aggro/AggroMgr.h"
+#include "perception/PerceptionMemory.h"
+#include "world/IWorldQuery.h"
+#include "path/Path.h"
+#include "movement/Neighbours.h"
 #include "ICharacter.h"
 #include "tree/TreeNode.h"
 #include "tree/loaders/ITreeLoader.h"
@@ -15,19 +22,18 @@
 #include "common/Types.h"
 #include "common/NonCopyable.h"
 #include "common/Math.h"
+#include "zone/WakeQueue.h"
 
 namespace ai {
 
 class ICharacter;
 typedef std::shared_ptr<ICharacter> ICharacterPtr;
 class Zone;
+class TreeProgram;
+typedef std::shared_ptr<TreeProgram> TreeProgramPtr;
 
 typedef std::vector<CharacterId> FilteredEntities;
 
-#ifndef AI_NOTHING_SELECTED
-#define AI_NOTHING_SELECTED (-1)
-#endif
-
 /**
  * @brief This is the type the library works with. It interacts with it's real world entity by
  * the @ai{ICharacter} interface.
@@ -44,17 +50,30 @@ class AI : public NonCopyable, public std::enable_shared_from_this<AI> {
 	friend class IFilter;
 	friend class Filter;
 	friend class Server;
+	friend class Zone;
+	friend class TreeProgram;
 protected:
 	/**
-	 * This map is only filled if we are in debugging mode for this entity
+	 * @brief One entry per node of the behaviour tree - indexed by @c TreeNode::getIndex(), so the
+	 * state of a node is found without hashing and the states of a tree are next to each other.
+	 */
+	typedef std::vector<TreeNodeState> NodeStates;
+	NodeStates _nodeStates;
+	/**
+	 * @brief The numbering of the behaviour the states in @c _nodeStates belong to - see @c TreeNode::index()
 	 */
-	typedef std::unordered_map<int, TreeNodeStatus> NodeStates;
-	NodeStates _lastStatus;
+	TreeIndexPtr _treeIndex;
+	/**
+	 * @brief The states of the nodes without an index in the numbering of the behaviour - e.g. the nodes of
+	 * a subtree that is shared with another behaviour. The key is the node id.
+	 */
+	std::unordered_map<int, TreeNodeState> _foreignNodeStates;
+
+	TreeNodeState& getNodeState(int index);
 	/**
-	 * This map is only filled if we are in debugging mode for this entity
+	 * @return @c nullptr if the node has no state for this entity yet
 	 */
-	typedef std::unordered_map<int, uint64_t> LastExecMap;
-	LastExecMap _lastExecMillis;
+	const TreeNodeState* findNodeState(int index) const;
 
 	/**
 	 * @note The filtered entities are kept even over several ticks. The caller should decide
@@ -67,21 +86,23 @@ protected:
 
 	void addFilteredEntity(CharacterId id);
 
+	TreeNodePtr _behaviour;
+	TreeProgramPtr _program;
 	/**
-	 * Often @ai{Selector} states must be stored to continue in the next step at a particular
-	 * position in the behaviour tree. This map is doing exactly this.
+	 * @brief The instructions of the @c TreeProgram from the root down to the running node and the position
+	 * of the child that was selected in each of them (@c -1 for the running node) - see @c TreeProgram::compile()
 	 */
-	typedef std::unordered_map<int, int> SelectorStates;
-	SelectorStates _selectorStates;
-
+	std::vector<std::pair<int, int> > _runningPath;
 	/**
-	 * This map stores the amount of execution for the @ai{Limit} node. The key is the node id
+	 * @brief The wake ups when the running path was recorded - every event that wakes the entity
+	 * invalidates the path
 	 */
-	typedef std::unordered_map<int, int> LimitStates;
-	LimitStates _limitStates;
-
-	TreeNodePtr _behaviour;
+	uint32_t _runningPathWakeups;
 	AggroMgr _aggroMgr;
+	PerceptionMemory _perception;
+	WorldQueryResults _worldResults;
+	PathFollower _pathFollower;
+	Neighbours _neighbours;
 
 	ICharacterPtr _character;
 
@@ -90,6 +111,41 @@ protected:
 
 	int64_t _time;
 
+	/**
+	 * @brief The @c Zone only updates this entity every n-th tick
+	 * @sa setUpdateInterval()
+	 */
+	int _updateInterval;
+	/**
+	 * @brief The zone time in millis of the last update of this entity. The zone hands over the time
+	 * since then - so ticks that were skipped (update interval or time budget) are not lost.
+	 */
+	int64_t _lastZoneUpdate;
+
+	/**
+	 * @brief Set by sleep() - the zone picks the request up after the tick of this entity
+	 */
+	bool _sleepRequested;
+	int64_t _sleepMillis;
+	std::atomic_bool _sleeping;
+	/**
+	 * @brief Incremented with every wake() call - a sleep request is dropped if the entity was woken
+	 * up in the meantime
+	 */
+	std::atomic<uint32_t> _wakeups;
+	/**
+	 * @brief Identifies the current sleep - timers of older sleeps are ignored
+	 */
+	uint32_t _sleepGeneration;
+	/**
+	 * @brief The position in the list of the zone's active (not sleeping) entities
+	 */
+	std::size_t _activeSlot;
+	/**
+	 * @brief Set as long as the entity is part of a zone
+	 */
+	std::atomic<WakeQueue*> _wakeQueue;
+
 	Zone* _zone;
 
 	std::atomic_bool _reset;
@@ -98,7 +154,16 @@ public:
 	 * @param behaviour The behaviour tree node that is applied to this ai entity
 	 */
 	explicit AI(const TreeNodePtr& behaviour) :
-			_behaviour(behaviour), _pause(false), _debuggingActive(false), _time(0L), _zone(nullptr), _reset(false) {
+			_behaviour(behaviour), _runningPathWakeups(0u), _pause(false), _debuggingActive(false), _time(0L), _updateInterval(1), _lastZoneUpdate(0L),
+			_sleepRequested(false), _sleepMillis(0L), _sleeping(false), _wakeups(0u), _sleepGeneration(0u),
+			_activeSlot(std::numeric_limits<std::size_t>::max()), _wakeQueue(nullptr), _zone(nullptr), _reset(false) {
+		_aggroMgr.setAddAggroListener([this] () {
+			wake();
+		});
+		if (_behaviour) {
+			_nodeStates.resize(TreeNode::index(*_behaviour));
+			_treeIndex = _behaviour->_treeIndex;
+		}
 	}
 	virtual ~AI() {
 	}
@@ -136,6 +201,39 @@ public:
 	 */
 	bool isPause() const;
 
+	/**
+	 * @brief Level of detail for the @c Zone::update: the entity is only updated every @c interval ticks
+	 * of its zone, e.g. @c 4 for entities that are far away from any player and @c 16 for those that
+	 * are even further away. The delta time of the skipped ticks is added to the next update, so the
+	 * aggro reduction and the timers of the behaviour tree stay correct.
+	 * @param interval @c 1 (the default) updates the entity in every tick
+	 * @sa Zone::setUpdateIntervalFunc()
+	 */
+	void setUpdateInterval(int interval);
+	int getUpdateInterval() const;
+
+	/**
+	 * @brief Stop the updates of this entity until the given time passed or until it is woken up.
+	 *
+	 * A sleeping entity costs nothing in @c Zone::update. It is woken up by aggro that is added to its
+	 * @c AggroMgr, by changes of the groups it is in, or by calling wake() (or @c Zone::wake()). The
+	 * time that passed while sleeping is handed over as delta time in the next update.
+	 *
+	 * @param millis The zone time to sleep - a negative value sleeps until the entity is woken up
+	 * @note Call this from within the tick of this entity (e.g. from a @c TreeNode) - the sleep starts
+	 * after the current tick.
+	 * @sa @ai{Sleep}
+	 */
+	void sleep(int64_t millis = -1);
+
+	/**
+	 * @brief Puts a sleeping entity back into the updates of its zone. Can be called from any thread.
+	 * @sa sleep()
+	 */
+	void wake();
+
+	bool isSleeping() const;
+
 	/**
 	 * @return @c true if the owning entity is currently under debugging, @c false otherwise
 	 */
@@ -150,6 +248,13 @@ public:
 	 * @return the old one if there was any
 	 */
 	TreeNodePtr setBehaviour(const TreeNodePtr& newBehaviour);
+	/**
+	 * @brief Executes the behaviour via the given compiled version of it (see @c TreeProgram::compile()) - one
+	 * program can be shared by all entities with the same behaviour.
+	 * @note The program is dropped if a new behaviour is set
+	 */
+	void setProgram(const TreeProgramPtr& program);
+	const TreeProgramPtr& getProgram() const;
 	/**
 	 * @return The real world entity reference
 	 */
@@ -177,6 +282,29 @@ public:
 	 */
 	const AggroMgr& getAggroMgr() const;
 
+	/**
+	 * @return The stimuli this entity perceived recently - see @c Zone::emitStimulus()
+	 */
+	PerceptionMemory& getPerception();
+	const PerceptionMemory& getPerception() const;
+
+	/**
+	 * @return The results of the world queries of this entity that were answered after the last update
+	 * - see @c Zone::submitWorldQuery()
+	 */
+	const WorldQueryResults& getWorldResults() const;
+
+	/**
+	 * @return The path this entity follows - see @c MoveTo and @c FollowPath
+	 */
+	PathFollower& getPathFollower();
+	const PathFollower& getPathFollower() const;
+
+	/**
+	 * @return The entities around this one that were gathered in the current update - see @c Zone::getNeighbours()
+	 */
+	const Neighbours& getNeighbours() const;
+
 	/**
 	 * @brief @c FilteredEntities is holding a list of @c CharacterIds that were selected by the @c Select condition.
 	 * @sa @c IFilter interface.
@@ -203,11 +331,24 @@ inline TreeNodePtr AI::getBehaviour() const {
 
 inline TreeNodePtr AI::setBehaviour(const TreeNodePtr& newBehaviour) {
 	TreeNodePtr current = _behaviour;
+	if (newBehaviour) {
+		TreeNode::index(*newBehaviour);
+	}
 	_behaviour = newBehaviour;
+	_program = TreeProgramPtr();
 	_reset = true;
 	return current;
 }
 
+inline void AI::setProgram(const TreeProgramPtr& program) {
+	_program = program;
+	_runningPath.clear();
+}
+
+inline const TreeProgramPtr& AI::getProgram() const {
+	return _program;
+}
+
 inline void AI::setPause(bool pause) {
 	_pause = pause;
 }
@@ -233,6 +374,45 @@ inline const AggroMgr& AI::getAggroMgr() const {
 	return _aggroMgr;
 }
 
+inline PerceptionMemory& AI::getPerception() {
+	return _perception;
+}
+
+inline const PerceptionMemory& AI::getPerception() const {
+	return _perception;
+}
+
+inline const WorldQueryResults& AI::getWorldResults() const {
+	return _worldResults;
+}
+
+inline PathFollower& AI::getPathFollower() {
+	return _pathFollower;
+}
+
+inline const PathFollower& AI::getPathFollower() const {
+	return _pathFollower;
+}
+
+inline TreeNodeState& AI::getNodeState(int index) {
+	if (static_cast<std::size_t>(index) >= _nodeStates.size()) {
+		// nodes that were added after the entity got the tree
+		_nodeStates.resize(index + 1);
+	}
+	return _nodeStates[index];
+}
+
+inline const TreeNodeState* AI::findNodeState(int index) const {
+	if (index < 0 || static_cast<std::size_t>(index) >= _nodeStates.size()) {
+		return nullptr;
+	}
+	return &_nodeStates[index];
+}
+
+inline const Neighbours& AI::getNeighbours() const {
+	return _neighbours;
+}
+
 inline const FilteredEntities& AI::getFilteredEntities() const {
 	return _filteredEntities;
 }
@@ -245,6 +425,34 @@ inline void AI::addFilteredEntity(CharacterId id) {
 	_filteredEntities.push_back(id);
 }
 
+inline void AI::setUpdateInterval(int interval) {
+	_updateInterval = std::max(1, interval);
+}
+
+inline int AI::getUpdateInterval() const {
+	return _updateInterval;
+}
+
+inline void AI::sleep(int64_t millis) {
+	_sleepRequested = true;
+	_sleepMillis = millis;
+}
+
+inline void AI::wake() {
+	++_wakeups;
+	if (!_sleeping) {
+		return;
+	}
+	WakeQueue* queue = _wakeQueue;
+	if (queue != nullptr) {
+		queue->push(shared_from_this());
+	}
+}
+
+inline bool AI::isSleeping() const {
+	return _sleeping;
+}
+
 inline bool AI::isDebuggingActive() const {
 	return _debuggingActive;
 }
@@ -284,15 +492,20 @@ inline void AI::update(int64_t dt, bool debuggingActive) {
 	if (_reset) {
 		// safe to do it like this, because update is not called from multiple threads
 		_reset = false;
-		_lastStatus.clear();
-		_lastExecMillis.clear();
+		_nodeStates.assign(_behaviour ? TreeNode::index(*_behaviour) : 0, TreeNodeState());
+		_treeIndex = _behaviour ? _behaviour->_treeIndex : TreeIndexPtr();
+		_foreignNodeStates.clear();
 		_filteredEntities.clear();
-		_selectorStates.clear();
+		_pathFollower.clear();
+		_runningPath.clear();
 	}
 
 	_debuggingActive = debuggingActive;
 	_time += dt;
 	_aggroMgr.update(dt);
+	_perception.update(_time);
+	_worldResults.update();
+	_neighbours.clear();
 }
 
 typedef std::shared_ptr<AI> AIPtr;
@@ -12,6 +12,8 @@
 #include "tree/Limit.h"
 #include "tree/Invert.h"
 #include "tree/Idle.h"
+#include "tree/MoveTo.h"
+#include "tree/Sleep.h"
 #include "tree/Parallel.h"
 #include "tree/PrioritySelector.h"
 #include "tree/ProbabilitySelector.h"
@@ -22,6 +24,9 @@
 #include "conditions/And.h"
 #include "conditions/False.h"
 #include "conditions/HasEnemies.h"
+#include "conditions/HasInfluence.h"
+#include "conditions/HasLineOfSight.h"
+#include "conditions/HasStimulus.h"
 #include "conditions/Not.h"
 #include "conditions/Filter.h"
 #include "conditions/Or.h"
@@ -35,6 +40,9 @@
 #include "filter/SelectGroupLeader.h"
 #include "filter/SelectGroupMembers.h"
 #include "filter/SelectZone.h"
+#include "filter/SelectInRadius.h"
+#include "filter/SelectNearest.h"
+#include "filter/SelectStimulus.h"
 #include "filter/Union.h"
 #include "filter/Intersection.h"
 #include "filter/Last.h"
@@ -45,8 +53,15 @@
 #include "filter/SelectAll.h"
 #include "movement/SelectionSeek.h"
 #include "movement/SelectionFlee.h"
+#include "movement/Alignment.h"
+#include "movement/Cohesion.h"
+#include "movement/FlowFieldSeek.h"
+#include "movement/FollowPath.h"
 #include "movement/GroupFlee.h"
 #include "movement/GroupSeek.h"
+#include "movement/InfluenceFlee.h"
+#include "movement/InfluenceSeek.h"
+#include "movement/Separation.h"
 #include "movement/Steering.h"
 #include "movement/TargetFlee.h"
 #include "movement/TargetSeek.h"
@@ -76,6 +91,8 @@ protected:
 			R_GET(RandomSelector);
 			R_GET(Sequence);
 			R_GET(Idle);
+			R_GET(MoveTo);
+			R_GET(Sleep);
 		}
 	};
 
@@ -96,6 +113,13 @@ protected:
 			R_MOVE(Wander);
 			R_MOVE(GroupSeek);
 			R_MOVE(GroupFlee);
+			R_MOVE(InfluenceSeek);
+			R_MOVE(InfluenceFlee);
+			R_MOVE(FollowPath);
+			R_MOVE(FlowFieldSeek);
+			R_MOVE(Separation);
+			R_MOVE(Alignment);
+			R_MOVE(Cohesion);
 			R_MOVE(TargetSeek);
 			R_MOVE(TargetFlee);
 			R_MOVE(SelectionSeek);
@@ -113,6 +137,9 @@ protected:
 			R_GET(SelectGroupMembers);
 			R_GET(SelectHighestAggro);
 			R_GET(SelectZone);
+			R_GET(SelectInRadius);
+			R_GET(SelectNearest);
+			R_GET(SelectStimulus);
 			R_GET(Union);
 			R_GET(Intersection);
 			R_GET(Last);
@@ -132,6 +159,9 @@ protected:
 			R_GET(And);
 			R_GET(False);
 			R_GET(HasEnemies);
+			R_GET(HasInfluence);
+			R_GET(HasLineOfSight);
+			R_GET(HasStimulus);
 			R_GET(Not);
 			R_GET(Or);
 			R_GET(True);
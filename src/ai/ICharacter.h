@@ -37,6 +37,11 @@ const char* const ORIENTATION = "Orientation";
  * method or from within the @ai{Zone} callbacks. Otherwise you will run into race conditions
  * if you run with multiple threads.
  *
+ * The position, orientation and speed can be double buffered (see @ai{Zone::setDoubleBuffering()}).
+ * The getters then return the values of the last tick, while the setters only change the pending
+ * values (see e.g. @c getNextPosition()). The zone commits them after the tick - so other entities can read
+ * the values of this character while it is updated in parallel.
+ *
  * You often need access to your world your character is living in. You need access to this
  * data to resolve the @ai{CharacterId}'s in the @ai{IFilter} implementations, to interact with
  * other entities that are not SimpleAI controlled and so on. You can use the provided
@@ -51,9 +56,32 @@ protected:
 	std::atomic<float> _speed;
 	CharacterAttributes _attributes;
 
+	/**
+	 * @brief The values that are written while the character is double buffered
+	 *
+	 * Only the thread that updates the character writes them, and only the zone thread reads them in
+	 * @c commitState() - after the parallel update of the tick finished and before the next one is
+	 * scheduled. The thread pool hand over (task queue and latch) orders these accesses, so the back
+	 * buffer itself needs no synchronization.
+	 */
+	struct State {
+		glm::vec3 position;
+		float orientation;
+		float speed;
+	};
+	State _next;
+	/**
+	 * @brief Only switched by the zone thread between two ticks - but any thread may ask for it
+	 */
+	std::atomic_bool _doubleBuffered;
+	/**
+	 * @brief Set if a pending value differs from the published one - see @c _next for the ordering
+	 */
+	bool _dirty;
+
 public:
 	explicit ICharacter(CharacterId id) :
-			_id(id), _orientation(0.0f), _speed(0.0f) {
+			_id(id), _orientation(0.0f), _speed(0.0f), _next{glm::vec3(0.0f), 0.0f, 0.0f}, _doubleBuffered(false), _dirty(false) {
 	}
 
 	virtual ~ICharacter() {
@@ -95,6 +123,34 @@ public:
 	 * @see setSpeed()
 	 */
 	float getSpeed() const;
+	/**
+	 * @return The position that becomes visible with the next @c commitState() call - this is the same as
+	 * @c getPosition() if the character is not double buffered.
+	 * @note Only call this for the character that is updated by the calling thread
+	 */
+	const glm::vec3& getNextPosition() const;
+	/**
+	 * @sa getNextPosition()
+	 */
+	float getNextOrientation() const;
+	/**
+	 * @sa getNextPosition()
+	 */
+	float getNextSpeed() const;
+	/**
+	 * @brief Let the setters for the position, orientation and speed only change pending values that are
+	 * published by @c commitState(). Disabling it commits the pending values.
+	 * @note This is usually handled by the @c Zone - see @ai{Zone::setDoubleBuffering()}
+	 */
+	void setDoubleBuffered(bool doubleBuffered);
+	bool isDoubleBuffered() const;
+	/**
+	 * @brief Makes the pending position, orientation and speed visible to the getters - nothing is written
+	 * if none of them changed
+	 * @note Must not be called while other threads might read or update the character. The @c Zone calls this
+	 * from its own thread at the end of a tick.
+	 */
+	void commitState();
 	/**
 	 * @brief Set an attribute that can be used for debugging
 	 * @see AI::isDebuggingActive()
@@ -128,10 +184,24 @@ public:
 
 inline void ICharacter::setPosition(const glm::vec3& position) {
 	ai_assert(!isInfinite(position), "invalid position");
+	if (_doubleBuffered.load(std::memory_order_relaxed)) {
+		if (_next.position != position) {
+			_next.position = position;
+			_dirty = true;
+		}
+		return;
+	}
 	_position = position;
 }
 
 inline void ICharacter::setOrientation (float orientation) {
+	if (_doubleBuffered.load(std::memory_order_relaxed)) {
+		if (_next.orientation != orientation) {
+			_next.orientation = orientation;
+			_dirty = true;
+		}
+		return;
+	}
 	_orientation = orientation;
 }
 
@@ -164,6 +234,13 @@ inline const glm::vec3& ICharacter::getPosition() const {
 }
 
 inline void ICharacter::setSpeed(float speed) {
+	if (_doubleBuffered.load(std::memory_order_relaxed)) {
+		if (_next.speed != speed) {
+			_next.speed = speed;
+			_dirty = true;
+		}
+		return;
+	}
 	_speed = speed;
 }
 
@@ -171,6 +248,45 @@ inline float ICharacter::getSpeed() const {
 	return _speed;
 }
 
+inline const glm::vec3& ICharacter::getNextPosition() const {
+	return _doubleBuffered.load(std::memory_order_relaxed) ? _next.position : _position;
+}
+
+inline float ICharacter::getNextOrientation() const {
+	return _doubleBuffered.load(std::memory_order_relaxed) ? _next.orientation : _orientation.load();
+}
+
+inline float ICharacter::getNextSpeed() const {
+	return _doubleBuffered.load(std::memory_order_relaxed) ? _next.speed : _speed.load();
+}
+
+inline void ICharacter::setDoubleBuffered(bool doubleBuffered) {
+	if (_doubleBuffered.load() == doubleBuffered) {
+		return;
+	}
+	if (doubleBuffered) {
+		_next = State{_position, _orientation, _speed};
+		_dirty = false;
+	} else {
+		commitState();
+	}
+	_doubleBuffered.store(doubleBuffered);
+}
+
+inline bool ICharacter::isDoubleBuffered() const {
+	return _doubleBuffered.load();
+}
+
+inline void ICharacter::commitState() {
+	if (!_dirty) {
+		return;
+	}
+	_dirty = false;
+	_position = _next.position;
+	_orientation = _next.orientation;
+	_speed = _next.speed;
+}
+
 typedef std::shared_ptr<ICharacter> ICharacterPtr;
 
 template <typename CharacterType>
@@ -338,6 +338,8 @@ public:
 		{"ai", luaAI_zoneai},
 		{"execute", luaAI_zoneexecute},
 		{"groupMgr", luaAI_zonegroupmgr},
+		{"inRadius", luaAI_zoneinradius},
+		{"influence", luaAI_zoneinfluence},
 		{"__tostring", luaAI_zonetostring},
 		{nullptr, nullptr}
 	};
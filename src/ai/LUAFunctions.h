@@ -410,6 +410,46 @@ static int luaAI_zonesize(lua_State* s) {
 	return 1;
 }
 
+/***
+ * Get the ids of the characters in the zone that are not further away from the given position than the
+ * given radius. This is fast if the zone has a spatial grid.
+ * @tparam vec position The center of the query
+ * @tparam number radius
+ * @treturn {integer, ...} Table with the character ids
+ * @function zone:inRadius
+ */
+static int luaAI_zoneinradius(lua_State* s) {
+	const Zone* zone = luaAI_tozone(s, 1);
+	const glm::vec3* v = luaAI_tovec(s, 2);
+	const float radius = (float)luaL_checknumber(s, 3);
+	Zone::CharacterIdList ids;
+	zone->queryRadius(*v, radius, ids);
+	lua_createtable(s, (int)ids.size(), 0);
+	const int top = lua_gettop(s);
+	int index = 1;
+	for (CharacterId id : ids) {
+		lua_pushinteger(s, id);
+		lua_rawseti(s, top, index++);
+	}
+	return 1;
+}
+
+/***
+ * Get the value of an influence layer of the zone at the given position
+ * @tparam string layer The name of the layer
+ * @tparam vec position
+ * @treturn number The value of the layer - or @c 0 if the zone has no such layer
+ * @treturn vec The direction in which the value of the layer rises
+ * @function zone:influence
+ */
+static int luaAI_zoneinfluence(lua_State* s) {
+	const Zone* zone = luaAI_tozone(s, 1);
+	const char* layer = luaL_checkstring(s, 2);
+	const glm::vec3* v = luaAI_tovec(s, 3);
+	lua_pushnumber(s, zone->getInfluence(layer, *v));
+	return 1 + luaAI_pushvec(s, zone->getInfluenceGradient(layer, *v));
+}
+
 /***
  * Get the highest aggro entry
  * @treturn integer The current highest aggro entry character id or nil
@@ -39,6 +39,9 @@
  *   * @ai{False}
  *   * @ai{Filter}
  *   * @ai{HasEnemies}
+ *   * @ai{HasInfluence} - the influence layer of the zone is above a threshold, see @ai{Zone::addInfluenceLayer()}
+ *   * @ai{HasLineOfSight} - nothing blocks the view to the selected entity, see @ai{Zone::submitWorldQuery()}
+ *   * @ai{HasStimulus} - the entity perceived a stimulus, see @ai{Zone::emitStimulus()}
  *   * @ai{IsCloseToGroup}
  *   * @ai{IsGroupLeader}
  *   * @ai{IsInGroup}
@@ -50,11 +53,13 @@
  *   * @ai{Idle}
  *   * @ai{Invert}
  *   * @ai{Limit}
+ *   * @ai{MoveTo} - walk around the blocked cells to a position or the selected entity, see @ai{Zone::setPathfinder()}
  *   * @ai{Parallel}
  *   * @ai{PrioritySelector}
  *   * @ai{ProbabilitySelector}
  *   * @ai{RandomSelector}
  *   * @ai{Sequence}
+ *   * @ai{Sleep} - stop the updates of the entity until the time passed or an event woke it up
  *   * @ai{Steer}
  *   * @ai{Succeed}
  * * Filter
@@ -69,13 +74,23 @@
  *   * @ai{SelectGroupLeader}
  *   * @ai{SelectGroupMembers} - select all the group members of a specified group
  *   * @ai{SelectHighestAggro} - put the highest @ref Aggro @ai{CharacterId} into the selection
+ *   * @ai{SelectInRadius} - select all entities of the zone in the given radius
+ *   * @ai{SelectNearest} - select the k closest entities of the zone ordered by their distance
+ *   * @ai{SelectStimulus} - select the sources of the perceived stimuli
  *   * @ai{SelectZone} - select all known entities in the zone
  *   * @ai{Union} - merges several other filter results
  * * Steering
+ *   * @movement{Alignment} - head into the direction of the neighbours
+ *   * @movement{Cohesion} - move to the center of the neighbours
+ *   * @movement{FlowFieldSeek} - seek a target around the blocked cells, shared by crowds, see @ai{Zone::setFlowFields()}
+ *   * @movement{FollowPath} - follow the path that was found for the entity, see @ai{MoveTo}
  *   * @movement{GroupFlee}
  *   * @movement{GroupSeek}
+ *   * @movement{InfluenceFlee} - descend the gradient of an influence layer
+ *   * @movement{InfluenceSeek} - climb the gradient of an influence layer
  *   * @movement{SelectionFlee}
  *   * @movement{SelectionSeek}
+ *   * @movement{Separation} - keep a distance to the neighbours
  *   * @movement{TargetFlee}
  *   * @movement{TargetSeek}
  *   * @movement{Wander}
@@ -159,6 +174,10 @@
  * implementation which holds an instance of the @ai{AI} class. Each SimpleAI controlled
  * entity in your world will have one of them.
  *
+ * A loaded tree can also be compiled into a flat program (see @ai{TreeProgram::compile()}) that is
+ * shared by all the entities with this behaviour (see @ai{AI::setProgram()}). In the resume mode the program
+ * continues at the running node and only checks the guards on the way (see @ai{TreeNode::setGuard()}).
+ *
  * @section debugging Remote Debugging
  *
  * @image html aidebugger.png
@@ -236,7 +255,9 @@
 
 #include "common/Types.h"
 #include "common/MemoryAllocator.h"
+#include "common/PoolAllocator.h"
 #include "common/String.h"
+#include "common/ShardedQueue.h"
 #include "common/Math.h"
 #include "common/Random.h"
 #include "common/Log.h"
@@ -245,6 +266,7 @@
 #include "common/Thread.h"
 #include "common/ThreadPool.h"
 #include "common/ExecutionTime.h"
+#include "common/Distance.h"
 
 #include "AI.h"
 #include "AIFactories.h"
@@ -254,6 +276,8 @@
 #include "tree/Fail.h"
 #include "tree/Limit.h"
 #include "tree/Idle.h"
+#include "tree/MoveTo.h"
+#include "tree/Sleep.h"
 #include "tree/Invert.h"
 #include "tree/Parallel.h"
 #include "tree/PrioritySelector.h"
@@ -265,14 +289,23 @@
 #include "tree/ITask.h"
 #include "tree/ITimedNode.h"
 #include "tree/TreeNodeParser.h"
+#include "tree/TreeProgram.h"
 #include "tree/loaders/ITreeLoader.h"
 
 #include "group/GroupId.h"
 #include "group/GroupMgr.h"
 
 #include "movement/SelectionSeek.h"
+#include "movement/Alignment.h"
+#include "movement/Cohesion.h"
+#include "movement/FlowFieldSeek.h"
+#include "movement/FollowPath.h"
 #include "movement/GroupFlee.h"
 #include "movement/GroupSeek.h"
+#include "movement/InfluenceFlee.h"
+#include "movement/InfluenceSeek.h"
+#include "movement/Neighbours.h"
+#include "movement/Separation.h"
 #include "movement/Steering.h"
 #include "movement/TargetFlee.h"
 #include "movement/TargetSeek.h"
@@ -299,12 +332,29 @@
 #include "server/AIUpdateNodeMessage.h"
 
 #include "zone/Zone.h"
+#include "zone/ZoneScheduler.h"
+#include "zone/SpatialGrid.h"
+#include "zone/AABBTree.h"
+#include "zone/InfluenceMap.h"
+
+#include "perception/Stimulus.h"
+#include "perception/PerceptionMemory.h"
+
+#include "world/IWorldQuery.h"
+#include "world/LocalWorldQuery.h"
+#include "path/NavigationGrid.h"
+#include "path/Path.h"
+#include "path/Pathfinder.h"
+#include "path/FlowField.h"
 
 #include "conditions/And.h"
 #include "conditions/ICondition.h"
 #include "conditions/ConditionParser.h"
 #include "conditions/False.h"
 #include "conditions/HasEnemies.h"
+#include "conditions/HasInfluence.h"
+#include "conditions/HasLineOfSight.h"
+#include "conditions/HasStimulus.h"
 #include "conditions/IsGroupLeader.h"
 #include "conditions/IsInGroup.h"
 #include "conditions/Not.h"
@@ -316,6 +366,9 @@
 #include "filter/SelectGroupLeader.h"
 #include "filter/SelectGroupMembers.h"
 #include "filter/SelectHighestAggro.h"
+#include "filter/SelectInRadius.h"
+#include "filter/SelectNearest.h"
+#include "filter/SelectStimulus.h"
 #include "filter/SelectZone.h"
 #include "filter/Union.h"
 #include "filter/Intersection.h"
@@ -11,6 +11,7 @@
 #include <memory>
 #include "ICharacter.h"
 #include <algorithm>
+#include <functional>
 #include "aggro/Entry.h"
 
 namespace ai {
@@ -22,6 +23,10 @@ class AggroMgr {
 public:
 	typedef std::vector<Entry> Entries;
 	typedef Entries::iterator EntriesIter;
+	/**
+	 * @brief Called whenever aggro is added - e.g. to wake up a sleeping @c AI
+	 */
+	typedef std::function<void()> AddAggroListener;
 protected:
 	mutable Entries _entries;
 
@@ -32,6 +37,8 @@ protected:
 	float _reduceValueSecond = 0.0f;
 	ReductionType _reduceType = DISABLED;
 
+	AddAggroListener _addAggroListener;
+
 	class CharacterIdPredicate {
 	private:
 		const CharacterId& _id;
@@ -117,6 +124,10 @@ public:
 		_minAggro = 0.0f;
 	}
 
+	inline void setAddAggroListener(const AddAggroListener& listener) {
+		_addAggroListener = listener;
+	}
+
 	inline void resetReduceValue() {
 		_reduceType = DISABLED;
 		_reduceValueSecond = 0.0f;
@@ -146,6 +157,9 @@ public:
 	 * @return The aggro @c Entry that was added or updated. Useful for changing the reduce type or amount.
 	 */
 	EntryPtr addAggro(CharacterId id, float amount) {
+		if (_addAggroListener) {
+			_addAggroListener();
+		}
 		const CharacterIdPredicate p(id);
 		EntriesIter i = std::find_if(_entries.begin(), _entries.end(), p);
 		if (i == _entries.end()) {
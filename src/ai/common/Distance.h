@@ -0,0 +1,260 @@
+/**
+ * @file
+ *
+ * @brief Batched distance kernels that check one point against many positions at once.
+ *
+ * The positions are given as structure of arrays (see @c PositionArrays) - the kernels use
+ * AVX2 or SSE2 depending on the instruction set the code is compiled for (see @c GLM_ARCH,
+ * @c GLM_FORCE_PURE disables them) and fall back to plain loops otherwise.
+ */
+#pragma once
+
+#include "Math.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+#include <immintrin.h>
+#define AI_DISTANCE_AVX2 1
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <emmintrin.h>
+#define AI_DISTANCE_SSE2 1
+#endif
+
+namespace ai {
+
+/**
+ * @brief Structure of arrays storage for positions - the layout the @c Distance kernels work on
+ */
+class PositionArrays {
+private:
+	std::vector<float> _x;
+	std::vector<float> _y;
+	std::vector<float> _z;
+public:
+	inline void push_back(const glm::vec3& position) {
+		_x.push_back(position.x);
+		_y.push_back(position.y);
+		_z.push_back(position.z);
+	}
+
+	inline void set(std::size_t index, const glm::vec3& position) {
+		_x[index] = position.x;
+		_y[index] = position.y;
+		_z[index] = position.z;
+	}
+
+	inline glm::vec3 get(std::size_t index) const {
+		return glm::vec3(_x[index], _y[index], _z[index]);
+	}
+
+	/**
+	 * @brief Moves the last position into the given slot and removes the last one
+	 */
+	inline void swapRemove(std::size_t index) {
+		_x[index] = _x.back();
+		_y[index] = _y.back();
+		_z[index] = _z.back();
+		_x.pop_back();
+		_y.pop_back();
+		_z.pop_back();
+	}
+
+	inline void reserve(std::size_t size) {
+		_x.reserve(size);
+		_y.reserve(size);
+		_z.reserve(size);
+	}
+
+	inline void clear() {
+		_x.clear();
+		_y.clear();
+		_z.clear();
+	}
+
+	inline std::size_t size() const {
+		return _x.size();
+	}
+
+	inline bool empty() const {
+		return _x.empty();
+	}
+
+	inline const float* x() const {
+		return _x.data();
+	}
+
+	inline const float* y() const {
+		return _y.data();
+	}
+
+	inline const float* z() const {
+		return _z.data();
+	}
+};
+
+namespace Distance {
+
+/**
+ * @brief The amount of positions that are handled in one step of the kernels
+ */
+#if AI_DISTANCE_AVX2
+static const std::size_t Lanes = 8u;
+#elif AI_DISTANCE_SSE2
+static const std::size_t Lanes = 4u;
+#else
+static const std::size_t Lanes = 1u;
+#endif
+
+/**
+ * @brief The amount of positions the chunked helpers (like @c visitInRadius) process at once
+ */
+static const std::size_t ChunkSize = 256u;
+
+/**
+ * @brief Writes the squared distances of the @c n positions to the given center to @c out
+ */
+inline void squaredScalar(const glm::vec3& center, const float* x, const float* y, const float* z, std::size_t n, float* out) {
+	for (std::size_t i = 0u; i < n; ++i) {
+		const float dx = x[i] - center.x;
+		const float dy = y[i] - center.y;
+		const float dz = z[i] - center.z;
+		out[i] = dx * dx + dy * dy + dz * dz;
+	}
+}
+
+/**
+ * @brief Appends the indices of the positions that are not further away from the center than the radius
+ * @param indices Must have room for @c n entries
+ * @return The amount of written indices - they are in ascending order
+ */
+inline std::size_t selectInRadiusScalar(const glm::vec3& center, float radiusSquared, const float* x, const float* y, const float* z, std::size_t n, uint32_t* indices) {
+	std::size_t count = 0u;
+	for (std::size_t i = 0u; i < n; ++i) {
+		const float dx = x[i] - center.x;
+		const float dy = y[i] - center.y;
+		const float dz = z[i] - center.z;
+		// branchless - the index is always written, but only kept if it's inside
+		indices[count] = static_cast<uint32_t>(i);
+		count += (dx * dx + dy * dy + dz * dz <= radiusSquared) ? 1u : 0u;
+	}
+	return count;
+}
+
+/**
+ * @copydoc squaredScalar()
+ */
+inline void squared(const glm::vec3& center, const float* x, const float* y, const float* z, std::size_t n, float* out) {
+	std::size_t i = 0u;
+#if AI_DISTANCE_AVX2
+	const __m256 cx = _mm256_set1_ps(center.x);
+	const __m256 cy = _mm256_set1_ps(center.y);
+	const __m256 cz = _mm256_set1_ps(center.z);
+	for (; i + Lanes <= n; i += Lanes) {
+		const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), cx);
+		const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), cy);
+		const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), cz);
+		const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		_mm256_storeu_ps(out + i, d);
+	}
+#elif AI_DISTANCE_SSE2
+	const __m128 cx = _mm_set1_ps(center.x);
+	const __m128 cy = _mm_set1_ps(center.y);
+	const __m128 cz = _mm_set1_ps(center.z);
+	for (; i + Lanes <= n; i += Lanes) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), cx);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), cy);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), cz);
+		const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		_mm_storeu_ps(out + i, d);
+	}
+#endif
+	squaredScalar(center, x + i, y + i, z + i, n - i, out + i);
+}
+
+/**
+ * @copydoc selectInRadiusScalar()
+ */
+inline std::size_t selectInRadius(const glm::vec3& center, float radiusSquared, const float* x, const float* y, const float* z, std::size_t n, uint32_t* indices) {
+	std::size_t i = 0u;
+	std::size_t count = 0u;
+#if AI_DISTANCE_AVX2 || AI_DISTANCE_SSE2
+#if AI_DISTANCE_AVX2
+	const __m256 cx = _mm256_set1_ps(center.x);
+	const __m256 cy = _mm256_set1_ps(center.y);
+	const __m256 cz = _mm256_set1_ps(center.z);
+	const __m256 r = _mm256_set1_ps(radiusSquared);
+	for (; i + Lanes <= n; i += Lanes) {
+		const __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(x + i), cx);
+		const __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(y + i), cy);
+		const __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(z + i), cz);
+		const __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		const unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(_mm256_cmp_ps(d, r, _CMP_LE_OQ)));
+#else
+	const __m128 cx = _mm_set1_ps(center.x);
+	const __m128 cy = _mm_set1_ps(center.y);
+	const __m128 cz = _mm_set1_ps(center.z);
+	const __m128 r = _mm_set1_ps(radiusSquared);
+	for (; i + Lanes <= n; i += Lanes) {
+		const __m128 dx = _mm_sub_ps(_mm_loadu_ps(x + i), cx);
+		const __m128 dy = _mm_sub_ps(_mm_loadu_ps(y + i), cy);
+		const __m128 dz = _mm_sub_ps(_mm_loadu_ps(z + i), cz);
+		const __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		const unsigned int mask = static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(d, r)));
+#endif
+		if (mask == 0u) {
+			continue;
+		}
+		// compact the set lanes of the mask into the index list
+		for (std::size_t lane = 0u; lane < Lanes; ++lane) {
+			indices[count] = static_cast<uint32_t>(i + lane);
+			count += (mask >> lane) & 1u;
+		}
+	}
+#endif
+	const std::size_t tail = selectInRadiusScalar(center, radiusSquared, x + i, y + i, z + i, n - i, indices + count);
+	for (std::size_t j = count; j < count + tail; ++j) {
+		indices[j] += static_cast<uint32_t>(i);
+	}
+	return count + tail;
+}
+
+/**
+ * @brief Calls the functor with the index of every position that is not further away from the
+ * center than the radius. The positions are processed in chunks of @c ChunkSize - so no heap memory is needed.
+ */
+template<typename Func>
+inline void visitInRadius(const glm::vec3& center, float radiusSquared, const PositionArrays& positions, Func&& func) {
+	uint32_t indices[ChunkSize];
+	const std::size_t size = positions.size();
+	for (std::size_t first = 0u; first < size; first += ChunkSize) {
+		const std::size_t n = std::min(ChunkSize, size - first);
+		const std::size_t found = selectInRadius(center, radiusSquared, positions.x() + first, positions.y() + first, positions.z() + first, n, indices);
+		for (std::size_t i = 0u; i < found; ++i) {
+			func(first + indices[i]);
+		}
+	}
+}
+
+/**
+ * @brief Calls the functor with the index and the squared distance of every position
+ * @sa visitInRadius()
+ */
+template<typename Func>
+inline void visitSquared(const glm::vec3& center, const PositionArrays& positions, Func&& func) {
+	float distances[ChunkSize];
+	const std::size_t size = positions.size();
+	for (std::size_t first = 0u; first < size; first += ChunkSize) {
+		const std::size_t n = std::min(ChunkSize, size - first);
+		squared(center, positions.x() + first, positions.y() + first, positions.z() + first, n, distances);
+		for (std::size_t i = 0u; i < n; ++i) {
+			func(first + i, distances[i]);
+		}
+	}
+}
+
+}
+
+}
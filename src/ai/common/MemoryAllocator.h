@@ -3,7 +3,10 @@
  */
 #pragma once
 
+#include "PoolAllocator.h"
 #include <memory>
+#include <utility>
+#include <cstddef>
 
 namespace ai {
 
@@ -65,7 +68,61 @@ public:
 #endif
 /**
  * @brief Every object that is derived from @c MemObject is allocated with the @c AI_ALLOCATOR_CLASS allocator.
+ * @c PoolAllocator is the allocator that is shipped with the library.
  */
 typedef _MemObject<AI_ALLOCATOR_CLASS> MemObject;
 
+/**
+ * @brief Standard library allocator on top of the static allocator classes - e.g. for @c std::allocate_shared
+ */
+template<class T, class AllocatorClass>
+class _StlAllocator {
+public:
+	typedef T value_type;
+
+	template<class U>
+	struct rebind {
+		typedef _StlAllocator<U, AllocatorClass> other;
+	};
+
+	_StlAllocator() {
+	}
+
+	template<class U>
+	_StlAllocator(const _StlAllocator<U, AllocatorClass>&) {
+	}
+
+	inline T* allocate(std::size_t n) {
+		return static_cast<T*>(AllocatorClass::allocate(n * sizeof(T)));
+	}
+
+	inline void deallocate(T* ptr, std::size_t) {
+		AllocatorClass::deallocate(ptr);
+	}
+
+	template<class U>
+	inline bool operator==(const _StlAllocator<U, AllocatorClass>&) const {
+		return true;
+	}
+
+	template<class U>
+	inline bool operator!=(const _StlAllocator<U, AllocatorClass>&) const {
+		return false;
+	}
+};
+
+template<class T>
+using StlAllocator = _StlAllocator<T, AI_ALLOCATOR_CLASS>;
+
+/**
+ * @brief Replacement for @c std::make_shared that puts the object and the reference counter into memory of the
+ * @c AI_ALLOCATOR_CLASS allocator. @c std::make_shared would bypass the operators of @c MemObject.
+ *
+ * The factories of the nodes, conditions, filters and steerings create their objects with this.
+ */
+template<class T, class... Args>
+inline std::shared_ptr<T> makeShared(Args&&... args) {
+	return std::allocate_shared<T>(StlAllocator<T>(), std::forward<Args>(args)...);
+}
+
 }
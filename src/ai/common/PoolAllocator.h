@@ -0,0 +1,302 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+namespace ai {
+
+/**
+ * @brief Size class pool allocator with a cache per thread - usable as @c AI_ALLOCATOR_CLASS
+ * (see @c MemObject).
+ *
+ * Requests up to @c MaxSize bytes are rounded up to one of the size classes and served from a free list
+ * of the calling thread. The blocks are carved from chunks of @c ChunkSize bytes - so spawning a lot of
+ * trees doesn't go through the lock of the global heap for every node. Larger requests are passed to the
+ * global heap.
+ *
+ * A block that is freed by another thread than the one that allocated it is handed back to the owning
+ * thread via a lock free list - the owner picks it up when its own free list of that size runs dry.
+ * When a thread exits, its cache is taken over by the next thread that allocates. The chunks are
+ * never given back to the system.
+ *
+ * @note All blocks are 16 byte aligned
+ */
+class PoolAllocator {
+public:
+	static const std::size_t MaxSize = 1024u;
+	static const std::size_t ChunkSize = 64u * 1024u;
+
+	/**
+	 * @brief The usage counters summed up over all threads
+	 */
+	struct Stats {
+		// served from the size classes
+		uint64_t allocations;
+		uint64_t deallocations;
+		// the part of the deallocations that were handed back to the allocating thread
+		uint64_t remoteDeallocations;
+		// passed to the global heap
+		uint64_t largeAllocations;
+		uint64_t largeDeallocations;
+		// the memory of the chunks
+		std::size_t reservedBytes;
+		int threadCaches;
+	};
+
+private:
+	static const int Classes = 20;
+	static const uint32_t LargeClass = 0xffffffffu;
+
+	struct ThreadCache;
+	/**
+	 * @brief In front of every block - so @c deallocate() knows the size and the owner
+	 */
+	struct alignas(16) Header {
+		ThreadCache* owner;
+		uint32_t sizeClass;
+	};
+	struct FreeBlock {
+		FreeBlock* next;
+	};
+
+	struct ThreadCache {
+		FreeBlock* free[Classes] = {};
+		// blocks that were freed by other threads - all size classes
+		std::atomic<FreeBlock*> remote {nullptr};
+		char* bump = nullptr;
+		char* bumpEnd = nullptr;
+		// only written by the owning thread
+		std::atomic<uint64_t> allocations {0u};
+		std::atomic<uint64_t> deallocations {0u};
+		std::atomic<std::size_t> reservedBytes {0u};
+		// written by the other threads
+		std::atomic<uint64_t> remoteDeallocations {0u};
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<ThreadCache*> caches;
+		// the caches of exited threads - taken over by new threads
+		std::vector<ThreadCache*> orphans;
+		std::atomic<uint64_t> largeAllocations {0u};
+		std::atomic<uint64_t> largeDeallocations {0u};
+	};
+
+	/**
+	 * @brief Gives the cache to the next thread when the owning thread exits
+	 */
+	struct Holder {
+		~Holder();
+	};
+
+	static Registry& registry() {
+		// never destroyed - blocks might be freed during the static destruction
+		static Registry* r = new Registry();
+		return *r;
+	}
+
+	static ThreadCache*& current() {
+		static thread_local ThreadCache* cache = nullptr;
+		return cache;
+	}
+
+	static bool& exited() {
+		static thread_local bool e = false;
+		return e;
+	}
+
+	static inline void increment(std::atomic<uint64_t>& counter) {
+		// only one writer - no need for a locked instruction
+		counter.store(counter.load(std::memory_order_relaxed) + 1u, std::memory_order_relaxed);
+	}
+
+	static ThreadCache* acquire();
+	static ThreadCache* local();
+	static void* allocateLarge(std::size_t size);
+	static FreeBlock* refill(ThreadCache& cache, uint32_t sizeClass);
+
+	PoolAllocator() {
+	}
+
+public:
+	/**
+	 * @return The index of the size class for the given amount of bytes - @c 16 byte steps up to @c 128, then four
+	 * classes per power of two
+	 */
+	static inline uint32_t sizeClass(std::size_t size) {
+		if (size <= 128u) {
+			return size == 0u ? 0u : static_cast<uint32_t>((size + 15u) / 16u - 1u);
+		}
+		const std::size_t v = size - 1u;
+		uint32_t k = 7u;
+		while ((v >> (k + 1u)) != 0u) {
+			++k;
+		}
+		return 8u + (k - 7u) * 4u + static_cast<uint32_t>((v - (std::size_t(1u) << k)) >> (k - 2u));
+	}
+
+	/**
+	 * @return The amount of bytes a block of the given size class offers
+	 */
+	static inline std::size_t classSize(uint32_t sizeClass) {
+		if (sizeClass < 8u) {
+			return (sizeClass + 1u) * 16u;
+		}
+		const uint32_t k = 7u + (sizeClass - 8u) / 4u;
+		const uint32_t sub = (sizeClass - 8u) % 4u;
+		return (std::size_t(1u) << k) + (sub + 1u) * (std::size_t(1u) << (k - 2u));
+	}
+
+	static void* allocate(std::size_t size);
+
+	static void deallocate(void* ptr);
+
+	static Stats getStats();
+};
+
+inline PoolAllocator::Holder::~Holder() {
+	ThreadCache* cache = current();
+	current() = nullptr;
+	exited() = true;
+	if (cache == nullptr) {
+		return;
+	}
+	Registry& r = registry();
+	std::unique_lock<std::mutex> lock(r.mutex);
+	r.orphans.push_back(cache);
+}
+
+inline PoolAllocator::ThreadCache* PoolAllocator::acquire() {
+	Registry& r = registry();
+	std::unique_lock<std::mutex> lock(r.mutex);
+	if (!r.orphans.empty()) {
+		ThreadCache* cache = r.orphans.back();
+		r.orphans.pop_back();
+		return cache;
+	}
+	ThreadCache* cache = new ThreadCache();
+	r.caches.push_back(cache);
+	return cache;
+}
+
+inline PoolAllocator::ThreadCache* PoolAllocator::local() {
+	ThreadCache*& cache = current();
+	if (cache == nullptr) {
+		if (exited()) {
+			// the thread is shutting down - the global heap takes over
+			return nullptr;
+		}
+		static thread_local Holder holder;
+		(void)holder;
+		cache = acquire();
+	}
+	return cache;
+}
+
+inline void* PoolAllocator::allocateLarge(std::size_t size) {
+	++registry().largeAllocations;
+	Header* header = static_cast<Header*>(::operator new(sizeof(Header) + size));
+	header->owner = nullptr;
+	header->sizeClass = LargeClass;
+	return header + 1;
+}
+
+inline PoolAllocator::FreeBlock* PoolAllocator::refill(ThreadCache& cache, uint32_t sizeClass) {
+	// take back the blocks the other threads freed
+	FreeBlock* remote = cache.remote.exchange(nullptr, std::memory_order_acquire);
+	while (remote != nullptr) {
+		FreeBlock* next = remote->next;
+		const uint32_t c = (reinterpret_cast<Header*>(remote) - 1)->sizeClass;
+		remote->next = cache.free[c];
+		cache.free[c] = remote;
+		remote = next;
+	}
+	if (cache.free[sizeClass] != nullptr) {
+		return cache.free[sizeClass];
+	}
+	const std::size_t blockSize = sizeof(Header) + classSize(sizeClass);
+	if (cache.bump == nullptr || static_cast<std::size_t>(cache.bumpEnd - cache.bump) < blockSize) {
+		// the rest of the old chunk is lost
+		cache.bump = static_cast<char*>(::operator new(ChunkSize));
+		cache.bumpEnd = cache.bump + ChunkSize;
+		cache.reservedBytes.store(cache.reservedBytes.load(std::memory_order_relaxed) + ChunkSize, std::memory_order_relaxed);
+	}
+	Header* header = reinterpret_cast<Header*>(cache.bump);
+	cache.bump += blockSize;
+	header->owner = &cache;
+	header->sizeClass = sizeClass;
+	FreeBlock* block = reinterpret_cast<FreeBlock*>(header + 1);
+	block->next = nullptr;
+	cache.free[sizeClass] = block;
+	return block;
+}
+
+inline void* PoolAllocator::allocate(std::size_t size) {
+	if (size > MaxSize) {
+		return allocateLarge(size);
+	}
+	ThreadCache* cache = local();
+	if (cache == nullptr) {
+		return allocateLarge(size);
+	}
+	const uint32_t c = sizeClass(size);
+	FreeBlock* block = cache->free[c];
+	if (block == nullptr) {
+		block = refill(*cache, c);
+	}
+	cache->free[c] = block->next;
+	increment(cache->allocations);
+	return block;
+}
+
+inline void PoolAllocator::deallocate(void* ptr) {
+	if (ptr == nullptr) {
+		return;
+	}
+	Header* header = static_cast<Header*>(ptr) - 1;
+	if (header->sizeClass == LargeClass) {
+		++registry().largeDeallocations;
+		::operator delete(header);
+		return;
+	}
+	ThreadCache* owner = header->owner;
+	FreeBlock* block = static_cast<FreeBlock*>(ptr);
+	if (owner == current()) {
+		block->next = owner->free[header->sizeClass];
+		owner->free[header->sizeClass] = block;
+		increment(owner->deallocations);
+		return;
+	}
+	// hand it back to the owner
+	owner->remoteDeallocations.fetch_add(1u, std::memory_order_relaxed);
+	FreeBlock* head = owner->remote.load(std::memory_order_relaxed);
+	do {
+		block->next = head;
+	} while (!owner->remote.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+}
+
+inline PoolAllocator::Stats PoolAllocator::getStats() {
+	Registry& r = registry();
+	Stats stats = {};
+	std::unique_lock<std::mutex> lock(r.mutex);
+	for (const ThreadCache* cache : r.caches) {
+		stats.allocations += cache->allocations.load(std::memory_order_relaxed);
+		stats.deallocations += cache->deallocations.load(std::memory_order_relaxed);
+		stats.remoteDeallocations += cache->remoteDeallocations.load(std::memory_order_relaxed);
+		stats.reservedBytes += cache->reservedBytes.load(std::memory_order_relaxed);
+	}
+	stats.deallocations += stats.remoteDeallocations;
+	stats.largeAllocations = r.largeAllocations;
+	stats.largeDeallocations = r.largeDeallocations;
+	stats.threadCaches = static_cast<int>(r.caches.size());
+	return stats;
+}
+
+}
@@ -0,0 +1,47 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+namespace ai {
+
+/**
+ * @brief Collects values from any thread. The buffers are picked by the pushing thread - so the
+ * workers of a parallel zone update don't contend on one lock.
+ */
+template<typename T>
+class ShardedQueue {
+private:
+	static const std::size_t BUFFERS = 16u;
+	struct Buffer {
+		std::mutex mutex;
+		std::vector<T> values;
+	};
+	Buffer _buffers[BUFFERS];
+
+public:
+	inline void push(const T& value) {
+		static const std::hash<std::thread::id> hasher;
+		Buffer& buffer = _buffers[hasher(std::this_thread::get_id()) % BUFFERS];
+		std::unique_lock<std::mutex> lock(buffer.mutex);
+		buffer.values.push_back(value);
+	}
+
+	/**
+	 * @brief Moves all the queued values into the given list
+	 */
+	inline void drain(std::vector<T>& values) {
+		for (Buffer& buffer : _buffers) {
+			std::unique_lock<std::mutex> lock(buffer.mutex);
+			values.insert(values.end(), buffer.values.begin(), buffer.values.end());
+			buffer.values.clear();
+		}
+	}
+};
+
+}
@@ -6,38 +6,251 @@
 #include "Types.h"
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <map>
 
 namespace ai {
 
-// TODO: not a real read-write-lock - maybe someday
+/**
+ * @brief Contention statistics of all the @c ReadWriteLock instances that share a name
+ */
+struct LockStats {
+	std::string name;
+	/**
+	 * @brief The amount of read and write locks that were acquired
+	 */
+	uint64_t acquisitions;
+	/**
+	 * @brief The amount of acquisitions that had to wait for another thread
+	 */
+	uint64_t contended;
+	/**
+	 * @brief The accumulated time in microseconds that was spent waiting in contended acquisitions
+	 */
+	uint64_t waitMicros;
+};
+typedef std::vector<LockStats> LockStatsList;
+
+/**
+ * @brief Shared/exclusive lock - readers run concurrently, writers get exclusive access.
+ *
+ * The lock is writer-fair: as soon as a writer is waiting, no new readers are let in, so a
+ * steady stream of readers can't starve the writers. A contended lock spins for a short time
+ * and afterwards puts the thread to sleep on a condition variable.
+ *
+ * The lock is not recursive - taking a read lock while the same thread already holds one
+ * might deadlock if a writer is waiting in between.
+ *
+ * The name of the lock is used to aggregate the contention statistics, see @c getStats
+ */
 class ReadWriteLock {
 private:
+	static const int32_t WRITER = -1;
+	// the amount of yields before a contended acquisition goes to sleep
+	static const int SPIN_COUNT = 64;
+
 	const std::string _name;
-	mutable std::atomic_flag _locked = ATOMIC_FLAG_INIT;
+	// the amount of active readers or WRITER
+	mutable std::atomic<int32_t> _state;
+	mutable std::atomic<int32_t> _waitingWriters;
+	mutable std::atomic<int32_t> _sleepers;
+	mutable std::mutex _mutex;
+	mutable std::condition_variable _condition;
+
+	mutable std::atomic<uint64_t> _acquisitions;
+	mutable std::atomic<uint64_t> _contended;
+	mutable std::atomic<uint64_t> _waitMicros;
+
+	// intrusive links into the registry - only valid while _registered is set
+	mutable const ReadWriteLock* _prev;
+	mutable const ReadWriteLock* _next;
+	mutable std::atomic<bool> _registered;
+
+	struct Registry {
+		std::mutex mutex;
+		const ReadWriteLock* head = nullptr;
+		// the statistics of the locks that were already destroyed
+		std::map<std::string, LockStats> retired;
+	};
+
+	static Registry& registry() {
+		static Registry r;
+		return r;
+	}
+
+	/**
+	 * @brief Locks are put into the registry on their first acquisition - after that it's one flag check per
+	 * acquisition. Constructing and destroying a lock that was never acquired doesn't touch the global registry mutex.
+	 */
+	void registerLock() const {
+		if (_registered.load(std::memory_order_acquire)) {
+			return;
+		}
+		Registry& r = registry();
+		std::unique_lock<std::mutex> lock(r.mutex);
+		if (_registered.load(std::memory_order_relaxed)) {
+			return;
+		}
+		_prev = nullptr;
+		_next = r.head;
+		if (r.head != nullptr) {
+			r.head->_prev = this;
+		}
+		r.head = this;
+		_registered.store(true, std::memory_order_release);
+	}
+
+	static int spinCount() {
+		// spinning only makes sense if the lock holder can run at the same time
+		static const int count = std::thread::hardware_concurrency() > 1u ? SPIN_COUNT : 0;
+		return count;
+	}
+
+	inline bool tryLockReadInternal() const {
+		int32_t state = _state.load(std::memory_order_relaxed);
+		while (state >= 0 && _waitingWriters.load(std::memory_order_relaxed) == 0) {
+			if (_state.compare_exchange_weak(state, state + 1)) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	inline bool tryLockWriteInternal() const {
+		int32_t expected = 0;
+		return _state.compare_exchange_strong(expected, WRITER);
+	}
+
+	template<typename TryLock>
+	void lockContended(TryLock tryLock) const {
+		const auto start = std::chrono::steady_clock::now();
+		bool locked = false;
+		for (int i = spinCount(); i > 0; --i) {
+			std::this_thread::yield();
+			if (tryLock()) {
+				locked = true;
+				break;
+			}
+		}
+		if (!locked) {
+			std::unique_lock<std::mutex> lock(_mutex);
+			++_sleepers;
+			_condition.wait(lock, tryLock);
+			--_sleepers;
+		}
+		const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+		_acquisitions.fetch_add(1u, std::memory_order_relaxed);
+		_contended.fetch_add(1u, std::memory_order_relaxed);
+		_waitMicros.fetch_add(waited.count(), std::memory_order_relaxed);
+	}
+
+	inline void wakeAll() const {
+		if (_sleepers.load() <= 0) {
+			return;
+		}
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condition.notify_all();
+	}
+
+	static void add(std::map<std::string, LockStats>& map, const std::string& name, uint64_t acquisitions, uint64_t contended, uint64_t waitMicros) {
+		LockStats& stats = map[name];
+		stats.name = name;
+		stats.acquisitions += acquisitions;
+		stats.contended += contended;
+		stats.waitMicros += waitMicros;
+	}
+
 public:
 	ReadWriteLock(const std::string& name) :
-			_name(name) {
+			_name(name), _state(0), _waitingWriters(0), _sleepers(0), _acquisitions(0u), _contended(0u), _waitMicros(0u),
+			_prev(nullptr), _next(nullptr), _registered(false) {
+	}
+
+	~ReadWriteLock() {
+		if (!_registered.load(std::memory_order_acquire)) {
+			return;
+		}
+		Registry& r = registry();
+		std::unique_lock<std::mutex> lock(r.mutex);
+		if (_prev != nullptr) {
+			_prev->_next = _next;
+		} else {
+			r.head = _next;
+		}
+		if (_next != nullptr) {
+			_next->_prev = _prev;
+		}
+		add(r.retired, _name, _acquisitions, _contended, _waitMicros);
+	}
+
+	inline const std::string& getName() const {
+		return _name;
+	}
+
+	/**
+	 * @return The amount of writers that are currently waiting for the lock
+	 */
+	inline int32_t getWaitingWriters() const {
+		return _waitingWriters.load();
 	}
 
 	inline void lockRead() const {
-		while (_locked.test_and_set(std::memory_order_acquire)) {
-			std::this_thread::yield();
+		registerLock();
+		if (tryLockReadInternal()) {
+			_acquisitions.fetch_add(1u, std::memory_order_relaxed);
+			return;
 		}
+		lockContended([this] () {
+			return tryLockReadInternal();
+		});
 	}
 
 	inline void unlockRead() const {
-		_locked.clear(std::memory_order_release);
+		if (_state.fetch_sub(1) == 1) {
+			wakeAll();
+		}
 	}
 
 	inline void lockWrite() {
-		while (_locked.test_and_set(std::memory_order_acquire)) {
-			std::this_thread::yield();
+		registerLock();
+		if (tryLockWriteInternal()) {
+			_acquisitions.fetch_add(1u, std::memory_order_relaxed);
+			return;
 		}
+		// keep new readers out until we got the lock
+		++_waitingWriters;
+		lockContended([this] () {
+			return tryLockWriteInternal();
+		});
+		--_waitingWriters;
 	}
 
 	inline void unlockWrite() {
-		_locked.clear(std::memory_order_release);
+		_state.store(0);
+		wakeAll();
+	}
+
+	/**
+	 * @brief The contention statistics of all the locks - aggregated by the lock names and sorted by name.
+	 * This includes the locks that were already destroyed.
+	 */
+	static LockStatsList getStats() {
+		Registry& r = registry();
+		std::unique_lock<std::mutex> lock(r.mutex);
+		std::map<std::string, LockStats> map(r.retired);
+		for (const ReadWriteLock* l = r.head; l != nullptr; l = l->_next) {
+			add(map, l->_name, l->_acquisitions, l->_contended, l->_waitMicros);
+		}
+		LockStatsList list;
+		list.reserve(map.size());
+		for (const auto& e : map) {
+			list.push_back(e.second);
+		}
+		return list;
 	}
 };
 
@@ -65,6 +278,46 @@ public:
 	}
 };
 
+/**
+ * @brief Blocks in @c wait() until @c countDown() was called the amount of times
+ * that was given to the constructor.
+ */
+class Latch {
+private:
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::size_t _count;
+public:
+	explicit Latch(std::size_t count) :
+			_count(count) {
+	}
+
+	inline void countDown() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		if (_count == 0u) {
+			return;
+		}
+		if (--_count == 0u) {
+			_condition.notify_all();
+		}
+	}
+
+	/**
+	 * @return @c true if the count already reached zero
+	 */
+	inline bool tryWait() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		return _count == 0u;
+	}
+
+	inline void wait() {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condition.wait(lock, [this] {
+			return _count == 0u;
+		});
+	}
+};
+
 #ifndef AI_THREAD_LOCAL
 #define AI_THREAD_LOCAL thread_local
 #endif
@@ -19,12 +19,16 @@
 
  3. This notice may not be removed or altered from any source
  distribution.
+
+ Altered by the SimpleAI authors: the single locked task queue was replaced by
+ per worker work stealing queues and a future-less schedule() was added.
  */
 
 #pragma once
 
+#include "Thread.h"
 #include <vector>
-#include <queue>
+#include <deque>
 #include <memory>
 #include <thread>
 #include <mutex>
@@ -35,6 +39,15 @@
 
 namespace ai {
 
+/**
+ * @brief Work stealing thread pool
+ *
+ * Every worker owns a task queue. Tasks that are scheduled from within a worker are pushed to the
+ * queue of that worker and are taken in LIFO order by their owner - they are most likely still hot
+ * in the cache. Tasks that are scheduled from other threads are distributed round robin over the
+ * worker queues. A worker without tasks steals the oldest task from the other queues (FIFO). If
+ * there is nothing to steal, it spins for a short time before it goes to sleep.
+ */
 class ThreadPool final {
 public:
 	explicit ThreadPool(size_t);
@@ -45,45 +58,233 @@ public:
 	template<class F, class ... Args>
 	auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type>;
 
+	/**
+	 * @brief Schedule functors or lambdas without the overhead of a @c std::future. Use this if you
+	 * don't need the result or synchronize on your own (e.g. with a @c Latch).
+	 *
+	 * @note If the pool doesn't have any workers, the functor is executed by the calling thread.
+	 */
+	template<class F>
+	void schedule(F&& f);
+
+	/**
+	 * @brief Executes one of the queued tasks on the calling thread.
+	 *
+	 * Use this to help the workers while you are waiting for your tasks to finish. This is needed
+	 * if you wait from within a task of this pool - otherwise all workers might end up waiting for
+	 * tasks that nobody executes anymore. A worker takes its own newest task first, any other thread
+	 * takes the oldest task.
+	 *
+	 * @return @c false if there was no task left in any of the queues
+	 */
+	bool runPendingTask();
+
+	/**
+	 * @return The amount of worker threads
+	 */
+	inline size_t size() const {
+		return _workers.size();
+	}
+
 	~ThreadPool();
 private:
+	typedef std::function<void()> Task;
+
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	struct WorkerContext {
+		const ThreadPool* pool;
+		size_t index;
+	};
+
+	// the amount of yields an idle worker performs before it goes to sleep
+	static const int SPIN_COUNT = 64;
+	// spinning only makes sense if the thread that produces the work can run at the same time
+	const int _spinCount;
+
 	// need to keep track of threads so we can join them
 	std::vector<std::thread> _workers;
-	// the task queue
-	std::queue<std::function<void()> > _tasks;
+	// one task queue per worker
+	std::vector<std::unique_ptr<WorkQueue> > _queues;
 
-	// synchronization
-	std::mutex _queueMutex;
-	std::condition_variable _condition;
+	// the amount of tasks that were pushed but not yet taken from a queue
+	std::atomic_int _pending;
+	std::atomic_size_t _nextQueue;
+
+	// synchronization for the sleeping workers
+	std::atomic_int _parked;
+	// the amount of workers that were woken up and didn't find a task yet
+	std::atomic_int _searching;
+	std::mutex _parkMutex;
+	std::condition_variable _parkCondition;
 	std::atomic_bool _stop;
+
+	static WorkerContext& context() {
+		static AI_THREAD_LOCAL WorkerContext ctx = {nullptr, 0u};
+		return ctx;
+	}
+
+	void push(Task&& task);
+	void wakeOne();
+	bool pop(size_t index, Task& task);
+	bool steal(size_t index, Task& task);
+	void run(size_t index);
 };
 
 // the constructor just launches some amount of workers
 inline ThreadPool::ThreadPool(size_t threads) :
-		_stop(false) {
+		_spinCount(std::thread::hardware_concurrency() > 1u ? SPIN_COUNT : 0), _pending(0), _nextQueue(0u), _parked(0), _searching(0), _stop(false) {
+	_queues.reserve(threads);
+	for (size_t i = 0; i < threads; ++i) {
+		_queues.emplace_back(new WorkQueue());
+	}
 	_workers.reserve(threads);
 	for (size_t i = 0; i < threads; ++i) {
-		_workers.emplace_back([this] {
-			for (;;) {
-				std::function<void()> task;
-				{
-					std::unique_lock<std::mutex> lock(this->_queueMutex);
-					this->_condition.wait(lock, [this] {
-						return this->_stop || !this->_tasks.empty();
-					});
-					if (this->_stop && this->_tasks.empty()) {
-						return;
-					}
-					task = std::move(this->_tasks.front());
-					this->_tasks.pop();
-				}
+		_workers.emplace_back([this, i] {
+			run(i);
+		});
+	}
+}
 
-				task();
+inline void ThreadPool::run(size_t index) {
+	WorkerContext& ctx = context();
+	ctx.pool = this;
+	ctx.index = index;
+	Task task;
+	bool searching = false;
+	for (;;) {
+		if (pop(index, task) || steal(index, task)) {
+			// the last searching worker hands over the search to a sleeping one
+			if (searching) {
+				searching = false;
+				if (--_searching == 0 && _pending > 0) {
+					wakeOne();
+				}
 			}
+			task();
+			task = nullptr;
+			continue;
+		}
+		if (_stop && _pending <= 0) {
+			return;
+		}
+		for (int i = 0; i < _spinCount && _pending <= 0 && !_stop; ++i) {
+			std::this_thread::yield();
+		}
+		if (_pending > 0 || _stop) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(_parkMutex);
+		if (searching) {
+			searching = false;
+			--_searching;
+		}
+		++_parked;
+		_parkCondition.wait(lock, [this] {
+			return _stop || _pending > 0;
 		});
+		--_parked;
+		++_searching;
+		searching = true;
 	}
 }
 
+inline bool ThreadPool::runPendingTask() {
+	if (_queues.empty()) {
+		return false;
+	}
+	const WorkerContext& ctx = context();
+	const bool worker = ctx.pool == this;
+	Task task;
+	if (worker && pop(ctx.index, task)) {
+		task();
+		return true;
+	}
+	// every other thread takes the oldest tasks - like a stealing worker. Popping the newest ones would starve
+	// the tasks that were queued earlier as long as new ones keep coming in (e.g. one range task per zone tick).
+	// Don't use try_lock here - the caller might block after we return false, so we must not miss a task
+	const size_t size = _queues.size();
+	const size_t first = worker ? ctx.index + 1u : 0u;
+	for (size_t i = 0; i < size; ++i) {
+		WorkQueue& queue = *_queues[(first + i) % size];
+		std::unique_lock<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) {
+			continue;
+		}
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		--_pending;
+		lock.unlock();
+		task();
+		return true;
+	}
+	return false;
+}
+
+inline void ThreadPool::wakeOne() {
+	if (_parked <= 0) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(_parkMutex);
+	_parkCondition.notify_one();
+}
+
+inline bool ThreadPool::pop(size_t index, Task& task) {
+	WorkQueue& queue = *_queues[index];
+	std::unique_lock<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty()) {
+		return false;
+	}
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	--_pending;
+	return true;
+}
+
+inline bool ThreadPool::steal(size_t index, Task& task) {
+	const size_t size = _queues.size();
+	for (size_t i = 1; i < size; ++i) {
+		WorkQueue& queue = *_queues[(index + i) % size];
+		std::unique_lock<std::mutex> lock(queue.mutex, std::try_to_lock);
+		if (!lock.owns_lock() || queue.tasks.empty()) {
+			continue;
+		}
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		--_pending;
+		return true;
+	}
+	return false;
+}
+
+inline void ThreadPool::push(Task&& task) {
+	if (_queues.empty()) {
+		task();
+		return;
+	}
+	const WorkerContext& ctx = context();
+	const size_t index = ctx.pool == this ? ctx.index : _nextQueue++ % _queues.size();
+	// announce the task before it is visible - a parking worker either sees this or we see the parked worker
+	++_pending;
+	{
+		WorkQueue& queue = *_queues[index];
+		std::unique_lock<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+	// a worker that is already searching will find the task
+	if (_searching <= 0) {
+		wakeOne();
+	}
+}
+
+template<class F>
+inline void ThreadPool::schedule(F&& f) {
+	push(Task(std::forward<F>(f)));
+}
+
 // add new work item to the pool
 template<class F, class ... Args>
 auto ThreadPool::enqueue(F&& f, Args&&... args)
@@ -93,18 +294,17 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
 	auto task = std::make_shared<std::packaged_task<return_type()> >(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
 
 	std::future<return_type> res = task->get_future();
-	{
-		std::unique_lock<std::mutex> lock(_queueMutex);
-		_tasks.emplace([task]() {(*task)();});
-	}
-	_condition.notify_one();
+	push([task]() {(*task)();});
 	return res;
 }
 
-// the destructor joins all threads
+// the destructor joins all threads - the queued tasks are still executed
 inline ThreadPool::~ThreadPool() {
 	_stop = true;
-	_condition.notify_all();
+	{
+		std::unique_lock<std::mutex> lock(_parkMutex);
+		_parkCondition.notify_all();
+	}
 	for (std::thread &worker : _workers)
 		worker.join();
 }
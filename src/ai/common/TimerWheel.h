@@ -0,0 +1,103 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief Hashed timer wheel - adding a timer is O(1) and advancing the time only touches the timers
+ * in the slots that were passed, no matter how many timers are pending in total.
+ *
+ * The time is split into slots of @c resolution millis. A timer is put into the slot of its deadline
+ * (modulo the amount of slots) and is fired when the wheel passes its slot and the deadline is reached.
+ * Timers are never fired too early, but might be fired up to one @c resolution too late.
+ *
+ * Timers can't be cancelled - put something like a generation counter into @c T and ignore the
+ * outdated ones when they fire.
+ */
+template<typename T>
+class TimerWheel {
+private:
+	struct Timer {
+		// the slot tick the timer expires in
+		int64_t tick;
+		T value;
+	};
+	typedef std::vector<Timer> Slot;
+
+	std::vector<Slot> _slots;
+	const int64_t _resolution;
+	// the last tick that was processed
+	int64_t _current;
+	std::size_t _size;
+	std::vector<T> _expired;
+
+public:
+	/**
+	 * @param resolution The millis that are covered by one slot
+	 * @param slots The amount of slots - timers that are more than @c resolution * @c slots millis in the
+	 * future are checked in every revolution of the wheel.
+	 */
+	explicit TimerWheel(int64_t resolution = 16, std::size_t slots = 256u) :
+			_slots(slots), _resolution(resolution), _current(0), _size(0u) {
+	}
+
+	/**
+	 * @brief Adds a timer that fires as soon as @c advance() was called with a time of at least @c deadline
+	 */
+	void add(int64_t deadline, const T& value) {
+		// round up - otherwise the timer could fire before the deadline
+		int64_t tick = (deadline + _resolution - 1) / _resolution;
+		if (tick <= _current) {
+			tick = _current + 1;
+		}
+		_slots[tick % _slots.size()].push_back(Timer{tick, value});
+		++_size;
+	}
+
+	/**
+	 * @brief Moves the wheel to the given time and calls the functor for every timer that expired
+	 * @note Don't add timers from within the functor
+	 */
+	template<typename Func>
+	void advance(int64_t now, Func&& func) {
+		const int64_t target = now / _resolution;
+		if (target <= _current) {
+			return;
+		}
+		const int64_t steps = std::min(target - _current, static_cast<int64_t>(_slots.size()));
+		for (int64_t step = 1; step <= steps; ++step) {
+			Slot& slot = _slots[(_current + step) % _slots.size()];
+			for (std::size_t i = 0u; i < slot.size();) {
+				if (slot[i].tick > target) {
+					++i;
+					continue;
+				}
+				_expired.push_back(std::move(slot[i].value));
+				slot[i] = std::move(slot.back());
+				slot.pop_back();
+			}
+		}
+		_current = target;
+		_size -= _expired.size();
+		for (T& value : _expired) {
+			func(value);
+		}
+		_expired.clear();
+	}
+
+	/**
+	 * @return The amount of pending timers
+	 */
+	inline std::size_t size() const {
+		return _size;
+	}
+};
+
+}
@@ -40,7 +40,7 @@ inline ConditionPtr And::Factory::create(const ConditionFactoryContext *ctx) con
 	if (ctx->conditions.size() < 2) {
 		return ConditionPtr();
 	}
-	return std::make_shared<And>(ctx->conditions);
+	return makeShared<And>(ctx->conditions);
 }
 
 }
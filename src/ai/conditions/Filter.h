@@ -73,7 +73,7 @@ public:
 };
 
 inline ConditionPtr Filter::Factory::create(const ConditionFactoryContext *ctx) const {
-	return std::make_shared<Filter>(ctx->filters);
+	return makeShared<Filter>(ctx->filters);
 }
 
 }
@@ -0,0 +1,52 @@
+/**
+ * @file
+ * @ingroup Condition
+ */
+#pragma once
+
+#include "ICondition.h"
+#include "common/String.h"
+#include "zone/Zone.h"
+
+namespace ai {
+
+/**
+ * @brief Checks whether the value of an influence layer of the zone (see @c Zone::addInfluenceLayer())
+ * at the position of the controlled @c AI is greater than a threshold.
+ *
+ * The parameters are the name of the layer and the optional threshold (default is @c 0) - e.g.
+ * @c HasInfluence{threat,0.5}. Use @c Not to check whether an area is calm.
+ */
+class HasInfluence: public ICondition {
+private:
+	std::string _layer;
+	float _threshold;
+
+public:
+	CONDITION_FACTORY(HasInfluence)
+
+	explicit HasInfluence(const std::string& parameters) :
+		ICondition("HasInfluence", parameters), _threshold(0.0f) {
+		std::vector<std::string> tokens;
+		Str::splitString(_parameters, tokens, ",");
+		if (!tokens.empty()) {
+			_layer = tokens[0];
+		}
+		if (tokens.size() > 1) {
+			_threshold = Str::strToFloat(tokens[1]);
+		}
+	}
+
+	virtual ~HasInfluence() {
+	}
+
+	bool evaluate(const AIPtr& entity) override {
+		const Zone* zone = entity->getZone();
+		if (zone == nullptr) {
+			return false;
+		}
+		return zone->getInfluence(_layer, entity->getCharacter()->getPosition()) > _threshold;
+	}
+};
+
+}
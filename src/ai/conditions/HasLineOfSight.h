@@ -0,0 +1,51 @@
+/**
+ * @file
+ * @ingroup Condition
+ */
+#pragma once
+
+#include "ICondition.h"
+#include "zone/Zone.h"
+
+namespace ai {
+
+/**
+ * @brief Checks whether nothing blocks the view from the controlled @c AI to the first entity of the
+ * current selection (see @c Filter).
+ *
+ * Every evaluation submits a raycast to the @c IWorldQuery of the zone (see @c Zone::submitWorldQuery()) and
+ * evaluates to the result of the raycast of the previous update of the entity. So the result lags
+ * one update behind - and is @c false for the first evaluation.
+ */
+class HasLineOfSight: public ICondition {
+public:
+	CONDITION_FACTORY(HasLineOfSight)
+
+	explicit HasLineOfSight(const std::string& parameters) :
+		ICondition("HasLineOfSight", parameters) {
+	}
+
+	virtual ~HasLineOfSight() {
+	}
+
+	bool evaluate(const AIPtr& entity) override {
+		Zone* zone = entity->getZone();
+		if (zone == nullptr) {
+			return false;
+		}
+		const FilteredEntities& selection = entity->getFilteredEntities();
+		if (selection.empty()) {
+			return false;
+		}
+		const AIPtr& target = zone->getAI(selection.front());
+		if (!target) {
+			return false;
+		}
+		const glm::vec3& from = entity->getCharacter()->getPosition();
+		zone->submitWorldQuery(WorldQuery{WorldQueryType::Raycast, from, target->getCharacter()->getPosition(), entity->getId(), this});
+		const WorldQueryResult* result = entity->getWorldResults().get(this);
+		return result != nullptr && !result->success;
+	}
+};
+
+}
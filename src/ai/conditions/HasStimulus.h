@@ -0,0 +1,42 @@
+/**
+ * @file
+ * @ingroup Condition
+ */
+#pragma once
+
+#include "ICondition.h"
+#include "perception/PerceptionMemory.h"
+
+namespace ai {
+
+/**
+ * @brief Checks whether the @c AI remembers a stimulus (see @c Zone::emitStimulus())
+ *
+ * If a stimulus type is specified in the parameters (e.g. @c HasStimulus{2}), this condition only
+ * evaluates to @c true if the @c AI remembers a stimulus of that particular type.
+ */
+class HasStimulus: public ICondition {
+private:
+	StimulusType _type;
+
+public:
+	CONDITION_FACTORY(HasStimulus)
+
+	explicit HasStimulus(const std::string& parameters) :
+		ICondition("HasStimulus", parameters) {
+		if (_parameters.empty()) {
+			_type = -1;
+		} else {
+			_type = std::stoi(_parameters);
+		}
+	}
+
+	virtual ~HasStimulus() {
+	}
+
+	bool evaluate(const AIPtr& entity) override {
+		return entity->getPerception().has(_type);
+	}
+};
+
+}
@@ -57,7 +57,7 @@ public: \
 	class Factory: public ::ai::IConditionFactory { \
 	public: \
 		::ai::ConditionPtr create (const ::ai::ConditionFactoryContext *ctx) const override { \
-			return std::make_shared<ConditionName>(ctx->parameters); \
+			return ::ai::makeShared<ConditionName>(ctx->parameters); \
 		} \
 	}; \
 	static const Factory& getFactory() { \
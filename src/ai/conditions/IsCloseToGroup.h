@@ -54,7 +54,7 @@ public:
 		if (isInfinite(pos)) {
 			return false;
 		}
-		return glm::distance(pos, entity->getCharacter()->getPosition()) <= _distance;
+		return glm::distance2(pos, entity->getCharacter()->getPosition()) <= _distance * _distance;
 	}
 };
 
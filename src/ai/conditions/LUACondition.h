@@ -97,7 +97,7 @@ public:
 		}
 
 		ConditionPtr create(const ConditionFactoryContext* ctx) const override {
-			return std::make_shared<LUACondition>(_type, ctx->parameters, _s);
+			return makeShared<LUACondition>(_type, ctx->parameters, _s);
 		}
 	};
 
@@ -37,7 +37,7 @@ inline ConditionPtr Not::Factory::create(const ConditionFactoryContext *ctx) con
 	if (ctx->conditions.size() != 1) {
 		return ConditionPtr();
 	}
-	return std::make_shared<Not>(ctx->conditions.front());
+	return makeShared<Not>(ctx->conditions.front());
 }
 
 }
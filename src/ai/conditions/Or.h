@@ -40,7 +40,7 @@ inline ConditionPtr Or::Factory::create(const ConditionFactoryContext *ctx) cons
 	if (ctx->conditions.size() < 2) {
 		return ConditionPtr();
 	}
-	return std::make_shared<Or>(ctx->conditions);
+	return makeShared<Or>(ctx->conditions);
 }
 
 }
@@ -52,7 +52,7 @@ public: \
 	class Factory: public ::ai::IFilterFactory { \
 	public: \
 		::ai::FilterPtr create (const ::ai::FilterFactoryContext *ctx) const override { \
-			return std::make_shared<FilterName>(ctx->parameters); \
+			return ::ai::makeShared<FilterName>(ctx->parameters); \
 		} \
 	}; \
 	static const Factory& getFactory() { \
@@ -76,7 +76,7 @@ public: \
 	class Factory: public ::ai::IFilterFactory { \
 	public: \
 		::ai::FilterPtr create (const ::ai::FilterFactoryContext *ctx) const override { \
-			return std::make_shared<FilterName>(ctx->parameters, ctx->filters); \
+			return ::ai::makeShared<FilterName>(ctx->parameters, ctx->filters); \
 		} \
 	}; \
 	static const Factory& getFactory() { \
@@ -87,7 +87,7 @@ public:
 		}
 
 		FilterPtr create(const FilterFactoryContext* ctx) const override {
-			return std::make_shared<LUAFilter>(_type, ctx->parameters, _s);
+			return makeShared<LUAFilter>(_type, ctx->parameters, _s);
 		}
 	};
 
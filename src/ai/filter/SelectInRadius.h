@@ -0,0 +1,48 @@
+/**
+ * @file
+ * @ingroup Filter
+ */
+#pragma once
+
+#include "filter/IFilter.h"
+#include "zone/Zone.h"
+#include "common/String.h"
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief This filter will pick the entities of the zone that are not further away from the given entity
+ * than the radius that is given as parameter - e.g. @c SelectInRadius{10}. The entity itself is not selected.
+ *
+ * @note Enable the spatial grid of the zone (see @c Zone::setSpatialGrid) - otherwise every entity of
+ * the zone is checked.
+ */
+class SelectInRadius: public IFilter {
+protected:
+	float _radius;
+public:
+	FILTER_FACTORY(SelectInRadius)
+
+	explicit SelectInRadius(const std::string& parameters = "") :
+		IFilter("SelectInRadius", parameters) {
+		ai_assert(!_parameters.empty(), "SelectInRadius needs a radius as parameter");
+		_radius = Str::strToFloat(_parameters);
+	}
+
+	void filter (const AIPtr& entity) override {
+		const Zone* zone = entity->getZone();
+		if (zone == nullptr) {
+			return;
+		}
+		FilteredEntities& entities = getFilteredEntities(entity);
+		const std::size_t before = entities.size();
+		zone->queryRadius(entity->getCharacter()->getPosition(), _radius, entities);
+		auto self = std::find(entities.begin() + before, entities.end(), entity->getId());
+		if (self != entities.end()) {
+			entities.erase(self);
+		}
+	}
+};
+
+}
@@ -0,0 +1,59 @@
+/**
+ * @file
+ * @ingroup Filter
+ */
+#pragma once
+
+#include "filter/IFilter.h"
+#include "zone/Zone.h"
+#include "common/String.h"
+#include <limits>
+#include <vector>
+
+namespace ai {
+
+/**
+ * @brief This filter will pick the k entities of the zone that are closest to the given entity - ordered by
+ * their distance, the closest first. The entity itself is not selected.
+ *
+ * The parameters are the amount of entities and an optional max distance - e.g. @c SelectNearest{3} or
+ * @c SelectNearest{3,50}. The closest entity is the first one of the selection, so e.g. @c SelectionSeek
+ * or @c First work on it directly.
+ *
+ * @note Enable the spatial grid of the zone (see @c Zone::setSpatialGrid) - otherwise every entity of
+ * the zone is checked.
+ */
+class SelectNearest: public IFilter {
+protected:
+	std::size_t _k;
+	float _maxDistance;
+public:
+	FILTER_FACTORY(SelectNearest)
+
+	explicit SelectNearest(const std::string& parameters = "") :
+		IFilter("SelectNearest", parameters), _k(1u), _maxDistance(std::numeric_limits<float>::max()) {
+		std::vector<std::string> tokens;
+		Str::splitString(_parameters, tokens, ",");
+		if (!tokens.empty()) {
+			const int k = std::stoi(tokens[0]);
+			ai_assert(k >= 0, "SelectNearest needs a positive amount of entities");
+			_k = static_cast<std::size_t>(k);
+		}
+		if (tokens.size() > 1) {
+			_maxDistance = Str::strToFloat(tokens[1]);
+		}
+	}
+
+	void filter (const AIPtr& entity) override {
+		const Zone* zone = entity->getZone();
+		if (zone == nullptr) {
+			return;
+		}
+		const CharacterId self = entity->getId();
+		zone->queryNearest(entity->getCharacter()->getPosition(), _k, _maxDistance, getFilteredEntities(entity), [self] (CharacterId id) {
+			return id != self;
+		});
+	}
+};
+
+}
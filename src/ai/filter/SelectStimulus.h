@@ -0,0 +1,54 @@
+/**
+ * @file
+ * @ingroup Filter
+ */
+#pragma once
+
+#include "filter/IFilter.h"
+#include "perception/PerceptionMemory.h"
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief This filter will pick the sources of the stimuli the given entity remembers (see @c Zone::emitStimulus()) -
+ * the source of the most recent stimulus first.
+ *
+ * If a stimulus type is specified in the parameters (e.g. @c SelectStimulus{2}), only the sources of the stimuli
+ * of that particular type are selected.
+ */
+class SelectStimulus: public IFilter {
+protected:
+	StimulusType _type;
+public:
+	FILTER_FACTORY(SelectStimulus)
+
+	explicit SelectStimulus(const std::string& parameters = "") :
+		IFilter("SelectStimulus", parameters) {
+		if (_parameters.empty()) {
+			_type = -1;
+		} else {
+			_type = std::stoi(_parameters);
+		}
+	}
+
+	void filter (const AIPtr& entity) override {
+		FilteredEntities& entities = getFilteredEntities(entity);
+		const std::size_t before = entities.size();
+		const PerceptionMemory::Entries& perceived = entity->getPerception().getEntries();
+		for (auto i = perceived.rbegin(); i != perceived.rend(); ++i) {
+			if (_type != -1 && i->type != _type) {
+				continue;
+			}
+			if (i->source == AI_NOTHING_SELECTED) {
+				continue;
+			}
+			if (std::find(entities.begin() + before, entities.end(), i->source) != entities.end()) {
+				continue;
+			}
+			entities.push_back(i->source);
+		}
+	}
+};
+
+}
@@ -71,6 +71,7 @@ public:
 	 * whenever you destroy the @ai{AI} instance.
 	 * @return @c true if the add to the group was successful.
 	 *
+	 * @note Only the given @ai{AI} and the leader of the group are woken up
 	 * @note This method performs a write lock on the group manager
 	 */
 	bool add(GroupId id, const AIPtr& ai);
@@ -88,6 +89,7 @@ public:
 	 * @c false if the removal failed (e.g. the @ai{AI} instance was not part of
 	 * the group)
 	 *
+	 * @note Only the given @ai{AI} and the (new) leader of the group are woken up
 	 * @note This method performs a write lock on the group manager
 	 */
 	bool remove(GroupId id, const AIPtr& ai);
@@ -190,6 +192,12 @@ inline bool GroupMgr::add(GroupId id, const AIPtr& ai) {
 	std::pair<GroupMembersSetIter, bool> ret = group.members.insert(ai);
 	if (ret.second) {
 		_groupMembers.insert(GroupMembers::value_type(ai, id));
+		// the group changed - let the new member and the leader react to it. Waking all the members
+		// wouldn't scale with the size of the group.
+		ai->wake();
+		if (group.leader != ai) {
+			group.leader->wake();
+		}
 		return true;
 	}
 	return false;
@@ -215,10 +223,15 @@ inline bool GroupMgr::remove(GroupId id, const AIPtr& ai) {
 		group.members.erase(si);
 		if (group.members.empty()) {
 			_groups.erase(i);
-		} else if (group.leader == ai) {
-			group.leader = *group.members.begin();
+		} else {
+			if (group.leader == ai) {
+				group.leader = *group.members.begin();
+			}
+			// only the leader is woken up - just like in add()
+			group.leader->wake();
 		}
 	}
+	ai->wake();
 
 	auto range = _groupMembers.equal_range(ai);
 	for (auto it = range.first; it != range.second; ++it) {
@@ -0,0 +1,51 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "Steering.h"
+
+namespace ai {
+namespace movement {
+
+/**
+ * @brief Moves into the average direction the neighbours in the given radius are heading to
+ * (e.g. @c Alignment{5})
+ *
+ * @note Enable the spatial grid of the zone (see @c Zone::setSpatialGrid) - otherwise every entity of
+ * the zone is checked. The neighbours are shared with @c Separation and @c Cohesion (see @c Zone::getNeighbours()).
+ */
+class Alignment: public ISteering {
+protected:
+	float _radius;
+public:
+	STEERING_FACTORY(Alignment)
+
+	explicit Alignment(const std::string& parameters) :
+			ISteering() {
+		_radius = parameters.empty() ? 1.0f : Str::strToFloat(parameters);
+	}
+
+	virtual MoveVector execute (const AIPtr& ai, float speed) const override {
+		const Zone* zone = ai->getZone();
+		if (zone == nullptr) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		glm::vec3 heading(0.0f);
+		for (const Neighbour& neighbour : zone->getNeighbours(ai, _radius).get()) {
+			if (neighbour.distance <= _radius) {
+				heading += neighbour.heading;
+			}
+		}
+		if (glm::length2(heading) <= glm::epsilon<float>() * glm::epsilon<float>()) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& v = glm::normalize(heading);
+		const float orientation = angle(v);
+		const MoveVector d(v * speed, orientation);
+		return d;
+	}
+};
+
+}
+}
@@ -0,0 +1,56 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "Steering.h"
+
+namespace ai {
+namespace movement {
+
+/**
+ * @brief Moves to the center of the neighbours in the given radius (e.g. @c Cohesion{5})
+ *
+ * @note Enable the spatial grid of the zone (see @c Zone::setSpatialGrid) - otherwise every entity of
+ * the zone is checked. The neighbours are shared with @c Separation and @c Alignment (see @c Zone::getNeighbours()).
+ */
+class Cohesion: public ISteering {
+protected:
+	float _radius;
+public:
+	STEERING_FACTORY(Cohesion)
+
+	explicit Cohesion(const std::string& parameters) :
+			ISteering() {
+		_radius = parameters.empty() ? 1.0f : Str::strToFloat(parameters);
+	}
+
+	virtual MoveVector execute (const AIPtr& ai, float speed) const override {
+		const Zone* zone = ai->getZone();
+		if (zone == nullptr) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		glm::vec3 center(0.0f);
+		int n = 0;
+		for (const Neighbour& neighbour : zone->getNeighbours(ai, _radius).get()) {
+			if (neighbour.distance <= _radius) {
+				center += neighbour.position;
+				++n;
+			}
+		}
+		if (n == 0) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& direction = center / static_cast<float>(n) - ai->getCharacter()->getPosition();
+		if (glm::length2(direction) <= glm::epsilon<float>() * glm::epsilon<float>()) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& v = glm::normalize(direction);
+		const float orientation = angle(v);
+		const MoveVector d(v * speed, orientation);
+		return d;
+	}
+};
+
+}
+}
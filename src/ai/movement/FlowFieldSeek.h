@@ -0,0 +1,49 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "Steering.h"
+
+namespace ai {
+namespace movement {
+
+/**
+ * @brief Seeks a particular target around the blocked cells by sampling the flow field of the zone
+ * (see @c Zone::setFlowFields()) - e.g. @c FlowFieldSeek{10:0:20}
+ *
+ * All the entities that seek the same target share one field - so this is the steering for crowds.
+ * The result is invalid until the field for the target is built.
+ */
+class FlowFieldSeek: public ISteering {
+protected:
+	glm::vec3 _target;
+public:
+	STEERING_FACTORY(FlowFieldSeek)
+
+	explicit FlowFieldSeek(const std::string& parameters) :
+			ISteering() {
+		_target = parse(parameters);
+	}
+
+	inline bool isValid () const {
+		return !isInfinite(_target);
+	}
+
+	virtual MoveVector execute (const AIPtr& ai, float speed) const override {
+		const Zone* zone = ai->getZone();
+		if (!isValid() || zone == nullptr || !zone->getFlowFields()) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		glm::vec3 v;
+		if (!zone->getFlowFields()->getDirection(_target, ai->getCharacter()->getPosition(), v)) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const float orientation = angle(v);
+		const MoveVector d(v * speed, orientation);
+		return d;
+	}
+};
+
+}
+}
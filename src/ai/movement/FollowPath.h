@@ -0,0 +1,55 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "Steering.h"
+
+namespace ai {
+namespace movement {
+
+/**
+ * @brief Follows the path of the entity (see @c AI::getPathFollower()) - waypoint by waypoint and then the goal.
+ *
+ * The path is set by the @c MoveTo task. The optional parameter is the distance in which a waypoint
+ * counts as reached (default is @c 0.5).
+ */
+class FollowPath: public ISteering {
+protected:
+	float _reach;
+public:
+	STEERING_FACTORY(FollowPath)
+
+	explicit FollowPath(const std::string& parameters) :
+			ISteering(), _reach(0.5f) {
+		if (!parameters.empty()) {
+			_reach = Str::strToFloat(parameters);
+		}
+	}
+
+	inline float getReach() const {
+		return _reach;
+	}
+
+	virtual MoveVector execute (const AIPtr& ai, float speed) const override {
+		PathFollower& follower = ai->getPathFollower();
+		if (!follower.isActive()) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& position = ai->getCharacter()->getNextPosition();
+		const glm::vec3& target = follower.advance(position, _reach);
+		glm::vec3 v = target - position;
+		v.y = 0.0f;
+		const float length = glm::length(v);
+		if (length <= glm::epsilon<float>()) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		v /= length;
+		const float orientation = angle(v);
+		const MoveVector d(v * speed, orientation);
+		return d;
+	}
+};
+
+}
+}
@@ -0,0 +1,44 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "Steering.h"
+
+namespace ai {
+namespace movement {
+
+/**
+ * @brief Descends the gradient of an influence layer of the zone - e.g. to get away from the threats
+ *
+ * The parameter is the name of the layer (see @c Zone::addInfluenceLayer()). On a flat spot of the layer
+ * the result is invalid.
+ */
+class InfluenceFlee: public ISteering {
+protected:
+	std::string _layer;
+public:
+	STEERING_FACTORY(InfluenceFlee)
+
+	explicit InfluenceFlee(const std::string& parameters) :
+			ISteering(), _layer(parameters) {
+	}
+
+	virtual MoveVector execute (const AIPtr& ai, float speed) const override {
+		const Zone* zone = ai->getZone();
+		if (zone == nullptr) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& gradient = zone->getInfluenceGradient(_layer, ai->getCharacter()->getPosition());
+		if (glm::length2(gradient) <= glm::epsilon<float>() * glm::epsilon<float>()) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& v = -glm::normalize(gradient);
+		const float orientation = angle(v);
+		const MoveVector d(v * speed, orientation);
+		return d;
+	}
+};
+
+}
+}
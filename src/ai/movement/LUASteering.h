@@ -105,7 +105,7 @@ public:
 		}
 
 		SteeringPtr create(const SteeringFactoryContext* ctx) const override {
-			return std::make_shared<LUASteering>(_s, _type);
+			return makeShared<LUASteering>(_s, _type);
 		}
 	};
 
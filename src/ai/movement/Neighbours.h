@@ -0,0 +1,87 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "common/Math.h"
+#include "common/Types.h"
+#include <vector>
+
+namespace ai {
+
+/**
+ * @brief An entity close to the one that is updated - see @c Neighbours
+ */
+struct Neighbour {
+	CharacterId id;
+	glm::vec3 position;
+	/**
+	 * @brief The normalized direction the entity is looking to
+	 */
+	glm::vec3 heading;
+	float distance;
+};
+
+/**
+ * @brief The entities around an @c AI - gathered once per update by @c Zone::getNeighbours() and shared
+ * by all the steerings that look at the neighbours (see @c Separation, @c Alignment and @c Cohesion).
+ *
+ * The list holds the neighbours in the largest radius that was asked for in the current update. Smaller
+ * radii are answered from the same list.
+ */
+class Neighbours {
+private:
+	std::vector<Neighbour> _neighbours;
+	float _radius;
+	int _gathers;
+public:
+	Neighbours() :
+			_radius(-1.0f), _gathers(0) {
+	}
+
+	/**
+	 * @brief Marks the list as outdated - called at the start of every update of the @c AI
+	 */
+	inline void clear() {
+		_radius = -1.0f;
+	}
+
+	/**
+	 * @return @c true if the list contains all the neighbours in the given radius
+	 */
+	inline bool covers(float radius) const {
+		return radius <= _radius;
+	}
+
+	/**
+	 * @brief Starts a new gather for the given radius
+	 * @return The emptied list that is filled by the caller
+	 */
+	inline std::vector<Neighbour>& gather(float radius) {
+		_radius = radius;
+		_neighbours.clear();
+		++_gathers;
+		return _neighbours;
+	}
+
+	/**
+	 * @return The neighbours in the largest radius that was gathered in this update - check
+	 * @c Neighbour::distance for smaller radii
+	 */
+	inline const std::vector<Neighbour>& get() const {
+		return _neighbours;
+	}
+
+	inline float getRadius() const {
+		return _radius;
+	}
+
+	/**
+	 * @return The amount of times the neighbours were gathered
+	 */
+	inline int getGathers() const {
+		return _gathers;
+	}
+};
+
+}
@@ -0,0 +1,62 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "Steering.h"
+
+namespace ai {
+namespace movement {
+
+/**
+ * @brief Moves away from the neighbours in the given radius (e.g. @c Separation{2}) - the closer a
+ * neighbour is, the stronger it pushes. Combine it with other steerings in a @c Steer node to keep the
+ * members of a group from stacking on top of each other.
+ *
+ * @note Enable the spatial grid of the zone (see @c Zone::setSpatialGrid) - otherwise every entity of
+ * the zone is checked. The neighbours are shared with @c Alignment and @c Cohesion (see @c Zone::getNeighbours()).
+ */
+class Separation: public ISteering {
+protected:
+	float _radius;
+public:
+	STEERING_FACTORY(Separation)
+
+	explicit Separation(const std::string& parameters) :
+			ISteering() {
+		_radius = parameters.empty() ? 1.0f : Str::strToFloat(parameters);
+	}
+
+	virtual MoveVector execute (const AIPtr& ai, float speed) const override {
+		const Zone* zone = ai->getZone();
+		if (zone == nullptr) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& position = ai->getCharacter()->getPosition();
+		glm::vec3 push(0.0f);
+		for (const Neighbour& neighbour : zone->getNeighbours(ai, _radius).get()) {
+			if (neighbour.distance > _radius) {
+				continue;
+			}
+			if (neighbour.distance <= glm::epsilon<float>()) {
+				// on the same spot - the ids decide about the direction, so both move apart
+				const float sign = ai->getId() < neighbour.id ? 1.0f : -1.0f;
+				const float id = static_cast<float>(std::min(ai->getId(), neighbour.id));
+				push += sign * fromRadians(id * glm::golden_ratio<float>()) / glm::epsilon<float>();
+				continue;
+			}
+			// weighted by the inverse distance
+			push += (position - neighbour.position) / (neighbour.distance * neighbour.distance);
+		}
+		if (glm::length2(push) <= glm::epsilon<float>() * glm::epsilon<float>()) {
+			return MoveVector(VEC3_INFINITE, 0.0f);
+		}
+		const glm::vec3& v = glm::normalize(push);
+		const float orientation = angle(v);
+		const MoveVector d(v * speed, orientation);
+		return d;
+	}
+};
+
+}
+}
@@ -21,7 +21,7 @@ public: \
 	class Factory: public ::ai::ISteeringFactory { \
 	public: \
 		::ai::SteeringPtr create (const ::ai::SteeringFactoryContext *ctx) const override { \
-			return std::make_shared<SteeringName>(ctx->parameters); \
+			return ::ai::makeShared<SteeringName>(ctx->parameters); \
 		} \
 	}; \
 	static const Factory& getFactory() { \
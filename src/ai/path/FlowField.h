@@ -0,0 +1,367 @@
+/**
+ * @file
+ * @ingroup Path
+ */
+#pragma once
+
+#include "path/NavigationGrid.h"
+#include "common/Thread.h"
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <limits>
+
+namespace ai {
+
+/**
+ * @brief The cost of cells that have no way to the goal of a @c FlowField
+ */
+static const float FLOWFIELD_UNREACHABLE = std::numeric_limits<float>::max();
+
+/**
+ * @brief The way to one goal from every cell of a @c NavigationGrid - the result of one Dijkstra pass
+ * that starts at the goal cell.
+ *
+ * Each cell holds the cost of the way to the goal. The direction for a position is the step to the
+ * cheapest neighbour cell - so it can be sampled in O(1) by any amount of entities.
+ *
+ * The pass can be split over several calls (see @c build()). Until a new pass is finished, the result of
+ * the last one is sampled.
+ *
+ * @note Not thread safe - see @c FlowFields for the owner that builds and shares the fields
+ */
+class FlowField {
+private:
+	typedef std::pair<float, int> Open;
+	const int _goal;
+	// the result of the last finished pass
+	std::vector<float> _costs;
+	uint32_t _version;
+	// the pass that is in progress
+	std::vector<float> _building;
+	std::priority_queue<Open, std::vector<Open>, std::greater<Open> > _open;
+	uint32_t _buildVersion;
+	bool _isBuilding;
+	std::atomic<uint64_t> _lastUse;
+
+public:
+	explicit FlowField(int goal) :
+			_goal(goal), _version(0u), _buildVersion(0u), _isBuilding(false), _lastUse(0u) {
+	}
+
+	inline int getGoal() const {
+		return _goal;
+	}
+
+	/**
+	 * @return @c true if a pass was finished - the field can be sampled
+	 */
+	inline bool isReady() const {
+		return !_costs.empty();
+	}
+
+	inline bool isBuilding() const {
+		return _isBuilding;
+	}
+
+	/**
+	 * @return The version of the grid the sampled costs were built for
+	 */
+	inline uint32_t getVersion() const {
+		return _version;
+	}
+
+	inline uint32_t getBuildVersion() const {
+		return _buildVersion;
+	}
+
+	inline void use(uint64_t update) {
+		_lastUse = update;
+	}
+
+	inline uint64_t getLastUse() const {
+		return _lastUse;
+	}
+
+	/**
+	 * @brief Starts a new pass for the current state of the grid - a pass in progress is dropped
+	 */
+	void start(const NavigationGrid& grid);
+
+	/**
+	 * @brief Continues the pass that is in progress
+	 * @param budget The maximum amount of cells that are settled in this call
+	 * @return The amount of cells that were settled
+	 */
+	int build(const NavigationGrid& grid, int budget);
+
+	/**
+	 * @return The cost of the way from the given cell to the goal or @c FLOWFIELD_UNREACHABLE
+	 */
+	inline float getCost(int cell) const {
+		if (cell < 0 || static_cast<std::size_t>(cell) >= _costs.size()) {
+			return FLOWFIELD_UNREACHABLE;
+		}
+		return _costs[cell];
+	}
+
+	/**
+	 * @brief Writes the normalized direction in the x/z plane that leads to the goal
+	 * @param goal The position the entities approach in the goal cell
+	 * @return @c false if the position is outside of the grid, blocked or there is no way to the goal
+	 */
+	bool getDirection(const NavigationGrid& grid, const glm::vec3& goal, const glm::vec3& position, glm::vec3& direction) const;
+};
+
+inline void FlowField::start(const NavigationGrid& grid) {
+	_buildVersion = grid.getVersion();
+	_building.assign(static_cast<std::size_t>(grid.getCells()), FLOWFIELD_UNREACHABLE);
+	_open = decltype(_open)();
+	if (!grid.isBlocked(_goal)) {
+		_building[_goal] = 0.0f;
+		_open.emplace(0.0f, _goal);
+	}
+	_isBuilding = true;
+}
+
+inline int FlowField::build(const NavigationGrid& grid, int budget) {
+	if (!_isBuilding) {
+		return 0;
+	}
+	const int width = grid.getWidth();
+	const int height = grid.getHeight();
+	const int settled = grid.read([&] (const std::vector<uint8_t>& blocked) {
+		int n = 0;
+		while (!_open.empty() && n < budget) {
+			const Open current = _open.top();
+			_open.pop();
+			const int cell = current.second;
+			if (current.first > _building[cell]) {
+				// outdated entry - the cell was reached on a cheaper way
+				continue;
+			}
+			++n;
+			const int x = cell % width;
+			const int z = cell / width;
+			for (int dz = -1; dz <= 1; ++dz) {
+				for (int dx = -1; dx <= 1; ++dx) {
+					if (dx == 0 && dz == 0) {
+						continue;
+					}
+					const int nx = x + dx;
+					const int nz = z + dz;
+					if (nx < 0 || nz < 0 || nx >= width || nz >= height) {
+						continue;
+					}
+					const int neighbour = nz * width + nx;
+					if (blocked[neighbour]) {
+						continue;
+					}
+					// don't cut corners
+					if (dx != 0 && dz != 0 && (blocked[z * width + nx] || blocked[nz * width + x])) {
+						continue;
+					}
+					const float next = current.first + (dx != 0 && dz != 0 ? glm::root_two<float>() : 1.0f);
+					if (_building[neighbour] <= next) {
+						continue;
+					}
+					_building[neighbour] = next;
+					_open.emplace(next, neighbour);
+				}
+			}
+		}
+		return n;
+	});
+	if (_open.empty()) {
+		_costs.swap(_building);
+		_version = _buildVersion;
+		_isBuilding = false;
+	}
+	return settled;
+}
+
+inline bool FlowField::getDirection(const NavigationGrid& grid, const glm::vec3& goal, const glm::vec3& position, glm::vec3& direction) const {
+	const int cell = grid.getCell(position);
+	const float cost = getCost(cell);
+	if (cost == FLOWFIELD_UNREACHABLE) {
+		return false;
+	}
+	glm::vec3 target;
+	if (cell == _goal) {
+		target = goal;
+	} else {
+		const int width = grid.getWidth();
+		const int height = grid.getHeight();
+		const int x = cell % width;
+		const int z = cell / width;
+		int best = -1;
+		float bestCost = cost;
+		for (int dz = -1; dz <= 1; ++dz) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				const int nx = x + dx;
+				const int nz = z + dz;
+				if ((dx == 0 && dz == 0) || nx < 0 || nz < 0 || nx >= width || nz >= height) {
+					continue;
+				}
+				const int neighbour = nz * width + nx;
+				// blocked cells are unreachable - the same rule as for the corners in the pass
+				if (dx != 0 && dz != 0 && (_costs[z * width + nx] == FLOWFIELD_UNREACHABLE || _costs[nz * width + x] == FLOWFIELD_UNREACHABLE)) {
+					continue;
+				}
+				if (_costs[neighbour] < bestCost) {
+					bestCost = _costs[neighbour];
+					best = neighbour;
+				}
+			}
+		}
+		if (best == -1) {
+			return false;
+		}
+		target = grid.getPosition(best);
+	}
+	glm::vec3 v = target - position;
+	v.y = 0.0f;
+	const float length = glm::length(v);
+	if (length <= glm::epsilon<float>()) {
+		return false;
+	}
+	direction = v / length;
+	return true;
+}
+
+/**
+ * @brief Flow fields for all the goals the entities of a zone are heading to - built once per goal and
+ * shared by everyone who heads there (see @c Zone::setFlowFields() and the @c FlowFieldSeek steering).
+ *
+ * Sampling a goal that has no field yet requests one. The requested fields are built in @c update() - with
+ * a budget of settled cells per call, so a big grid doesn't stall a tick. If the grid changed (see
+ * @c NavigationGrid::setBlocked()) the fields are built again - the old ones are sampled in the meantime.
+ * Fields that weren't sampled for a while are dropped.
+ */
+class FlowFields {
+private:
+	typedef std::unordered_map<int, std::unique_ptr<FlowField> > Fields;
+	const std::shared_ptr<NavigationGrid> _grid;
+	const int _budget;
+	const uint64_t _keep;
+	Fields _fields;
+	std::atomic<uint64_t> _updates;
+	std::atomic<int> _settled;
+	mutable ReadWriteLock _lock {"flowfields"};
+	mutable std::mutex _requestMutex;
+	mutable std::vector<int> _requests;
+
+public:
+	/**
+	 * @param budget The maximum amount of cells that are settled per @c update() call over all fields
+	 * @param keep The amount of @c update() calls a field is kept without being sampled
+	 */
+	explicit FlowFields(const std::shared_ptr<NavigationGrid>& grid, int budget = 1 << 16, uint64_t keep = 600u) :
+			_grid(grid), _budget(budget), _keep(keep), _updates(0u), _settled(0) {
+		ai_assert(budget > 0, "Invalid budget given: %i", budget);
+	}
+
+	inline NavigationGrid& getGrid() const {
+		return *_grid;
+	}
+
+	/**
+	 * @brief Writes the normalized direction in the x/z plane that leads from the position to the goal
+	 * @return @c false if the field for the goal isn't built yet (it's requested then), or there is no way
+	 * from the position to the goal
+	 * @note This is thread safe
+	 */
+	bool getDirection(const glm::vec3& goal, const glm::vec3& position, glm::vec3& direction) const;
+
+	/**
+	 * @return The cost of the way from the position to the goal - or @c FLOWFIELD_UNREACHABLE if it's
+	 * unreachable or the field isn't built yet
+	 */
+	float getCost(const glm::vec3& goal, const glm::vec3& position) const;
+
+	/**
+	 * @brief Adds the requested fields, continues the passes and drops the unused fields
+	 */
+	void update();
+
+	/**
+	 * @return The amount of fields that are maintained
+	 */
+	int getFields() const;
+
+	/**
+	 * @return The amount of cells that were settled by all passes so far
+	 */
+	inline int getSettledCells() const {
+		return _settled;
+	}
+};
+
+inline bool FlowFields::getDirection(const glm::vec3& goal, const glm::vec3& position, glm::vec3& direction) const {
+	const int cell = _grid->getCell(goal);
+	if (cell < 0) {
+		return false;
+	}
+	ScopedReadLock scopedLock(_lock);
+	Fields::const_iterator i = _fields.find(cell);
+	if (i == _fields.end()) {
+		std::unique_lock<std::mutex> lock(_requestMutex);
+		_requests.push_back(cell);
+		return false;
+	}
+	i->second->use(_updates);
+	return i->second->getDirection(*_grid, goal, position, direction);
+}
+
+inline float FlowFields::getCost(const glm::vec3& goal, const glm::vec3& position) const {
+	ScopedReadLock scopedLock(_lock);
+	Fields::const_iterator i = _fields.find(_grid->getCell(goal));
+	if (i == _fields.end()) {
+		return FLOWFIELD_UNREACHABLE;
+	}
+	return i->second->getCost(_grid->getCell(position));
+}
+
+inline int FlowFields::getFields() const {
+	ScopedReadLock scopedLock(_lock);
+	return static_cast<int>(_fields.size());
+}
+
+inline void FlowFields::update() {
+	std::vector<int> requests;
+	{
+		std::unique_lock<std::mutex> lock(_requestMutex);
+		requests.swap(_requests);
+	}
+	ScopedWriteLock scopedLock(_lock);
+	const uint64_t update = ++_updates;
+	for (int cell : requests) {
+		std::unique_ptr<FlowField>& field = _fields[cell];
+		if (!field) {
+			field.reset(new FlowField(cell));
+			field->use(update);
+		}
+	}
+	const NavigationGrid& grid = *_grid;
+	const uint32_t version = grid.getVersion();
+	int budget = _budget;
+	for (Fields::iterator i = _fields.begin(); i != _fields.end();) {
+		FlowField& field = *i->second;
+		if (update - field.getLastUse() > _keep) {
+			i = _fields.erase(i);
+			continue;
+		}
+		if (field.isBuilding() ? field.getBuildVersion() != version : (!field.isReady() || field.getVersion() != version)) {
+			field.start(grid);
+		}
+		if (budget > 0) {
+			const int settled = field.build(grid, budget);
+			budget -= settled;
+			_settled += settled;
+		}
+		++i;
+	}
+}
+
+}
@@ -0,0 +1,143 @@
+/**
+ * @file
+ *
+ * @defgroup Path
+ * @{
+ * Path finding on a grid of walkable cells - see @ai{Pathfinder} and the @ai{MoveTo} task.
+ */
+#pragma once
+
+#include "common/Math.h"
+#include "common/Thread.h"
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief Walkable and blocked cells over the x/z plane - the graph the @c Pathfinder searches.
+ *
+ * Every change increments the version of the grid - paths that were found for an older version
+ * are not used anymore.
+ *
+ * The grid is thread safe: the searches read it while the game might block or free cells.
+ */
+class NavigationGrid {
+private:
+	const glm::vec3 _mins;
+	const float _cellSize;
+	const float _invCellSize;
+	const int _width;
+	const int _height;
+	std::vector<uint8_t> _blocked;
+	std::atomic<uint32_t> _version;
+	mutable ReadWriteLock _lock {"navigation-grid"};
+
+public:
+	/**
+	 * @param mins The lower corner of the covered area - the height is ignored
+	 * @param maxs The upper corner of the covered area - the height is ignored
+	 * @param cellSize The edge length of one cell
+	 */
+	NavigationGrid(const glm::vec3& mins, const glm::vec3& maxs, float cellSize) :
+			_mins(mins), _cellSize(cellSize), _invCellSize(1.0f / cellSize),
+			_width(std::max(1, static_cast<int>(std::ceil((maxs.x - mins.x) / cellSize)))),
+			_height(std::max(1, static_cast<int>(std::ceil((maxs.z - mins.z) / cellSize)))),
+			_blocked(static_cast<std::size_t>(_width) * _height, 0u), _version(0u) {
+		ai_assert(cellSize > 0.0f, "Invalid cell size given: %f", cellSize);
+	}
+
+	inline int getWidth() const {
+		return _width;
+	}
+
+	inline int getHeight() const {
+		return _height;
+	}
+
+	inline float getCellSize() const {
+		return _cellSize;
+	}
+
+	inline int getCells() const {
+		return _width * _height;
+	}
+
+	/**
+	 * @return The version of the grid - it changes with every @c setBlocked() call
+	 */
+	inline uint32_t getVersion() const {
+		return _version;
+	}
+
+	/**
+	 * @return The index of the cell the position is in - or @c -1 if the position is outside of the grid
+	 */
+	inline int getCell(const glm::vec3& position) const {
+		const int x = static_cast<int>(std::floor((position.x - _mins.x) * _invCellSize));
+		const int z = static_cast<int>(std::floor((position.z - _mins.z) * _invCellSize));
+		if (x < 0 || z < 0 || x >= _width || z >= _height) {
+			return -1;
+		}
+		return z * _width + x;
+	}
+
+	/**
+	 * @return The center of the given cell - at the height of @c mins
+	 */
+	inline glm::vec3 getPosition(int cell) const {
+		const int x = cell % _width;
+		const int z = cell / _width;
+		return glm::vec3(_mins.x + (static_cast<float>(x) + 0.5f) * _cellSize, _mins.y, _mins.z + (static_cast<float>(z) + 0.5f) * _cellSize);
+	}
+
+	/**
+	 * @brief Blocks or frees all the cells that overlap the given box
+	 */
+	void setBlocked(const glm::vec3& mins, const glm::vec3& maxs, bool blocked);
+
+	bool isBlocked(int cell) const;
+
+	/**
+	 * @brief Calls the functor while the grid can't be changed - e.g. for a search that checks many cells.
+	 * The functor gets the blocked flags of all cells.
+	 */
+	template<typename Func>
+	auto read(Func&& func) const -> decltype(func(_blocked)) {
+		ScopedReadLock scopedLock(_lock);
+		return func(_blocked);
+	}
+};
+
+inline void NavigationGrid::setBlocked(const glm::vec3& mins, const glm::vec3& maxs, bool blocked) {
+	const int x0 = std::max(0, static_cast<int>(std::floor((mins.x - _mins.x) * _invCellSize)));
+	const int z0 = std::max(0, static_cast<int>(std::floor((mins.z - _mins.z) * _invCellSize)));
+	const int x1 = std::min(_width - 1, static_cast<int>(std::floor((maxs.x - _mins.x) * _invCellSize)));
+	const int z1 = std::min(_height - 1, static_cast<int>(std::floor((maxs.z - _mins.z) * _invCellSize)));
+	{
+		ScopedWriteLock scopedLock(_lock);
+		for (int z = z0; z <= z1; ++z) {
+			for (int x = x0; x <= x1; ++x) {
+				_blocked[z * _width + x] = blocked ? 1u : 0u;
+			}
+		}
+	}
+	++_version;
+}
+
+inline bool NavigationGrid::isBlocked(int cell) const {
+	if (cell < 0 || cell >= getCells()) {
+		return true;
+	}
+	ScopedReadLock scopedLock(_lock);
+	return _blocked[cell] != 0u;
+}
+
+}
+
+/**
+ * @}
+ */
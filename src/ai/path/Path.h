@@ -0,0 +1,156 @@
+/**
+ * @file
+ * @ingroup Path
+ */
+#pragma once
+
+#include "common/Math.h"
+#include <vector>
+#include <memory>
+#include <future>
+#include <cstdint>
+
+namespace ai {
+
+/**
+ * @brief The waypoints from the start to the goal. The points are shared with the other paths that end
+ * in the same search result - a path for a cell on the way to the goal is just a later first waypoint.
+ */
+class Path {
+private:
+	std::shared_ptr<const std::vector<glm::vec3> > _points;
+	std::size_t _first;
+	uint32_t _version;
+public:
+	Path() :
+			_first(0u), _version(0u) {
+	}
+
+	Path(const std::shared_ptr<const std::vector<glm::vec3> >& points, std::size_t first, uint32_t version) :
+			_points(points), _first(first), _version(version) {
+	}
+
+	/**
+	 * @return @c false if no path was found
+	 */
+	inline bool isValid() const {
+		return (bool)_points;
+	}
+
+	inline std::size_t size() const {
+		return _points ? _points->size() - _first : 0u;
+	}
+
+	inline const glm::vec3& operator[](std::size_t index) const {
+		return (*_points)[_first + index];
+	}
+
+	/**
+	 * @return The version of the @c NavigationGrid the path was found for
+	 */
+	inline uint32_t getVersion() const {
+		return _version;
+	}
+};
+
+typedef std::shared_future<Path> PathFuture;
+
+/**
+ * @brief The path an @c AI follows - set by the @c MoveTo task and followed by the @c FollowPath steering
+ */
+class PathFollower {
+private:
+	Path _path;
+	std::size_t _index;
+	glm::vec3 _goal;
+	PathFuture _request;
+	glm::vec3 _requestGoal;
+	bool _requestApplied;
+public:
+	PathFollower() :
+			_index(0u), _goal(VEC3_INFINITE), _requestGoal(VEC3_INFINITE), _requestApplied(false) {
+	}
+
+	/**
+	 * @brief Follow the given path - after the last waypoint the exact goal is approached
+	 */
+	inline void setPath(const Path& path, const glm::vec3& goal) {
+		_path = path;
+		_index = 0u;
+		_goal = goal;
+		_requestApplied = true;
+	}
+
+	/**
+	 * @brief Change the goal that is approached after the last waypoint - e.g. if a target moved inside of its cell
+	 */
+	inline void setGoal(const glm::vec3& goal) {
+		_goal = goal;
+	}
+
+	inline const Path& getPath() const {
+		return _path;
+	}
+
+	inline const glm::vec3& getGoal() const {
+		return _goal;
+	}
+
+	/**
+	 * @return @c true if there is a path to follow
+	 */
+	inline bool isActive() const {
+		return _path.isValid();
+	}
+
+	inline void clear() {
+		_path = Path();
+		_index = 0u;
+		_goal = VEC3_INFINITE;
+		_request = PathFuture();
+		_requestGoal = VEC3_INFINITE;
+		_requestApplied = false;
+	}
+
+	/**
+	 * @brief Skips the waypoints that are closer than @c reach to the given position
+	 * @return The point that should be approached next - the goal after the last waypoint
+	 */
+	inline const glm::vec3& advance(const glm::vec3& position, float reach) {
+		const float reachSquared = reach * reach;
+		while (_index < _path.size()) {
+			const glm::vec3& waypoint = _path[_index];
+			if (glm::distance2(glm::vec3(waypoint.x, position.y, waypoint.z), position) > reachSquared) {
+				return waypoint;
+			}
+			++_index;
+		}
+		return _goal;
+	}
+
+	/**
+	 * @brief The pending path request of the @c MoveTo task
+	 */
+	inline void setRequest(const PathFuture& request, const glm::vec3& goal) {
+		_request = request;
+		_requestGoal = goal;
+		_requestApplied = false;
+	}
+
+	inline const PathFuture& getRequest() const {
+		return _request;
+	}
+
+	inline const glm::vec3& getRequestGoal() const {
+		return _requestGoal;
+	}
+
+	/**
+	 * @return @c true if the result of the pending request is already followed
+	 */
+	inline bool isRequestApplied() const {
+		return _requestApplied;
+	}
+};
+
+}
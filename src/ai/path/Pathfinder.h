@@ -0,0 +1,299 @@
+/**
+ * @file
+ * @ingroup Path
+ */
+#pragma once
+
+#include "path/NavigationGrid.h"
+#include "path/Path.h"
+#include "common/ThreadPool.h"
+#include <unordered_map>
+#include <list>
+#include <mutex>
+#include <memory>
+#include <queue>
+#include <limits>
+
+namespace ai {
+
+/**
+ * @brief A* on a @c NavigationGrid that runs on a @c ThreadPool - so the game tick doesn't wait for the searches.
+ *
+ * The results are cached by their start and goal cell. Requests for a pair that is already searched for
+ * get the pending future - and every cell of a found path gets a cache entry for the rest of the way. Those
+ * entries share the waypoints of the search and only store the offset of their first waypoint. So a
+ * crowd that is chasing the same target mostly ends up on paths that were found already. Entries of an
+ * older version of the grid (see @c NavigationGrid::setBlocked()) are searched again. If the cache is full,
+ * the least recently used entry is dropped.
+ */
+class Pathfinder {
+private:
+	/**
+	 * @brief Shared with the running searches - so they can finish after the pathfinder is gone
+	 */
+	struct Shared {
+		explicit Shared(const std::shared_ptr<NavigationGrid>& _grid, std::size_t _capacity) :
+				grid(_grid), capacity(_capacity), searches(0), hits(0) {
+		}
+		typedef std::list<uint64_t> Order;
+		struct Entry {
+			// the running search - invalid as soon as the path is known
+			PathFuture pending;
+			Path path;
+			uint32_t version;
+			Order::iterator used;
+		};
+		const std::shared_ptr<NavigationGrid> grid;
+		const std::size_t capacity;
+		std::mutex mutex;
+		std::unordered_map<uint64_t, Entry> cache;
+		// the keys of the cache - the most recently used one first
+		Order order;
+		std::atomic<int> searches;
+		std::atomic<int> hits;
+
+		static inline uint64_t key(int start, int goal) {
+			return (static_cast<uint64_t>(static_cast<uint32_t>(start)) << 32) | static_cast<uint32_t>(goal);
+		}
+
+		/**
+		 * @return The entry for the given version of the grid - or @c nullptr. Marks the entry as used.
+		 */
+		Entry* find(uint64_t k, uint32_t version) {
+			auto i = cache.find(k);
+			if (i == cache.end() || i->second.version != version) {
+				return nullptr;
+			}
+			order.splice(order.begin(), order, i->second.used);
+			return &i->second;
+		}
+
+		void insert(uint64_t k, const PathFuture& pending, const Path& path, uint32_t version) {
+			auto i = cache.find(k);
+			if (i == cache.end()) {
+				if (cache.size() >= capacity && !order.empty()) {
+					cache.erase(order.back());
+					order.pop_back();
+				}
+				order.push_front(k);
+				i = cache.emplace(k, Entry()).first;
+				i->second.used = order.begin();
+			} else {
+				order.splice(order.begin(), order, i->second.used);
+			}
+			i->second.pending = pending;
+			i->second.path = path;
+			i->second.version = version;
+		}
+	};
+	std::shared_ptr<Shared> _shared;
+	ThreadPool& _threadPool;
+
+	/**
+	 * @param request @c true if the search answers a @c findPath() request - its own cache entry gets the result
+	 */
+	static Path search(Shared& shared, int start, int goal, bool request);
+
+public:
+	/**
+	 * @param threadPool The pool that runs the searches - e.g. the one of the zone (see @c Zone::getThreadPool())
+	 * @param capacity The maximum amount of cache entries - the least recently used one is dropped if it's full
+	 */
+	Pathfinder(const std::shared_ptr<NavigationGrid>& grid, ThreadPool& threadPool, std::size_t capacity = 65536u) :
+			_shared(std::make_shared<Shared>(grid, capacity)), _threadPool(threadPool) {
+	}
+
+	inline NavigationGrid& getGrid() const {
+		return *_shared->grid;
+	}
+
+	/**
+	 * @brief Starts a search from the cell of @c start to the cell of @c goal - or returns the cached one.
+	 *
+	 * The waypoints are the centers of the cells on the way - the start cell is not part of it. The resulting
+	 * path is invalid if there is no way or one of the positions is blocked or outside of the grid.
+	 */
+	PathFuture findPath(const glm::vec3& start, const glm::vec3& goal);
+
+	/**
+	 * @brief Searches on the calling thread - without asking the cache first
+	 */
+	Path findPathNow(const glm::vec3& start, const glm::vec3& goal) const;
+
+	/**
+	 * @return The amount of searches that were started
+	 */
+	inline int getSearches() const {
+		return _shared->searches;
+	}
+
+	/**
+	 * @return The amount of requests that were answered by the cache or a pending search
+	 */
+	inline int getCacheHits() const {
+		return _shared->hits;
+	}
+
+	void clearCache();
+};
+
+inline Path Pathfinder::search(Shared& shared, int start, int goal, bool request) {
+	++shared.searches;
+	const NavigationGrid& grid = *shared.grid;
+	const uint32_t version = grid.getVersion();
+	if (start < 0 || goal < 0 || grid.isBlocked(goal)) {
+		return Path();
+	}
+	const int width = grid.getWidth();
+	const int cells = grid.getCells();
+
+	// reused by the searches of a worker - the stamps tell which entries belong to the current search
+	struct Scratch {
+		std::vector<float> costs;
+		std::vector<int> parents;
+		std::vector<uint32_t> stamps;
+		uint32_t stamp = 0u;
+	};
+	static thread_local Scratch scratch;
+	if (scratch.stamps.size() != static_cast<std::size_t>(cells)) {
+		scratch.costs.assign(cells, 0.0f);
+		scratch.parents.assign(cells, -1);
+		scratch.stamps.assign(cells, 0u);
+		scratch.stamp = 0u;
+	}
+	const uint32_t stamp = ++scratch.stamp;
+	const int gx = goal % width;
+	const int gz = goal / width;
+	auto heuristic = [gx, gz, width] (int cell) {
+		// octile distance in cells
+		const float dx = static_cast<float>(std::abs(cell % width - gx));
+		const float dz = static_cast<float>(std::abs(cell / width - gz));
+		return std::max(dx, dz) + (glm::root_two<float>() - 1.0f) * std::min(dx, dz);
+	};
+
+	typedef std::pair<float, int> Open;
+	std::priority_queue<Open, std::vector<Open>, std::greater<Open> > open;
+	const bool found = grid.read([&] (const std::vector<uint8_t>& blocked) {
+		scratch.costs[start] = 0.0f;
+		scratch.parents[start] = -1;
+		scratch.stamps[start] = stamp;
+		open.emplace(heuristic(start), start);
+		while (!open.empty()) {
+			const Open current = open.top();
+			open.pop();
+			const int cell = current.second;
+			const float cost = scratch.costs[cell];
+			if (current.first > cost + heuristic(cell) + 0.0001f) {
+				// outdated entry - the cell was reached on a cheaper way
+				continue;
+			}
+			if (cell == goal) {
+				return true;
+			}
+			const int x = cell % width;
+			const int z = cell / width;
+			for (int dz = -1; dz <= 1; ++dz) {
+				for (int dx = -1; dx <= 1; ++dx) {
+					if (dx == 0 && dz == 0) {
+						continue;
+					}
+					const int nx = x + dx;
+					const int nz = z + dz;
+					if (nx < 0 || nz < 0 || nx >= width || nz >= grid.getHeight()) {
+						continue;
+					}
+					const int neighbour = nz * width + nx;
+					if (blocked[neighbour]) {
+						continue;
+					}
+					// don't cut corners
+					if (dx != 0 && dz != 0 && (blocked[z * width + nx] || blocked[nz * width + x])) {
+						continue;
+					}
+					const float next = cost + (dx != 0 && dz != 0 ? glm::root_two<float>() : 1.0f);
+					if (scratch.stamps[neighbour] == stamp && scratch.costs[neighbour] <= next) {
+						continue;
+					}
+					scratch.stamps[neighbour] = stamp;
+					scratch.costs[neighbour] = next;
+					scratch.parents[neighbour] = cell;
+					open.emplace(next + heuristic(neighbour), neighbour);
+				}
+			}
+		}
+		return false;
+	});
+	if (!found) {
+		return Path();
+	}
+	std::vector<int> way;
+	for (int cell = goal; cell != start; cell = scratch.parents[cell]) {
+		way.push_back(cell);
+	}
+	std::shared_ptr<std::vector<glm::vec3> > points = std::make_shared<std::vector<glm::vec3> >();
+	points->reserve(way.size());
+	for (auto i = way.rbegin(); i != way.rend(); ++i) {
+		points->push_back(grid.getPosition(*i));
+	}
+	const Path path(points, 0u, version);
+
+	// every cell on the way has a path to the goal now - they all share the points of this search
+	std::unique_lock<std::mutex> lock(shared.mutex);
+	for (std::size_t i = 0u; i + 1u < way.size(); ++i) {
+		const int cell = way[way.size() - 1u - i];
+		const uint64_t key = Shared::key(cell, goal);
+		auto entry = shared.cache.find(key);
+		if (entry != shared.cache.end() && entry->second.version == version) {
+			continue;
+		}
+		shared.insert(key, PathFuture(), Path(points, i + 1u, version), version);
+	}
+	// the entry of the request itself is stored last - so the entries of its way are dropped first
+	if (request) {
+		shared.insert(Shared::key(start, goal), PathFuture(), path, version);
+	}
+	return path;
+}
+
+inline PathFuture Pathfinder::findPath(const glm::vec3& start, const glm::vec3& goal) {
+	const NavigationGrid& grid = *_shared->grid;
+	const int startCell = grid.getCell(start);
+	const int goalCell = grid.getCell(goal);
+	const uint64_t key = Shared::key(startCell, goalCell);
+	const uint32_t version = grid.getVersion();
+	const std::shared_ptr<std::promise<Path> > promise = std::make_shared<std::promise<Path> >();
+	const PathFuture future = promise->get_future().share();
+	{
+		std::unique_lock<std::mutex> lock(_shared->mutex);
+		const Shared::Entry* entry = _shared->find(key, version);
+		if (entry != nullptr) {
+			++_shared->hits;
+			if (entry->pending.valid()) {
+				return entry->pending;
+			}
+			std::promise<Path> ready;
+			ready.set_value(entry->path);
+			return ready.get_future().share();
+		}
+		_shared->insert(key, future, Path(), version);
+	}
+	// not scheduled while the cache is locked - a pool without workers runs the search right away
+	const std::shared_ptr<Shared> shared = _shared;
+	_threadPool.schedule([shared, promise, startCell, goalCell] () {
+		promise->set_value(search(*shared, startCell, goalCell, true));
+	});
+	return future;
+}
+
+inline Path Pathfinder::findPathNow(const glm::vec3& start, const glm::vec3& goal) const {
+	const NavigationGrid& grid = *_shared->grid;
+	return search(*_shared, grid.getCell(start), grid.getCell(goal), false);
+}
+
+inline void Pathfinder::clearCache() {
+	std::unique_lock<std::mutex> lock(_shared->mutex);
+	_shared->cache.clear();
+	_shared->order.clear();
+}
+
+}
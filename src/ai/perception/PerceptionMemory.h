@@ -0,0 +1,120 @@
+/**
+ * @file
+ * @ingroup Perception
+ */
+#pragma once
+
+#include "perception/Stimulus.h"
+#include <vector>
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief Remembers the stimuli an @c AI perceived for a while. Filled by the @c Zone before the entities
+ * are updated, read by e.g. the @c HasStimulus condition and the @c SelectStimulus filter.
+ *
+ * A stimulus of the same type and source that is perceived again replaces the old one - so a
+ * repeated noise doesn't flood the memory.
+ */
+class PerceptionMemory {
+public:
+	struct Perceived {
+		StimulusType type;
+		glm::vec3 position;
+		CharacterId source;
+		/**
+		 * @brief The time of the @c AI (see @c AI::getTime()) when the stimulus was perceived
+		 */
+		int64_t time;
+	};
+	typedef std::vector<Perceived> Entries;
+
+protected:
+	// ordered by the time they were perceived - the oldest first
+	Entries _entries;
+	int64_t _memoryMillis;
+	std::size_t _capacity;
+
+public:
+	/**
+	 * @param memoryMillis How long a stimulus is remembered
+	 * @param capacity How many stimuli are remembered - the oldest is forgotten if there are more
+	 */
+	explicit PerceptionMemory(int64_t memoryMillis = 1000, std::size_t capacity = 16u) :
+			_memoryMillis(memoryMillis), _capacity(std::max(std::size_t(1u), capacity)) {
+	}
+
+	inline void setMemoryMillis(int64_t memoryMillis) {
+		_memoryMillis = memoryMillis;
+	}
+
+	inline int64_t getMemoryMillis() const {
+		return _memoryMillis;
+	}
+
+	/**
+	 * @brief Remember the given stimulus
+	 * @param time The time of the @c AI when it was perceived
+	 */
+	void perceive(const Stimulus& stimulus, int64_t time);
+
+	/**
+	 * @brief Forget the stimuli that are older than the memory time
+	 * @param time The current time of the @c AI
+	 */
+	void update(int64_t time);
+
+	/**
+	 * @param type The type of the stimulus - @c -1 for any
+	 */
+	bool has(StimulusType type = -1) const;
+
+	inline const Entries& getEntries() const {
+		return _entries;
+	}
+
+	inline bool empty() const {
+		return _entries.empty();
+	}
+
+	inline void clear() {
+		_entries.clear();
+	}
+};
+
+inline void PerceptionMemory::perceive(const Stimulus& stimulus, int64_t time) {
+	auto i = std::find_if(_entries.begin(), _entries.end(), [&] (const Perceived& p) {
+		return p.type == stimulus.type && p.source == stimulus.source;
+	});
+	if (i != _entries.end()) {
+		_entries.erase(i);
+	} else if (_entries.size() >= _capacity) {
+		_entries.erase(_entries.begin());
+	}
+	_entries.push_back(Perceived{stimulus.type, stimulus.position, stimulus.source, time});
+}
+
+inline void PerceptionMemory::update(int64_t time) {
+	if (_entries.empty()) {
+		return;
+	}
+	auto i = std::find_if(_entries.begin(), _entries.end(), [&] (const Perceived& p) {
+		return time - p.time <= _memoryMillis;
+	});
+	_entries.erase(_entries.begin(), i);
+}
+
+inline bool PerceptionMemory::has(StimulusType type) const {
+	if (type == -1) {
+		return !_entries.empty();
+	}
+	for (const Perceived& p : _entries) {
+		if (p.type == type) {
+			return true;
+		}
+	}
+	return false;
+}
+
+}
@@ -0,0 +1,44 @@
+/**
+ * @file
+ *
+ * @defgroup Perception
+ * @{
+ * Stimuli like noise, deaths or alarms are emitted into a @ai{Zone} and delivered to the
+ * @ai{PerceptionMemory} of every @ai{AI} in their radius.
+ */
+#pragma once
+
+#include "common/Math.h"
+#include "common/Types.h"
+#include "common/ShardedQueue.h"
+
+namespace ai {
+
+/**
+ * @brief Identifies the kind of a stimulus - the meaning is up to the application (e.g. noise, death, alarm)
+ */
+typedef int StimulusType;
+
+/**
+ * @brief Something that happened at a position and that can be perceived by the entities in the given radius
+ */
+struct Stimulus {
+	StimulusType type;
+	glm::vec3 position;
+	float radius;
+	/**
+	 * @brief The entity that caused the stimulus (e.g. the one who shot) - or @c -1 if there is none
+	 */
+	CharacterId source;
+};
+
+/**
+ * @brief Collects the emitted @c Stimulus instances from any thread
+ */
+typedef ShardedQueue<Stimulus> StimulusQueue;
+
+}
+
+/**
+ * @}
+ */
@@ -92,7 +92,8 @@ inline bool Server::start() {
 }
 
 inline void Server::addChildren(const TreeNodePtr& node, std::vector<AIStateNodeStatic>& out) const {
-	for (const TreeNodePtr& childNode : node->getChildren()) {
+	const TreeNode& parent = *node;
+	for (const TreeNodePtr& childNode : parent.getChildren()) {
 		const int32_t nodeId = childNode->getId();
 		out.push_back(AIStateNodeStatic(nodeId, childNode->getName(), childNode->getType(), childNode->getParameters(), childNode->getCondition()->getName(), childNode->getCondition()->getParameters()));
 		addChildren(childNode, out);
@@ -100,7 +101,7 @@ inline void Server::addChildren(const TreeNodePtr& node, std::vector<AIStateNode
 }
 
 inline void Server::addChildren(const TreeNodePtr& node, AIStateNode& parent, const AIPtr& ai) const {
-	const TreeNodes& children = node->getChildren();
+	const TreeNodes& children = static_cast<const TreeNode&>(*node).getChildren();
 	std::vector<bool> currentlyRunning(children.size());
 	node->getRunningChildren(ai, currentlyRunning);
 	const int64_t aiTime = ai->_time;
@@ -192,7 +193,7 @@ inline void Server::broadcastCharacterDetails(const Zone* zone) {
 inline void Server::handleEvents(Zone* zone, bool pauseState) {
 	std::vector<Event> events;
 	{
-		ScopedReadLock scopedLock(_lock);
+		ScopedWriteLock scopedLock(_lock);
 		events = std::move(_events);
 		_events.clear();
 	}
@@ -221,7 +222,7 @@ inline void Server::handleEvents(Zone* zone, bool pauseState) {
 				ai->getBehaviour()->execute(ai, queuedStepMillis);
 				ai->setPause(true);
 			};
-			zone->executeParallel(func);
+			zone->parallelFor(func);
 			broadcastState(zone);
 			broadcastCharacterDetails(zone);
 			break;
@@ -230,7 +231,7 @@ inline void Server::handleEvents(Zone* zone, bool pauseState) {
 			static auto func = [] (const AIPtr& ai) {
 				ai->getBehaviour()->resetState(ai);
 			};
-			event.data.zone->executeParallel(func);
+			event.data.zone->parallelFor(func);
 			break;
 		}
 		case EV_PAUSE: {
@@ -240,7 +241,7 @@ inline void Server::handleEvents(Zone* zone, bool pauseState) {
 				auto func = [=] (const AIPtr& ai) {
 					ai->setPause(newPauseState);
 				};
-				zone->executeParallel(func);
+				zone->parallelFor(func);
 				_network.broadcast(AIPauseMessage(newPauseState));
 				// send the last time the most recent state until we unpause
 				if (newPauseState) {
@@ -337,7 +338,8 @@ inline bool Server::updateNode(const CharacterId& characterId, int32_t nodeId, c
 		return false;
 	}
 	newNode->setCondition(conditionPtr);
-	for (auto& child : node->getChildren()) {
+	const TreeNode& oldNode = *node;
+	for (const TreeNodePtr& child : oldNode.getChildren()) {
 		newNode->addChild(child);
 	}
 
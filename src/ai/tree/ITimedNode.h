@@ -21,14 +21,15 @@ namespace ai {
 
 /**
  * @brief A timed node is a @c TreeNode that is executed until a given time (millis) is elapsed.
+ *
+ * The timer is stored per @c AI - so one node instance can be shared by all the entities that use the tree.
  */
 class ITimedNode : public TreeNode {
 protected:
-	int64_t _timerMillis;
 	int64_t _millis;
 public:
 	ITimedNode(const std::string& name, const std::string& parameters, const ConditionPtr& condition) :
-			TreeNode(name, parameters, condition), _timerMillis(NOTSTARTED) {
+			TreeNode(name, parameters, condition) {
 		if (!parameters.empty()) {
 			_millis = ::atol(parameters.c_str());
 		} else {
@@ -42,23 +43,24 @@ public:
 		if (result == CANNOTEXECUTE)
 			return CANNOTEXECUTE;
 
-		if (_timerMillis == NOTSTARTED) {
-			_timerMillis = _millis;
+		const int64_t timerMillis = getTimerState(entity);
+		if (timerMillis == NOTSTARTED) {
+			setTimerState(entity, _millis);
 			const TreeNodeStatus status = executeStart(entity, deltaMillis);
 			if (status == FINISHED)
-				_timerMillis = NOTSTARTED;
+				setTimerState(entity, NOTSTARTED);
 			return state(entity, status);
 		}
 
-		if (_timerMillis - deltaMillis > 0) {
-			_timerMillis -= deltaMillis;
+		if (timerMillis - deltaMillis > 0) {
+			setTimerState(entity, timerMillis - deltaMillis);
 			const TreeNodeStatus status = executeRunning(entity, deltaMillis);
 			if (status == FINISHED)
-				_timerMillis = NOTSTARTED;
+				setTimerState(entity, NOTSTARTED);
 			return state(entity, status);
 		}
 
-		_timerMillis = NOTSTARTED;
+		setTimerState(entity, NOTSTARTED);
 		return state(entity, executeExpired(entity, deltaMillis));
 	}
 
@@ -102,7 +102,7 @@ public:
 		}
 
 		TreeNodePtr create(const TreeNodeFactoryContext* ctx) const override {
-			return std::make_shared<LUATreeNode>(ctx->name, ctx->parameters, ctx->condition, _s, _type);
+			return makeShared<LUATreeNode>(ctx->name, ctx->parameters, ctx->condition, _s, _type);
 		}
 	};
 
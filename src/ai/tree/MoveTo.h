@@ -0,0 +1,119 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "tree/ITask.h"
+#include "movement/FollowPath.h"
+#include "path/Pathfinder.h"
+#include "zone/Zone.h"
+#include <chrono>
+
+namespace ai {
+
+/**
+ * @brief Moves the character to the given position (e.g. @c MoveTo{10:0:20}) - or to the first entity of the
+ * current selection if no position is given - around the blocked cells of the @c Pathfinder of the zone
+ * (see @c Zone::setPathfinder()).
+ *
+ * The path is searched on the thread pool. The task is @c RUNNING while the search is pending and while the
+ * character is on its way, @c FINISHED once the goal is reached and @c FAILED if there is no way.
+ * A new path is requested if the goal moved to another cell or the grid changed - in the meantime the
+ * old path is followed.
+ *
+ * @sa FollowPath to blend the path with other steerings in a @c Steer node
+ */
+class MoveTo: public ITask {
+protected:
+	glm::vec3 _target;
+	const movement::FollowPath _follow;
+
+	glm::vec3 getGoal(const AIPtr& entity) const {
+		if (!isInfinite(_target)) {
+			return _target;
+		}
+		const FilteredEntities& selection = entity->getFilteredEntities();
+		if (selection.empty()) {
+			return VEC3_INFINITE;
+		}
+		const AIPtr& ai = entity->getZone()->getAI(selection.front());
+		if (!ai) {
+			return VEC3_INFINITE;
+		}
+		return ai->getCharacter()->getPosition();
+	}
+
+public:
+	MoveTo(const std::string& name, const std::string& parameters, const ConditionPtr& condition) :
+			ITask(name, parameters, condition), _target(VEC3_INFINITE), _follow("") {
+		_type = "MoveTo";
+		if (!parameters.empty()) {
+			_target = parse(parameters);
+		}
+	}
+	virtual ~MoveTo() {
+	}
+
+	NODE_FACTORY(MoveTo)
+
+	TreeNodeStatus doAction(const AIPtr& entity, int64_t deltaMillis) override {
+		const Zone* zone = entity->getZone();
+		if (zone == nullptr || !zone->getPathfinder()) {
+			return FAILED;
+		}
+		Pathfinder& pathfinder = *zone->getPathfinder();
+		const glm::vec3& goal = getGoal(entity);
+		if (isInfinite(goal)) {
+			return FAILED;
+		}
+		const ICharacterPtr& chr = entity->getCharacter();
+		const glm::vec3& position = chr->getNextPosition();
+		PathFollower& follower = entity->getPathFollower();
+		const float reach = _follow.getReach();
+		if (glm::distance2(glm::vec3(goal.x, position.y, goal.z), position) <= reach * reach) {
+			follower.clear();
+			return FINISHED;
+		}
+
+		const NavigationGrid& grid = pathfinder.getGrid();
+		const glm::vec3& requestGoal = follower.getRequestGoal();
+		const bool goalMoved = isInfinite(requestGoal) || grid.getCell(requestGoal) != grid.getCell(goal);
+		const bool outdated = follower.isActive() && follower.getPath().getVersion() != grid.getVersion();
+		if (!follower.getRequest().valid() || goalMoved || outdated) {
+			follower.setRequest(pathfinder.findPath(position, goal), goal);
+		}
+		const PathFuture& request = follower.getRequest();
+		if (!follower.isRequestApplied() && request.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+			const Path& path = request.get();
+			if (!path.isValid()) {
+				follower.clear();
+				return FAILED;
+			}
+			follower.setPath(path, goal);
+		}
+		if (!follower.isActive()) {
+			// the first search is still pending
+			return RUNNING;
+		}
+		follower.setGoal(goal);
+
+		const MoveVector& mv = _follow.execute(entity, chr->getSpeed());
+		if (isInfinite(mv.getVector())) {
+			return RUNNING;
+		}
+		const float deltaSeconds = static_cast<float>(deltaMillis) / 1000.0f;
+		glm::vec3 step = mv.getVector() * deltaSeconds;
+		// don't overshoot the waypoint (or the goal) - it would not count as reached otherwise
+		const glm::vec3& target = follower.advance(position, reach);
+		const float remaining = glm::distance(glm::vec3(target.x, position.y, target.z), position);
+		const float length = glm::length(step);
+		if (length > remaining) {
+			step *= remaining / length;
+		}
+		chr->setPosition(position + step);
+		chr->setOrientation(mv.getRotation());
+		return RUNNING;
+	}
+};
+
+}
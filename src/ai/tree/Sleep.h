@@ -0,0 +1,45 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "tree/ITask.h"
+#include <stdlib.h>
+
+namespace ai {
+
+/**
+ * @brief Puts the @c AI to sleep for the given millis - or until it is woken up if no parameter
+ * is given. A sleeping @c AI costs nothing in the zone update. It is woken up earlier by new aggro,
+ * changes of its groups or an explicit @c AI::wake() call.
+ *
+ * The remaining nodes of the current tick are still executed - the sleep starts after the tick.
+ * Use it e.g. as the last child of a @ai{PrioritySelector} for entities that have nothing to do.
+ *
+ * @sa AI::sleep()
+ */
+class Sleep: public ITask {
+protected:
+	int64_t _millis;
+public:
+	Sleep(const std::string& name, const std::string& parameters, const ConditionPtr& condition) :
+			ITask(name, parameters, condition) {
+		_type = "Sleep";
+		if (!parameters.empty()) {
+			_millis = ::atol(parameters.c_str());
+		} else {
+			_millis = -1L;
+		}
+	}
+	virtual ~Sleep() {
+	}
+
+	NODE_FACTORY(Sleep)
+
+	TreeNodeStatus doAction(const AIPtr& entity, int64_t /*deltaMillis*/) override {
+		entity->sleep(_millis);
+		return FINISHED;
+	}
+};
+
+}
@@ -40,7 +40,7 @@ public:
 				}
 			}
 			const movement::WeightedSteering w(weightedSteerings);
-			return std::make_shared<Steer>(ctx->name, ctx->parameters, ctx->condition, w);
+			return makeShared<Steer>(ctx->name, ctx->parameters, ctx->condition, w);
 		}
 	};
 	static const Factory& getFactory() {
@@ -56,8 +56,9 @@ public:
 		}
 
 		const float deltaSeconds = static_cast<float>(deltaMillis) / 1000.0f;
-		chr->setPosition(chr->getPosition() + (mv.getVector() * deltaSeconds));
-		chr->setOrientation(fmodf(chr->getOrientation() + mv.getRotation() * deltaSeconds, glm::two_pi<float>()));
+		// build upon the pending values - another node might already have moved the character in this tick
+		chr->setPosition(chr->getNextPosition() + (mv.getVector() * deltaSeconds));
+		chr->setOrientation(fmodf(chr->getNextOrientation() + mv.getRotation() * deltaSeconds, glm::two_pi<float>()));
 		return FINISHED;
 	}
 };
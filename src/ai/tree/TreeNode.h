@@ -11,6 +11,8 @@
 #include <string>
 #include <memory>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 
 namespace ai {
 
@@ -18,6 +20,10 @@ class TreeNode;
 typedef std::shared_ptr<TreeNode> TreeNodePtr;
 typedef std::vector<TreeNodePtr> TreeNodes;
 
+#ifndef AI_NOTHING_SELECTED
+#define AI_NOTHING_SELECTED (-1)
+#endif
+
 /**
  * @brief Execution states of a TreeNode::execute() call
  */
@@ -55,7 +61,7 @@ enum TreeNodeStatus {
 	class Factory: public ::ai::ITreeNodeFactory { \
 	public: \
 		::ai::TreeNodePtr create (const ::ai::TreeNodeFactoryContext *ctx) const override { \
-			return std::make_shared<NodeName>(ctx->name, ctx->parameters, ctx->condition); \
+			return ::ai::makeShared<NodeName>(ctx->name, ctx->parameters, ctx->condition); \
 		} \
 	}; \
 	static const Factory& getFactory() { \
@@ -76,6 +82,62 @@ enum TreeNodeStatus {
 	\
 	NODE_FACTORY(NodeName)
 
+/**
+ * @brief The state of one @c TreeNode for one @c AI - see @c TreeNode::getIndex()
+ */
+struct TreeNodeState {
+	/**
+	 * Often @ai{Selector} states must be stored to continue in the next step at a particular
+	 * position in the behaviour tree.
+	 */
+	int selector;
+	/**
+	 * The amount of executions for the @ai{Limit} node
+	 */
+	int limit;
+	/**
+	 * Only recorded if we are in debugging mode for the entity
+	 */
+	TreeNodeStatus lastStatus;
+	/**
+	 * Only recorded if we are in debugging mode for the entity
+	 */
+	int64_t lastExecMillis;
+	/**
+	 * The remaining millis of an @ai{ITimedNode} - @c -1 if the timer is not started
+	 */
+	int64_t timerMillis;
+
+	TreeNodeState() :
+			selector(AI_NOTHING_SELECTED), limit(0), lastStatus(UNKNOWN), lastExecMillis(-1L), timerMillis(-1L) {
+	}
+};
+
+/**
+ * @brief The numbering of the state slots of one behaviour tree - see @c TreeNode::index()
+ */
+struct TreeIndex {
+	/**
+	 * @brief The amount of slots that were handed out - the next node that is indexed gets this one
+	 */
+	std::atomic<int> slots;
+	/**
+	 * @brief Bumped whenever a node of the tree gets a new child or condition - compiled programs
+	 * (see @c TreeProgram) of the tree are outdated then
+	 */
+	std::atomic<uint32_t> version;
+	/**
+	 * @brief Set if the children of a node were handed out for changing (see @c TreeNode::getChildren()) - the
+	 * next @c TreeNode::index() call of the root looks for the nodes without an index then
+	 */
+	std::atomic_bool stale;
+
+	TreeIndex() :
+			slots(0), version(0u), stale(false) {
+	}
+};
+typedef std::shared_ptr<TreeIndex> TreeIndexPtr;
+
 /**
  * @brief The base class for all behaviour tree actions.
  *
@@ -86,27 +148,67 @@ enum TreeNodeStatus {
  * to store your state!
  */
 class TreeNode : public MemObject {
+	friend class TreeProgram;
+	friend class AI;
 protected:
 	static int getNextId() {
 		static int _nextId;
 		const int nextId = _nextId++;
 		return nextId;
 	}
+	static std::mutex& getIndexMutex() {
+		static std::mutex _mutex;
+		return _mutex;
+	}
 	/**
 	 * @brief Every node has an id to identify it. It's unique per type.
 	 */
 	int _id;
+	/**
+	 * @brief The numbering the node got its index from - set once by @c index() and never changed afterwards
+	 */
+	TreeIndexPtr _treeIndex;
+	/**
+	 * @brief The same as @c _treeIndex - for the lookups of the states while the tree is executed
+	 */
+	std::atomic<TreeIndex*> _tree;
+	/**
+	 * @brief The compact index of the node in the numbering of its tree - see @c index()
+	 */
+	std::atomic<int> _index;
 	TreeNodes _children;
 	std::string _name;
 	std::string _type;
 	std::string _parameters;
 	ConditionPtr _condition;
+	bool _guard;
+
+	/**
+	 * @brief The state of this node in the given entity - nodes without an index in the numbering of the
+	 * behaviour of the entity keep their states in a map of the entity
+	 */
+	TreeNodeState& getNodeState(const AIPtr& entity) const;
+	/**
+	 * @return @c nullptr if the node has no state in the given entity yet
+	 */
+	const TreeNodeState* findNodeState(const AIPtr& entity) const;
+	/**
+	 * @brief Gives the nodes of the subtree that don't have an index yet the next slots of the given numbering
+	 * @note The index mutex must be locked
+	 */
+	static void index(const TreeIndexPtr& tree, const TreeNode& node);
+	/**
+	 * @brief Indexes the given new child (if any) in the numbering of this node and outdates the programs of the tree
+	 */
+	void changed(const TreeNode* added);
 
 	TreeNodeStatus state(const AIPtr& entity, TreeNodeStatus treeNodeState);
 	int getSelectorState(const AIPtr& entity) const;
 	void setSelectorState(const AIPtr& entity, int selected);
 	int getLimitState(const AIPtr& entity) const;
 	void setLimitState(const AIPtr& entity, int amount);
+	int64_t getTimerState(const AIPtr& entity) const;
+	void setTimerState(const AIPtr& entity, int64_t millis);
 	void setLastExecMillis(const AIPtr& entity);
 
 	TreeNodePtr getParent_r(const TreeNodePtr& parent, int id) const;
@@ -119,7 +221,7 @@ public:
 	 * @param condition The connected ICondition for this node
 	 */
 	TreeNode(const std::string& name, const std::string& parameters, const ConditionPtr& condition) :
-			_id(getNextId()), _name(name), _parameters(parameters), _condition(condition) {
+			_id(getNextId()), _tree(nullptr), _index(-1), _name(name), _parameters(parameters), _condition(condition), _guard(false) {
 	}
 
 	virtual ~TreeNode() {}
@@ -129,6 +231,26 @@ public:
 	 */
 	int getId() const;
 
+	/**
+	 * @brief The compact index of this node in its behaviour tree - the @c AI stores the state of the node
+	 * at this position (selector state, limit counter, ...). @c -1 if the tree was not indexed yet.
+	 * @sa index()
+	 */
+	int getIndex() const;
+
+	/**
+	 * @brief Assigns compact indices to the nodes of the tree that don't have one yet - so the per entity
+	 * states of a tree fit into one small array.
+	 *
+	 * This is done when a tree is handed to an @c AI. A root without an index gets a numbering of its own,
+	 * the nodes below it get the next slots of the numbering of the root. Nodes that are added later (see
+	 * @c addChild() and @c replaceChild()) get theirs right away. An index never changes - a node that was
+	 * already indexed for another tree (a shared subtree) keeps its index, the entities of this tree keep
+	 * the states of such a node in a map then.
+	 * @return The amount of state slots of the numbering of the root
+	 */
+	static int index(const TreeNode& root);
+
 	/**
 	 * @brief Each node can have a user defines name that can be retrieved with this method.
 	 */
@@ -151,8 +273,18 @@ public:
 	const std::string& getType() const;
 	const ConditionPtr& getCondition() const;
 	void setCondition(const ConditionPtr& condition);
+	/**
+	 * @brief Marks the condition of this node as guard - it's checked again whenever a @c TreeProgram resumes
+	 * a running node below this one. The conditions of the other nodes on the way are skipped then.
+	 */
+	void setGuard(bool guard);
+	bool isGuard() const;
 	const TreeNodes& getChildren() const;
-	TreeNodes& getChildren();
+	/**
+	 * @deprecated Use @c addChild() and @c replaceChild() to change the children. The tree counts as changed when
+	 * this is called - so do the changes before the tree is executed again.
+	 */
+	TreeNodes& getChildren() __attribute__((deprecated));
 
 	/**
 	 * @brief Get the state of all child nodes for the given entity
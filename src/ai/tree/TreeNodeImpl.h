@@ -5,6 +5,7 @@
 
 #include "TreeNode.h"
 #include "AI.h"
+#include <mutex>
 
 namespace ai {
 
@@ -12,6 +13,77 @@ inline int TreeNode::getId() const {
 	return _id;
 }
 
+inline int TreeNode::getIndex() const {
+	return _index.load(std::memory_order_relaxed);
+}
+
+inline int TreeNode::index(const TreeNode& root) {
+	const TreeIndex* tree = root._tree.load(std::memory_order_acquire);
+	if (tree != nullptr && !tree->stale.load(std::memory_order_acquire)) {
+		// the nodes that were added since then got their indices from changed()
+		return tree->slots.load(std::memory_order_relaxed);
+	}
+	std::unique_lock<std::mutex> lock(getIndexMutex());
+	TreeIndexPtr treeIndex = root._treeIndex;
+	if (!treeIndex) {
+		treeIndex = std::make_shared<TreeIndex>();
+	}
+	treeIndex->stale = false;
+	index(treeIndex, root);
+	return treeIndex->slots.load(std::memory_order_relaxed);
+}
+
+inline void TreeNode::index(const TreeIndexPtr& tree, const TreeNode& node) {
+	std::vector<const TreeNode*> todo(1, &node);
+	while (!todo.empty()) {
+		TreeNode* current = const_cast<TreeNode*>(todo.back());
+		todo.pop_back();
+		// nodes that were indexed before - for this tree or for another one that shares the subtree - keep
+		// their index. There might be new nodes below them that were added via getChildren().
+		if (!current->_treeIndex) {
+			current->_index.store(tree->slots++, std::memory_order_relaxed);
+			current->_treeIndex = tree;
+			current->_tree.store(tree.get(), std::memory_order_release);
+		}
+		for (auto i = current->_children.rbegin(); i != current->_children.rend(); ++i) {
+			todo.push_back(i->get());
+		}
+	}
+}
+
+inline void TreeNode::changed(const TreeNode* added) {
+	std::unique_lock<std::mutex> lock(getIndexMutex());
+	if (!_treeIndex) {
+		// not part of an indexed tree yet - the new nodes are indexed together with it
+		return;
+	}
+	if (added != nullptr) {
+		index(_treeIndex, *added);
+	}
+	++_treeIndex->version;
+}
+
+inline TreeNodeState& TreeNode::getNodeState(const AIPtr& entity) const {
+	const TreeIndex* tree = _tree.load(std::memory_order_acquire);
+	if (tree != nullptr && tree == entity->_treeIndex.get()) {
+		return entity->getNodeState(getIndex());
+	}
+	// not part of the numbering of the behaviour of the entity - e.g. a subtree that is shared with another tree
+	return entity->_foreignNodeStates[_id];
+}
+
+inline const TreeNodeState* TreeNode::findNodeState(const AIPtr& entity) const {
+	const TreeIndex* tree = _tree.load(std::memory_order_acquire);
+	if (tree != nullptr && tree == entity->_treeIndex.get()) {
+		return entity->findNodeState(getIndex());
+	}
+	auto i = entity->_foreignNodeStates.find(_id);
+	if (i == entity->_foreignNodeStates.end()) {
+		return nullptr;
+	}
+	return &i->second;
+}
+
 inline void TreeNode::setName(const std::string& name) {
 	if (name.empty()) {
 		return;
@@ -33,6 +105,16 @@ inline const ConditionPtr& TreeNode::getCondition() const {
 
 inline void TreeNode::setCondition(const ConditionPtr& condition) {
 	_condition = condition;
+	changed(nullptr);
+}
+
+inline void TreeNode::setGuard(bool guard) {
+	_guard = guard;
+	changed(nullptr);
+}
+
+inline bool TreeNode::isGuard() const {
+	return _guard;
 }
 
 inline const std::string& TreeNode::getParameters() const {
@@ -44,11 +126,18 @@ inline const TreeNodes& TreeNode::getChildren() const {
 }
 
 inline TreeNodes& TreeNode::getChildren() {
+	std::unique_lock<std::mutex> lock(getIndexMutex());
+	if (_treeIndex) {
+		// the new children are indexed with the next index() call of the root
+		_treeIndex->stale = true;
+		++_treeIndex->version;
+	}
 	return _children;
 }
 
 inline bool TreeNode::addChild(const TreeNodePtr& child) {
 	_children.push_back(child);
+	changed(child.get());
 	return true;
 }
 
@@ -69,38 +158,50 @@ inline void TreeNode::setLastExecMillis(const AIPtr& entity) {
 	if (!entity->_debuggingActive) {
 		return;
 	}
-	entity->_lastExecMillis[getId()] = entity->_time;
+	getNodeState(entity).lastExecMillis = entity->_time;
 }
 
 inline int TreeNode::getSelectorState(const AIPtr& entity) const {
-	AI::SelectorStates::const_iterator i = entity->_selectorStates.find(getId());
-	if (i == entity->_selectorStates.end()) {
+	const TreeNodeState* nodeState = findNodeState(entity);
+	if (nodeState == nullptr) {
 		return AI_NOTHING_SELECTED;
 	}
-	return i->second;
+	return nodeState->selector;
 }
 
 inline void TreeNode::setSelectorState(const AIPtr& entity, int selected) {
-	entity->_selectorStates[getId()] = selected;
+	getNodeState(entity).selector = selected;
 }
 
 inline int TreeNode::getLimitState(const AIPtr& entity) const {
-	AI::LimitStates::const_iterator i = entity->_limitStates.find(getId());
-	if (i == entity->_limitStates.end()) {
+	const TreeNodeState* nodeState = findNodeState(entity);
+	if (nodeState == nullptr) {
 		return 0;
 	}
-	return i->second;
+	return nodeState->limit;
 }
 
 inline void TreeNode::setLimitState(const AIPtr& entity, int amount) {
-	entity->_limitStates[getId()] = amount;
+	getNodeState(entity).limit = amount;
+}
+
+inline int64_t TreeNode::getTimerState(const AIPtr& entity) const {
+	const TreeNodeState* nodeState = findNodeState(entity);
+	if (nodeState == nullptr) {
+		return -1L;
+	}
+	return nodeState->timerMillis;
+}
+
+inline void TreeNode::setTimerState(const AIPtr& entity, int64_t millis) {
+	getNodeState(entity).timerMillis = millis;
 }
 
 inline TreeNodeStatus TreeNode::state(const AIPtr& entity, TreeNodeStatus treeNodeState) {
 	if (!entity->_debuggingActive) {
 		return treeNodeState;
 	}
-	entity->_lastStatus[getId()] = treeNodeState;
+	getNodeState(entity).lastStatus = treeNodeState;
 	return treeNodeState;
 }
 
@@ -108,22 +209,22 @@ inline int64_t TreeNode::getLastExecMillis(const AIPtr& entity) const {
 	if (!entity->_debuggingActive) {
 		return -1L;
 	}
-	AI::LastExecMap::const_iterator i = entity->_lastExecMillis.find(getId());
-	if (i == entity->_lastExecMillis.end()) {
+	const TreeNodeState* nodeState = findNodeState(entity);
+	if (nodeState == nullptr) {
 		return -1L;
 	}
-	return i->second;
+	return nodeState->lastExecMillis;
 }
 
 inline TreeNodeStatus TreeNode::getLastStatus(const AIPtr& entity) const {
 	if (!entity->_debuggingActive) {
 		return UNKNOWN;
 	}
-	AI::NodeStates::const_iterator i = entity->_lastStatus.find(getId());
-	if (i == entity->_lastStatus.end()) {
+	const TreeNodeState* nodeState = findNodeState(entity);
+	if (nodeState == nullptr) {
 		return UNKNOWN;
 	}
-	return i->second;
+	return nodeState->lastStatus;
 }
 
 inline TreeNodePtr TreeNode::getChild(int id) const {
@@ -147,10 +248,12 @@ inline bool TreeNode::replaceChild(int id, const TreeNodePtr& newNode) {
 
 	if (newNode) {
 		*i = newNode;
+		changed(newNode.get());
 		return true;
 	}
 
 	_children.erase(i);
+	changed(nullptr);
 	return true;
 }
 
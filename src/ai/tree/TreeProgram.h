@@ -0,0 +1,502 @@
+/**
+ * @file
+ */
+#pragma once
+
+#include "tree/TreeNode.h"
+#include "tree/Sequence.h"
+#include "tree/PrioritySelector.h"
+#include "tree/Parallel.h"
+#include "tree/Limit.h"
+#include "tree/Invert.h"
+#include "conditions/ICondition.h"
+#include "AI.h"
+#include <typeinfo>
+#include <vector>
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief A behaviour tree that was compiled into one flat array of instructions - executed by a loop over an
+ * explicit stack instead of recursive virtual calls (see @c compile() and @c AI::setProgram()).
+ *
+ * The nodes are stored in depth first order, every instruction knows the end of its subtree and the
+ * position of its children in one shared child list. @c Sequence, @c PrioritySelector, @c Parallel,
+ * @c Limit and @c Invert are executed by the interpreter itself - every other node (tasks, custom or
+ * lua nodes and the nodes below them) is executed via its virtual @c TreeNode::execute().
+ *
+ * The program uses the same states in the @c AI as the tree - without the resume mode the results are
+ * the same as the ones of the recursive execution and both can be mixed. If the tree is changed after it was compiled (see
+ * @c TreeNode::addChild() and @c TreeNode::setCondition()), the program falls back to the recursive execution.
+ *
+ * In the resume mode (see @c compile()) the program remembers the way down to a running node per @c AI
+ * and continues right there in the next execution. The result of the node is handed up the way as usual -
+ * so the next child of a sequence is started once the running node is done. The way is dropped and the
+ * tree is executed from the root again if a guard fails, if one of the higher priority siblings of the
+ * selected child of a @c PrioritySelector on the way could run now (their conditions are implicit guards),
+ * or if the entity was woken up since the last execution (see @c AI::wake() - e.g. new aggro, perceived
+ * stimuli or a world query result). The priority selectors on a dropped way start over at their first child,
+ * so a higher priority branch takes over. Ways through @c Sequence, @c PrioritySelector and @c Invert nodes
+ * are resumed - @c Parallel and @c Limit nodes need the execution of every child, ways through them are
+ * executed from the root.
+ *
+ * The results of the resume mode differ from the ones of the recursive execution: only the conditions of
+ * the nodes on the way that are marked as guards (see @c TreeNode::setGuard()) are checked again - a node
+ * on the way whose condition fails keeps running until the way is dropped. And a @c PrioritySelector doesn't
+ * reset its running child - a sequence below it continues instead of starting over at its first child.
+ *
+ * @note Only nodes of exactly the inlined types are inlined - subclasses might override @c execute()
+ */
+class TreeProgram {
+private:
+	enum Op : uint8_t {
+		OP_NODE, OP_SEQUENCE, OP_PRIORITYSELECTOR, OP_PARALLEL, OP_LIMIT, OP_INVERT
+	};
+
+	struct Instruction {
+		Op op;
+		// the state slot in the entity - see TreeNode::getIndex(). -1 if the node has no index in the
+		// numbering of the root (a subtree that is shared with another tree)
+		int state;
+		// one past the last instruction of the subtree
+		int end;
+		// the range in _childList
+		int firstChild;
+		int childCount;
+		// the amount of executions of a limit
+		int amount;
+		bool guard;
+		ICondition* condition;
+		TreeNode* node;
+	};
+
+	struct Frame {
+		int instruction;
+		// the position in the children of the instruction
+		int child;
+		// the limit state, or whether a child of a parallel node is still running
+		int value;
+	};
+
+	const TreeNodePtr _root;
+	std::vector<Instruction> _instructions;
+	std::vector<int> _childList;
+	// the versions of the trees the nodes were indexed for when the program was compiled
+	std::vector<std::pair<TreeIndexPtr, uint32_t> > _versions;
+	int _inlined;
+	const bool _resume;
+
+	static Op getOp(const TreeNode& node);
+	int add(TreeNode* node);
+
+	inline TreeNodeState& getNodeState(const AIPtr& entity, const Instruction& instruction) const {
+		if (instruction.state >= 0) {
+			return entity->getNodeState(instruction.state);
+		}
+		return instruction.node->getNodeState(entity);
+	}
+
+	inline TreeNodeStatus record(const AIPtr& entity, const Instruction& instruction, TreeNodeStatus status) const {
+		if (entity->_debuggingActive) {
+			getNodeState(entity, instruction).lastStatus = status;
+		}
+		return status;
+	}
+
+	inline int child(const Instruction& instruction, int n) const {
+		return _childList[instruction.firstChild + n];
+	}
+
+	/**
+	 * @brief The same as @c TreeNode::resetState() for the subtree
+	 */
+	void reset(const AIPtr& entity, int instruction) const;
+
+	/**
+	 * @return @c false if one of the guards on the running path of the entity failed, or if a higher
+	 * priority sibling of a child that a priority selector on the way selected could run now
+	 */
+	bool checkGuards(const AIPtr& entity) const;
+
+	/**
+	 * @brief Forgets the running path of the entity - the priority selectors on it start at their first child again
+	 */
+	void drop(const AIPtr& entity) const;
+
+	/**
+	 * @brief Puts the frames of the running path of the entity on the stack - like they would be after
+	 * executing the tree down to the running node
+	 */
+	void resume(const AIPtr& entity, std::vector<Frame>& stack) const;
+
+	TreeProgram(const TreeNodePtr& root, bool resume);
+
+public:
+	/**
+	 * @brief Compiles the given tree - the nodes are indexed (see @c TreeNode::index()) if that wasn't done yet
+	 * @param resume Continue at the running node instead of starting at the root in every execution
+	 */
+	static std::shared_ptr<TreeProgram> compile(const TreeNodePtr& root, bool resume = false);
+
+	inline const TreeNodePtr& getRoot() const {
+		return _root;
+	}
+
+	/**
+	 * @return @c false if the tree was changed after it was compiled - @c execute() falls back to the
+	 * recursive execution then
+	 */
+	inline bool isValid() const {
+		for (const auto& version : _versions) {
+			if (version.first->version.load(std::memory_order_acquire) != version.second) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	inline bool isResuming() const {
+		return _resume;
+	}
+
+	/**
+	 * @return The amount of instructions - one per node that is executed by the interpreter or called via @c TreeNode::execute()
+	 */
+	inline int getInstructions() const {
+		return static_cast<int>(_instructions.size());
+	}
+
+	/**
+	 * @return The amount of nodes that are executed by the interpreter itself
+	 */
+	inline int getInlined() const {
+		return _inlined;
+	}
+
+	/**
+	 * @brief Executes the tree for the given entity - the same as calling @c TreeNode::execute() on the root node
+	 */
+	TreeNodeStatus execute(const AIPtr& entity, int64_t deltaMillis) const;
+};
+
+typedef std::shared_ptr<TreeProgram> TreeProgramPtr;
+
+inline TreeProgram::TreeProgram(const TreeNodePtr& root, bool resume) :
+		_root(root), _inlined(0), _resume(resume) {
+}
+
+inline TreeProgram::Op TreeProgram::getOp(const TreeNode& node) {
+	const std::type_info& type = typeid(node);
+	const std::size_t children = node.getChildren().size();
+	if (type == typeid(Sequence)) {
+		return OP_SEQUENCE;
+	}
+	if (type == typeid(PrioritySelector)) {
+		return OP_PRIORITYSELECTOR;
+	}
+	if (type == typeid(Parallel)) {
+		return OP_PARALLEL;
+	}
+	// the recursive execution asserts on invalid decorators
+	if (type == typeid(Limit) && children == 1u) {
+		return OP_LIMIT;
+	}
+	if (type == typeid(Invert) && children == 1u) {
+		return OP_INVERT;
+	}
+	return OP_NODE;
+}
+
+inline int TreeProgram::add(TreeNode* node) {
+	const int index = static_cast<int>(_instructions.size());
+	Instruction instruction;
+	instruction.op = getOp(*node);
+	const TreeIndexPtr& tree = node->_treeIndex;
+	instruction.state = tree && tree == _root->_treeIndex ? node->getIndex() : -1;
+	auto known = std::find_if(_versions.begin(), _versions.end(), [&tree] (const std::pair<TreeIndexPtr, uint32_t>& version) {
+		return version.first == tree;
+	});
+	// a node that was added to a shared subtree via getChildren() might not have an index yet - the
+	// version of the tree of its parent covers it
+	if (tree && known == _versions.end()) {
+		_versions.emplace_back(tree, tree->version.load(std::memory_order_acquire));
+	}
+	instruction.end = index + 1;
+	instruction.firstChild = 0;
+	instruction.childCount = 0;
+	instruction.amount = instruction.op == OP_LIMIT ? static_cast<const Limit*>(node)->getAmount() : 0;
+	instruction.guard = node->isGuard();
+	instruction.condition = node->getCondition().get();
+	instruction.node = node;
+	_instructions.push_back(instruction);
+	if (instruction.op == OP_NODE) {
+		return index;
+	}
+	++_inlined;
+	std::vector<int> children;
+	const TreeNode* parent = node;
+	for (const TreeNodePtr& c : parent->getChildren()) {
+		children.push_back(add(c.get()));
+	}
+	Instruction& added = _instructions[index];
+	added.end = static_cast<int>(_instructions.size());
+	added.firstChild = static_cast<int>(_childList.size());
+	added.childCount = static_cast<int>(children.size());
+	_childList.insert(_childList.end(), children.begin(), children.end());
+	return index;
+}
+
+inline TreeProgramPtr TreeProgram::compile(const TreeNodePtr& root, bool resume) {
+	ai_assert(root, "No tree given");
+	TreeNode::index(*root);
+	const TreeProgramPtr program(new TreeProgram(root, resume));
+	program->add(root.get());
+	return program;
+}
+
+inline void TreeProgram::reset(const AIPtr& entity, int instruction) const {
+	const int end = _instructions[instruction].end;
+	for (int i = instruction; i < end; ++i) {
+		const Instruction& current = _instructions[i];
+		if (current.op == OP_SEQUENCE) {
+			getNodeState(entity, current).selector = AI_NOTHING_SELECTED;
+		} else if (current.op == OP_NODE) {
+			current.node->resetState(entity);
+		}
+	}
+}
+
+inline bool TreeProgram::checkGuards(const AIPtr& entity) const {
+	const std::vector<std::pair<int, int> >& path = entity->_runningPath;
+	for (std::size_t i = 0u; i + 1u < path.size(); ++i) {
+		const Instruction& instruction = _instructions[path[i].first];
+		if (instruction.guard && !instruction.condition->evaluate(entity)) {
+			return false;
+		}
+		if (instruction.op != OP_PRIORITYSELECTOR) {
+			continue;
+		}
+		for (int j = 0; j < path[i].second; ++j) {
+			if (_instructions[child(instruction, j)].condition->evaluate(entity)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+inline void TreeProgram::drop(const AIPtr& entity) const {
+	std::vector<std::pair<int, int> >& path = entity->_runningPath;
+	for (const std::pair<int, int>& step : path) {
+		const Instruction& instruction = _instructions[step.first];
+		if (instruction.op == OP_PRIORITYSELECTOR) {
+			getNodeState(entity, instruction).selector = AI_NOTHING_SELECTED;
+		}
+	}
+	path.clear();
+}
+
+inline void TreeProgram::resume(const AIPtr& entity, std::vector<Frame>& stack) const {
+	const std::vector<std::pair<int, int> >& path = entity->_runningPath;
+	for (std::size_t i = 0u; i + 1u < path.size(); ++i) {
+		stack.push_back(Frame{path[i].first, path[i].second, 0});
+	}
+}
+
+inline TreeNodeStatus TreeProgram::execute(const AIPtr& entity, int64_t deltaMillis) const {
+	if (!isValid()) {
+		return _root->execute(entity, deltaMillis);
+	}
+	// reused by all executions on this thread - the base allows nested executions
+	static thread_local std::vector<Frame> stack;
+	const std::size_t base = stack.size();
+	const bool debugging = entity->_debuggingActive;
+	const uint32_t wakeups = entity->_wakeups;
+
+	int next = 0;
+	TreeNodeStatus result = UNKNOWN;
+	std::vector<std::pair<int, int> >& path = entity->_runningPath;
+	if (_resume && !path.empty() && entity->_runningPathWakeups == wakeups && checkGuards(entity)) {
+		result = _instructions[path.back().first].node->execute(entity, deltaMillis);
+		if (result == RUNNING && !debugging) {
+			// the states on the way up don't change - only the recorded status would
+			return RUNNING;
+		}
+		resume(entity, stack);
+		if (result != RUNNING) {
+			path.clear();
+		}
+		next = -1;
+	} else {
+		drop(entity);
+	}
+	for (;;) {
+		if (next != -1) {
+			// enter the instruction
+			const Instruction& instruction = _instructions[next];
+			const int current = next;
+			next = -1;
+			if (instruction.op == OP_NODE) {
+				result = instruction.node->execute(entity, deltaMillis);
+				if (_resume && result == RUNNING && path.empty()) {
+					// remember the way down if it can be resumed
+					bool resumable = true;
+					for (std::size_t i = base; i < stack.size(); ++i) {
+						const Op op = _instructions[stack[i].instruction].op;
+						resumable &= op == OP_SEQUENCE || op == OP_PRIORITYSELECTOR || op == OP_INVERT;
+						path.push_back(std::make_pair(stack[i].instruction, stack[i].child));
+					}
+					path.push_back(std::make_pair(current, -1));
+					if (!resumable) {
+						path.clear();
+					}
+				}
+			} else if (!instruction.condition->evaluate(entity)) {
+				result = record(entity, instruction, CANNOTEXECUTE);
+			} else {
+				if (debugging) {
+					getNodeState(entity, instruction).lastExecMillis = entity->_time;
+				}
+				TreeNodeState& nodeState = getNodeState(entity, instruction);
+				switch (instruction.op) {
+				case OP_SEQUENCE: {
+					const int progress = std::max(0, nodeState.selector);
+					if (progress < instruction.childCount) {
+						stack.push_back(Frame{current, progress, 0});
+						next = child(instruction, progress);
+					} else {
+						reset(entity, current);
+						result = record(entity, instruction, FINISHED);
+					}
+					break;
+				}
+				case OP_PRIORITYSELECTOR: {
+					const int selected = nodeState.selector == AI_NOTHING_SELECTED ? 0 : nodeState.selector;
+					for (int j = 0; j < selected && j < instruction.childCount; ++j) {
+						reset(entity, child(instruction, j));
+					}
+					if (selected < instruction.childCount) {
+						stack.push_back(Frame{current, selected, 0});
+						next = child(instruction, selected);
+					} else {
+						result = record(entity, instruction, FINISHED);
+					}
+					break;
+				}
+				case OP_PARALLEL:
+					if (instruction.childCount > 0) {
+						stack.push_back(Frame{current, 0, 0});
+						next = child(instruction, 0);
+					} else {
+						reset(entity, current);
+						result = record(entity, instruction, FINISHED);
+					}
+					break;
+				case OP_LIMIT:
+					if (nodeState.limit >= instruction.amount) {
+						result = record(entity, instruction, FINISHED);
+					} else {
+						stack.push_back(Frame{current, 0, nodeState.limit});
+						next = child(instruction, 0);
+					}
+					break;
+				case OP_INVERT:
+					stack.push_back(Frame{current, 0, 0});
+					next = child(instruction, 0);
+					break;
+				case OP_NODE:
+					break;
+				}
+			}
+			if (next != -1) {
+				continue;
+			}
+		}
+
+		// hand the result to the parent
+		if (stack.size() == base) {
+			if (result != RUNNING) {
+				path.clear();
+			}
+			entity->_runningPathWakeups = wakeups;
+			return result;
+		}
+		Frame& frame = stack.back();
+		const Instruction& instruction = _instructions[frame.instruction];
+		bool done = true;
+		switch (instruction.op) {
+		case OP_SEQUENCE:
+			if (result == RUNNING) {
+				getNodeState(entity, instruction).selector = frame.child;
+			} else if (result == CANNOTEXECUTE || result == FAILED || result == EXCEPTION) {
+				// nothing else to do
+			} else if (++frame.child < instruction.childCount) {
+				next = child(instruction, frame.child);
+				done = false;
+			}
+			if (done && result != RUNNING) {
+				reset(entity, frame.instruction);
+			}
+			break;
+		case OP_PRIORITYSELECTOR: {
+			const int executed = child(instruction, frame.child);
+			if (result == CANNOTEXECUTE || result == FAILED) {
+				reset(entity, executed);
+				getNodeState(entity, instruction).selector = AI_NOTHING_SELECTED;
+				if (++frame.child < instruction.childCount) {
+					next = child(instruction, frame.child);
+					done = false;
+				} else {
+					result = FINISHED;
+				}
+				break;
+			}
+			getNodeState(entity, instruction).selector = result == RUNNING ? frame.child : AI_NOTHING_SELECTED;
+			reset(entity, executed);
+			for (int j = frame.child + 1; j < instruction.childCount; ++j) {
+				reset(entity, child(instruction, j));
+			}
+			break;
+		}
+		case OP_PARALLEL:
+			if (result == RUNNING) {
+				frame.value = 1;
+			} else {
+				reset(entity, child(instruction, frame.child));
+			}
+			if (++frame.child < instruction.childCount) {
+				next = child(instruction, frame.child);
+				done = false;
+			} else {
+				if (frame.value == 0) {
+					reset(entity, frame.instruction);
+				}
+				result = frame.value != 0 ? RUNNING : FINISHED;
+			}
+			break;
+		case OP_LIMIT:
+			getNodeState(entity, instruction).limit = frame.value + 1;
+			result = result == RUNNING ? RUNNING : FAILED;
+			break;
+		case OP_INVERT:
+			if (result == FINISHED) {
+				result = FAILED;
+			} else if (result == FAILED || result == CANNOTEXECUTE) {
+				result = FINISHED;
+			} else if (result != EXCEPTION) {
+				result = RUNNING;
+			}
+			break;
+		case OP_NODE:
+			break;
+		}
+		if (!done) {
+			continue;
+		}
+		result = record(entity, instruction, result);
+		stack.pop_back();
+	}
+}
+
+}
@@ -13,6 +13,7 @@
  * 	local rootNode = AI.createTree(name):createRoot("PrioritySelector", name)
  * 	local parallel = rootnode:addNode("Parallel", "hunt")
  * 	parallel:setCondition("Not(IsOnCooldown{HUNT})")
+ * 	parallel:setGuard(true)
  * 		parallel:addNode("Steer(SelectionSeek)", "follow"):setCondition("Filter(SelectEntitiesOfType{ANIMAL_RABBIT})")
  * 		parallel:addNode("AttackOnSelection", "attack"):setCondition("IsCloseToSelection{1}")
  * 		parallel:addNode("SetPointOfInterest", "setpoi"):setCondition("IsCloseToSelection{1}")
@@ -213,6 +214,13 @@ private:
 		return 1;
 	}
 
+	static int luaNode_SetGuard(lua_State * l) {
+		LUANode *node = luaGetNodeContext(l, 1);
+		node->getTreeNode()->setGuard(lua_toboolean(l, 2) != 0);
+		lua_pushvalue(l, 1);
+		return 1;
+	}
+
 	static int luaTree_CreateRoot(lua_State * l) {
 		LUATree *ctx = luaGetTreeContext(l, 1);
 		const std::string id = luaL_checkstring(l, 2);
@@ -287,6 +295,7 @@ public:
 		node.addFunction("addNode", luaNode_AddNode);
 		node.addFunction("getName", luaNode_GetName);
 		node.addFunction("setCondition", luaNode_SetCondition);
+		node.addFunction("setGuard", luaNode_SetGuard);
 		node.addFunction("__gc", luaNode_GC);
 		node.addFunction("__tostring", luaNode_ToString);
 
@@ -53,6 +53,7 @@ private:
 		}
 
 		node->setCondition(conditionPtr);
+		node->setGuard(e->BoolAttribute("guard"));
 		return node;
 	}
 
@@ -0,0 +1,150 @@
+/**
+ * @file
+ *
+ * @defgroup World
+ * @{
+ * Raycasts and navigation requests that the behaviour of an @ai{AI} asks the game world. They are
+ * collected by the @ai{Zone} during its update and handed over to the game in one batch.
+ */
+#pragma once
+
+#include "common/Math.h"
+#include "common/Types.h"
+#include <vector>
+#include <memory>
+
+namespace ai {
+
+enum class WorldQueryType {
+	/**
+	 * @brief Is there anything between @c from and @c to
+	 */
+	Raycast,
+	/**
+	 * @brief Can @c to be reached by walking from @c from
+	 */
+	Navigation
+};
+
+/**
+ * @brief A request to the game world - see @c Zone::submitWorldQuery()
+ */
+struct WorldQuery {
+	WorldQueryType type;
+	glm::vec3 from;
+	glm::vec3 to;
+	/**
+	 * @brief The entity the result is delivered to
+	 */
+	CharacterId requester;
+	/**
+	 * @brief Identifies the submitter (e.g. the node or condition) - to find the result again
+	 * @sa WorldQueryResults::get()
+	 */
+	const void* owner;
+};
+
+struct WorldQueryResult {
+	WorldQuery query;
+	/**
+	 * @brief For a raycast: the ray was blocked before it reached @c to. For a navigation request:
+	 * @c to can be reached.
+	 */
+	bool success;
+	/**
+	 * @brief For a raycast: the point where the ray was blocked. For a navigation request: the
+	 * closest point to @c to that can be reached.
+	 */
+	glm::vec3 point;
+	/**
+	 * @brief The distance from @c from to @c point - along the path for navigation requests
+	 */
+	float distance;
+
+	/**
+	 * @brief The result of a query that nobody answered: the ray is blocked right at @c from and the
+	 * navigation target can't be reached. So a missing answer never grants a line of sight or a way.
+	 */
+	static inline WorldQueryResult unanswered(const WorldQuery& query) {
+		return WorldQueryResult{query, query.type == WorldQueryType::Raycast, query.from, 0.0f};
+	}
+};
+
+typedef std::vector<WorldQuery> WorldQueries;
+typedef std::vector<WorldQueryResult> WorldQueryResultList;
+
+/**
+ * @brief The game side of the world queries. Instead of answering every raycast on the worker thread
+ * that executes the behaviour tree, the @c Zone collects the requests of a tick and hands them over in
+ * one call - so they can be answered in bulk (e.g. with SIMD raycasts or by locking the navmesh once).
+ *
+ * @sa Zone::setWorldQuery()
+ * @sa LocalWorldQuery for an implementation without a game world
+ */
+class IWorldQuery {
+public:
+	virtual ~IWorldQuery() {
+	}
+
+	/**
+	 * @brief Answers the queries of one batch
+	 * @param results Has the same size as @c queries - each result is already set to
+	 * @c WorldQueryResult::unanswered() for its query
+	 * @note Called from the thread that updates the zone - between the updates of the entities
+	 */
+	virtual void execute(const WorldQueries& queries, WorldQueryResultList& results) = 0;
+};
+
+typedef std::shared_ptr<IWorldQuery> WorldQueryPtr;
+
+/**
+ * @brief The results of the world queries of an @c AI. The results of a batch are delivered after an update
+ * of the zone and are readable during the next update of the entity - after that they are replaced.
+ */
+class WorldQueryResults {
+private:
+	WorldQueryResultList _pending;
+	WorldQueryResultList _current;
+public:
+	/**
+	 * @brief Called by the zone with the results of a batch
+	 */
+	inline void deliver(const WorldQueryResult& result) {
+		_pending.push_back(result);
+	}
+
+	/**
+	 * @brief Makes the delivered results readable - called at the beginning of the update of the entity
+	 */
+	inline void update() {
+		std::swap(_pending, _current);
+		_pending.clear();
+	}
+
+	/**
+	 * @return The latest result of the given submitter or @c nullptr if there is none
+	 */
+	inline const WorldQueryResult* get(const void* owner) const {
+		for (auto i = _current.rbegin(); i != _current.rend(); ++i) {
+			if (i->query.owner == owner) {
+				return &*i;
+			}
+		}
+		return nullptr;
+	}
+
+	inline const WorldQueryResultList& getResults() const {
+		return _current;
+	}
+
+	inline void clear() {
+		_pending.clear();
+		_current.clear();
+	}
+};
+
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,116 @@
+/**
+ * @file
+ * @ingroup World
+ */
+#pragma once
+
+#include "world/IWorldQuery.h"
+#include <atomic>
+#include <limits>
+
+namespace ai {
+
+/**
+ * @brief A @c IWorldQuery without a game behind it: the world consists of boxes that block the
+ * rays and the movement - everything else is free to walk.
+ *
+ * Navigation requests are answered with the straight line, so @c to is only reachable if no box is
+ * in the way. Meant for tests and tools.
+ */
+class LocalWorldQuery: public IWorldQuery {
+public:
+	struct Box {
+		glm::vec3 mins;
+		glm::vec3 maxs;
+	};
+private:
+	std::vector<Box> _boxes;
+	std::atomic<int> _batches;
+	std::atomic<int> _queries;
+
+	/**
+	 * @return The fraction of the way from @c from to @c to where the first box is hit - or a value
+	 * greater than @c 1 if nothing is in the way
+	 */
+	float intersect(const glm::vec3& from, const glm::vec3& to) const;
+
+public:
+	LocalWorldQuery() :
+			_batches(0), _queries(0) {
+	}
+
+	/**
+	 * @note Not thread safe - don't add boxes while a zone is updated
+	 */
+	inline void addBox(const glm::vec3& mins, const glm::vec3& maxs) {
+		_boxes.push_back(Box{mins, maxs});
+	}
+
+	/**
+	 * @return The amount of @c execute() calls
+	 */
+	inline int getBatches() const {
+		return _batches;
+	}
+
+	/**
+	 * @return The amount of answered queries
+	 */
+	inline int getQueries() const {
+		return _queries;
+	}
+
+	void execute(const WorldQueries& queries, WorldQueryResultList& results) override;
+};
+
+inline float LocalWorldQuery::intersect(const glm::vec3& from, const glm::vec3& to) const {
+	const glm::vec3 dir = to - from;
+	float nearest = std::numeric_limits<float>::max();
+	for (const Box& box : _boxes) {
+		// slab test
+		float tmin = 0.0f;
+		float tmax = 1.0f;
+		bool hit = true;
+		for (int axis = 0; axis < 3; ++axis) {
+			if (glm::abs(dir[axis]) < glm::epsilon<float>()) {
+				if (from[axis] < box.mins[axis] || from[axis] > box.maxs[axis]) {
+					hit = false;
+					break;
+				}
+				continue;
+			}
+			const float inv = 1.0f / dir[axis];
+			float t0 = (box.mins[axis] - from[axis]) * inv;
+			float t1 = (box.maxs[axis] - from[axis]) * inv;
+			if (t0 > t1) {
+				std::swap(t0, t1);
+			}
+			tmin = std::max(tmin, t0);
+			tmax = std::min(tmax, t1);
+			if (tmin > tmax) {
+				hit = false;
+				break;
+			}
+		}
+		if (hit) {
+			nearest = std::min(nearest, tmin);
+		}
+	}
+	return nearest;
+}
+
+inline void LocalWorldQuery::execute(const WorldQueries& queries, WorldQueryResultList& results) {
+	++_batches;
+	_queries += static_cast<int>(queries.size());
+	for (WorldQueryResult& result : results) {
+		const WorldQuery& query = result.query;
+		const float t = intersect(query.from, query.to);
+		const bool blocked = t <= 1.0f;
+		const glm::vec3 point = blocked ? glm::mix(query.from, query.to, t) : query.to;
+		result.point = point;
+		result.distance = glm::distance(query.from, point);
+		result.success = query.type == WorldQueryType::Raycast ? blocked : !blocked;
+	}
+}
+
+}
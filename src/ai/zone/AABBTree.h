@@ -0,0 +1,565 @@
+/**
+ * @file
+ * @ingroup Zone
+ */
+#pragma once
+
+#include "common/Math.h"
+#include "common/Types.h"
+#include "zone/SpatialGrid.h"
+#include <unordered_map>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief Dynamic bounding volume tree over the entity positions - suited for huge and sparse zones with
+ * clustered entities, where a uniform grid would either need too many cells or too large ones.
+ *
+ * Every entity is a leaf with a box that is fattened by a margin. As long as an entity stays inside of
+ * its fat box, moving it just stores the new position. Otherwise the leaf is removed and inserted again
+ * at the place that grows the surface of the tree the least. The tree is kept balanced by rotations.
+ * A tree can also be built in one go with a top down median split - use this for mass spawns.
+ *
+ * @note Not thread safe - the @c Zone guards it with a lock.
+ */
+class AABBTree {
+public:
+	struct AABB {
+		glm::vec3 mins;
+		glm::vec3 maxs;
+
+		inline bool contains(const glm::vec3& p) const {
+			return p.x >= mins.x && p.y >= mins.y && p.z >= mins.z && p.x <= maxs.x && p.y <= maxs.y && p.z <= maxs.z;
+		}
+
+		inline bool overlaps(const AABB& other) const {
+			return mins.x <= other.maxs.x && mins.y <= other.maxs.y && mins.z <= other.maxs.z
+				&& maxs.x >= other.mins.x && maxs.y >= other.mins.y && maxs.z >= other.mins.z;
+		}
+
+		/**
+		 * @return The squared distance of the given point to the box - @c 0 if the point is inside
+		 */
+		inline float distanceSquared(const glm::vec3& p) const {
+			const glm::vec3 d = glm::max(glm::max(mins - p, p - maxs), glm::vec3(0.0f));
+			return glm::dot(d, d);
+		}
+
+		inline float surface() const {
+			const glm::vec3 d = maxs - mins;
+			return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+
+		static inline AABB merge(const AABB& a, const AABB& b) {
+			return AABB{glm::min(a.mins, b.mins), glm::max(a.maxs, b.maxs)};
+		}
+	};
+
+	/**
+	 * @brief An entity for the bulk build
+	 */
+	typedef std::pair<CharacterId, glm::vec3> Entry;
+	typedef std::vector<Entry> Entries;
+
+private:
+	static const int NIL = -1;
+
+	struct Node {
+		AABB box;
+		// the next free node if the node is not in use
+		int parent;
+		int left;
+		int right;
+		// leafs have a height of 0, free nodes -1
+		int height;
+		CharacterId id;
+		glm::vec3 position;
+
+		inline bool isLeaf() const {
+			return left == NIL;
+		}
+	};
+
+	std::vector<Node> _nodes;
+	int _root;
+	int _free;
+	const float _margin;
+	std::unordered_map<CharacterId, int> _leaves;
+
+	int allocate();
+	void release(int index);
+	void insertLeaf(int leaf);
+	void removeLeaf(int leaf);
+	/**
+	 * @brief Rotates the node up that is too high - @return The index of the node that is now at the given place
+	 */
+	int balance(int index);
+	/**
+	 * @brief Rebalances the tree and refits the boxes from the given node up to the root
+	 */
+	void refit(int index);
+	int build(std::vector<int>& leaves, std::size_t first, std::size_t last);
+
+	inline AABB fatten(const glm::vec3& position) const {
+		const glm::vec3 m(_margin);
+		return AABB{position - m, position + m};
+	}
+
+	// a traversal pushes at most one node more than it pops per level - and the tree is balanced
+	static const int STACK_SIZE = 128;
+
+public:
+	/**
+	 * @param margin The distance an entity may move before it is inserted again
+	 */
+	explicit AABBTree(float margin = 2.0f) :
+			_root(NIL), _free(NIL), _margin(std::max(margin, 0.0f)) {
+	}
+
+	inline float getMargin() const {
+		return _margin;
+	}
+
+	/**
+	 * @brief Adds the entity or moves it to the given position
+	 * @return @c true if the entity had to be (re-)inserted, @c false if it is still inside of its fat box
+	 */
+	bool update(CharacterId id, const glm::vec3& position);
+
+	/**
+	 * @return @c false if the entity wasn't part of the tree
+	 */
+	bool remove(CharacterId id);
+
+	/**
+	 * @brief Replaces the content of the tree - this is much faster than inserting the entities one by one
+	 * and the resulting tree is of a better quality.
+	 */
+	void build(const Entries& entries);
+
+	void clear();
+
+	/**
+	 * @return The amount of entities in the tree
+	 */
+	inline std::size_t size() const {
+		return _leaves.size();
+	}
+
+	/**
+	 * @return The height of the tree - @c 0 for an empty tree or a single entity
+	 */
+	inline int getHeight() const {
+		return _root == NIL ? 0 : _nodes[_root].height;
+	}
+
+	/**
+	 * @brief Calls the functor with the @c CharacterId and the position of every entity that is not further
+	 * away from the given center than the given radius
+	 */
+	template<typename Func>
+	void visit(const glm::vec3& center, float radius, Func&& func) const {
+		if (_root == NIL || radius < 0.0f) {
+			return;
+		}
+		const float radiusSquared = radius * radius;
+		int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = _root;
+		while (top > 0) {
+			const Node& node = _nodes[stack[--top]];
+			if (node.box.distanceSquared(center) > radiusSquared) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				if (glm::distance2(node.position, center) <= radiusSquared) {
+					func(node.id, node.position);
+				}
+				continue;
+			}
+			ai_assert(top + 2 <= STACK_SIZE, "AABBTree is too deep");
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+
+	/**
+	 * @brief Calls the functor with the @c CharacterId and the position of every entity inside the given box
+	 */
+	template<typename Func>
+	void visitBox(const glm::vec3& mins, const glm::vec3& maxs, Func&& func) const {
+		if (_root == NIL) {
+			return;
+		}
+		const AABB box{mins, maxs};
+		int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = _root;
+		while (top > 0) {
+			const Node& node = _nodes[stack[--top]];
+			if (!node.box.overlaps(box)) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				if (box.contains(node.position)) {
+					func(node.id, node.position);
+				}
+				continue;
+			}
+			ai_assert(top + 2 <= STACK_SIZE, "AABBTree is too deep");
+			stack[top++] = node.left;
+			stack[top++] = node.right;
+		}
+	}
+
+	/**
+	 * @brief Finds the @c k entities that are closest to the given center - but not further away than @c maxDistance.
+	 * Subtrees whose box is further away than the current k-th candidate are skipped, the closer child is visited first.
+	 * @sa SpatialGrid::nearest()
+	 */
+	template<typename Func>
+	std::size_t nearest(const glm::vec3& center, std::size_t k, float maxDistance, Func&& accept, std::vector<CharacterId>& ids) const {
+		NearestNeighbours neighbours(k, maxDistance);
+		if (_root == NIL || k == 0u || maxDistance < 0.0f) {
+			return 0u;
+		}
+		int stack[STACK_SIZE];
+		int top = 0;
+		stack[top++] = _root;
+		while (top > 0) {
+			const Node& node = _nodes[stack[--top]];
+			if (node.box.distanceSquared(center) > neighbours.getBoundSquared()) {
+				continue;
+			}
+			if (node.isLeaf()) {
+				const float distanceSquared = glm::distance2(node.position, center);
+				if (distanceSquared <= neighbours.getBoundSquared() && accept(node.id)) {
+					neighbours.add(distanceSquared, node.id);
+				}
+				continue;
+			}
+			ai_assert(top + 2 <= STACK_SIZE, "AABBTree is too deep");
+			const bool leftFirst = _nodes[node.left].box.distanceSquared(center) <= _nodes[node.right].box.distanceSquared(center);
+			// the closer child is popped first
+			stack[top++] = leftFirst ? node.right : node.left;
+			stack[top++] = leftFirst ? node.left : node.right;
+		}
+		return neighbours.finish(ids);
+	}
+};
+
+inline int AABBTree::allocate() {
+	if (_free == NIL) {
+		_nodes.push_back(Node());
+		_free = static_cast<int>(_nodes.size()) - 1;
+		_nodes[_free].parent = NIL;
+	}
+	const int index = _free;
+	Node& node = _nodes[index];
+	_free = node.parent;
+	node.parent = NIL;
+	node.left = NIL;
+	node.right = NIL;
+	node.height = 0;
+	node.id = -1;
+	return index;
+}
+
+inline void AABBTree::release(int index) {
+	Node& node = _nodes[index];
+	node.parent = _free;
+	node.height = -1;
+	_free = index;
+}
+
+inline int AABBTree::balance(int iA) {
+	Node& A = _nodes[iA];
+	if (A.isLeaf() || A.height < 2) {
+		return iA;
+	}
+	const int iB = A.left;
+	const int iC = A.right;
+	Node& B = _nodes[iB];
+	Node& C = _nodes[iC];
+	const int diff = C.height - B.height;
+
+	if (diff > 1) {
+		// rotate C up
+		const int iF = C.left;
+		const int iG = C.right;
+		Node& F = _nodes[iF];
+		Node& G = _nodes[iG];
+		C.left = iA;
+		C.parent = A.parent;
+		A.parent = iC;
+		if (C.parent != NIL) {
+			Node& parent = _nodes[C.parent];
+			if (parent.left == iA) {
+				parent.left = iC;
+			} else {
+				parent.right = iC;
+			}
+		} else {
+			_root = iC;
+		}
+		if (F.height > G.height) {
+			C.right = iF;
+			A.right = iG;
+			G.parent = iA;
+			A.box = AABB::merge(B.box, G.box);
+			C.box = AABB::merge(A.box, F.box);
+			A.height = 1 + std::max(B.height, G.height);
+			C.height = 1 + std::max(A.height, F.height);
+		} else {
+			C.right = iG;
+			A.right = iF;
+			F.parent = iA;
+			A.box = AABB::merge(B.box, F.box);
+			C.box = AABB::merge(A.box, G.box);
+			A.height = 1 + std::max(B.height, F.height);
+			C.height = 1 + std::max(A.height, G.height);
+		}
+		return iC;
+	}
+
+	if (diff < -1) {
+		// rotate B up
+		const int iD = B.left;
+		const int iE = B.right;
+		Node& D = _nodes[iD];
+		Node& E = _nodes[iE];
+		B.left = iA;
+		B.parent = A.parent;
+		A.parent = iB;
+		if (B.parent != NIL) {
+			Node& parent = _nodes[B.parent];
+			if (parent.left == iA) {
+				parent.left = iB;
+			} else {
+				parent.right = iB;
+			}
+		} else {
+			_root = iB;
+		}
+		if (D.height > E.height) {
+			B.right = iD;
+			A.left = iE;
+			E.parent = iA;
+			A.box = AABB::merge(C.box, E.box);
+			B.box = AABB::merge(A.box, D.box);
+			A.height = 1 + std::max(C.height, E.height);
+			B.height = 1 + std::max(A.height, D.height);
+		} else {
+			B.right = iE;
+			A.left = iD;
+			D.parent = iA;
+			A.box = AABB::merge(C.box, D.box);
+			B.box = AABB::merge(A.box, E.box);
+			A.height = 1 + std::max(C.height, D.height);
+			B.height = 1 + std::max(A.height, E.height);
+		}
+		return iB;
+	}
+	return iA;
+}
+
+inline void AABBTree::refit(int index) {
+	while (index != NIL) {
+		index = balance(index);
+		Node& node = _nodes[index];
+		const Node& left = _nodes[node.left];
+		const Node& right = _nodes[node.right];
+		node.height = 1 + std::max(left.height, right.height);
+		node.box = AABB::merge(left.box, right.box);
+		index = node.parent;
+	}
+}
+
+inline void AABBTree::insertLeaf(int leaf) {
+	if (_root == NIL) {
+		_root = leaf;
+		_nodes[leaf].parent = NIL;
+		return;
+	}
+	const AABB leafBox = _nodes[leaf].box;
+	// find the sibling that grows the surface of the tree the least
+	int index = _root;
+	while (!_nodes[index].isLeaf()) {
+		const Node& node = _nodes[index];
+		const float area = node.box.surface();
+		const float combinedArea = AABB::merge(node.box, leafBox).surface();
+		// the costs of creating a new parent for this node and the new leaf
+		const float cost = 2.0f * combinedArea;
+		// the minimum costs of pushing the leaf further down the tree
+		const float inheritance = 2.0f * (combinedArea - area);
+		auto descendCost = [&] (int child) {
+			const Node& c = _nodes[child];
+			const float merged = AABB::merge(leafBox, c.box).surface();
+			if (c.isLeaf()) {
+				return merged + inheritance;
+			}
+			return merged - c.box.surface() + inheritance;
+		};
+		const float costLeft = descendCost(node.left);
+		const float costRight = descendCost(node.right);
+		if (cost < costLeft && cost < costRight) {
+			break;
+		}
+		index = costLeft < costRight ? node.left : node.right;
+	}
+	const int sibling = index;
+
+	const int oldParent = _nodes[sibling].parent;
+	const int newParent = allocate();
+	Node& parent = _nodes[newParent];
+	parent.parent = oldParent;
+	parent.box = AABB::merge(leafBox, _nodes[sibling].box);
+	parent.height = _nodes[sibling].height + 1;
+	parent.left = sibling;
+	parent.right = leaf;
+	if (oldParent != NIL) {
+		Node& old = _nodes[oldParent];
+		if (old.left == sibling) {
+			old.left = newParent;
+		} else {
+			old.right = newParent;
+		}
+	} else {
+		_root = newParent;
+	}
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf].parent = newParent;
+	refit(newParent);
+}
+
+inline void AABBTree::removeLeaf(int leaf) {
+	if (leaf == _root) {
+		_root = NIL;
+		return;
+	}
+	const int parent = _nodes[leaf].parent;
+	const int grandParent = _nodes[parent].parent;
+	const int sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+	if (grandParent != NIL) {
+		Node& grand = _nodes[grandParent];
+		if (grand.left == parent) {
+			grand.left = sibling;
+		} else {
+			grand.right = sibling;
+		}
+		_nodes[sibling].parent = grandParent;
+		release(parent);
+		refit(grandParent);
+	} else {
+		_root = sibling;
+		_nodes[sibling].parent = NIL;
+		release(parent);
+	}
+}
+
+inline bool AABBTree::update(CharacterId id, const glm::vec3& position) {
+	auto i = _leaves.find(id);
+	if (i != _leaves.end()) {
+		const int leaf = i->second;
+		Node& node = _nodes[leaf];
+		node.position = position;
+		if (node.box.contains(position)) {
+			return false;
+		}
+		removeLeaf(leaf);
+		_nodes[leaf].box = fatten(position);
+		insertLeaf(leaf);
+		return true;
+	}
+	const int leaf = allocate();
+	Node& node = _nodes[leaf];
+	node.id = id;
+	node.position = position;
+	node.box = fatten(position);
+	_leaves.emplace(id, leaf);
+	insertLeaf(leaf);
+	return true;
+}
+
+inline bool AABBTree::remove(CharacterId id) {
+	auto i = _leaves.find(id);
+	if (i == _leaves.end()) {
+		return false;
+	}
+	const int leaf = i->second;
+	_leaves.erase(i);
+	removeLeaf(leaf);
+	release(leaf);
+	return true;
+}
+
+inline void AABBTree::clear() {
+	_nodes.clear();
+	_leaves.clear();
+	_root = NIL;
+	_free = NIL;
+}
+
+inline int AABBTree::build(std::vector<int>& leaves, std::size_t first, std::size_t last) {
+	if (last - first == 1u) {
+		return leaves[first];
+	}
+	// split at the median of the longest axis of the positions
+	glm::vec3 mins = _nodes[leaves[first]].position;
+	glm::vec3 maxs = mins;
+	for (std::size_t i = first + 1u; i < last; ++i) {
+		const glm::vec3& p = _nodes[leaves[i]].position;
+		mins = glm::min(mins, p);
+		maxs = glm::max(maxs, p);
+	}
+	const glm::vec3 extent = maxs - mins;
+	const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+	const std::size_t mid = first + (last - first) / 2u;
+	std::nth_element(leaves.begin() + first, leaves.begin() + mid, leaves.begin() + last, [this, axis] (int a, int b) {
+		return _nodes[a].position[axis] < _nodes[b].position[axis];
+	});
+	const int left = build(leaves, first, mid);
+	const int right = build(leaves, mid, last);
+	const int index = allocate();
+	Node& node = _nodes[index];
+	node.left = left;
+	node.right = right;
+	node.box = AABB::merge(_nodes[left].box, _nodes[right].box);
+	node.height = 1 + std::max(_nodes[left].height, _nodes[right].height);
+	_nodes[left].parent = index;
+	_nodes[right].parent = index;
+	return index;
+}
+
+inline void AABBTree::build(const Entries& entries) {
+	clear();
+	if (entries.empty()) {
+		return;
+	}
+	_nodes.reserve(entries.size() * 2u);
+	std::vector<int> leaves;
+	leaves.reserve(entries.size());
+	for (const Entry& entry : entries) {
+		auto i = _leaves.find(entry.first);
+		if (i != _leaves.end()) {
+			// the last position wins
+			_nodes[i->second].position = entry.second;
+			_nodes[i->second].box = fatten(entry.second);
+			continue;
+		}
+		const int leaf = allocate();
+		Node& node = _nodes[leaf];
+		node.id = entry.first;
+		node.position = entry.second;
+		node.box = fatten(entry.second);
+		_leaves.emplace(entry.first, leaf);
+		leaves.push_back(leaf);
+	}
+	_root = build(leaves, 0u, leaves.size());
+	_nodes[_root].parent = NIL;
+}
+
+}
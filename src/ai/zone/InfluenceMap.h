@@ -0,0 +1,229 @@
+/**
+ * @file
+ * @ingroup Zone
+ */
+#pragma once
+
+#include "common/Math.h"
+#include "common/Types.h"
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief 2D grids over the x/z plane that answer area questions like "how dangerous is it here" in O(1).
+ *
+ * Each layer is built from seeds: the strengths of the entities are summed up in the cell they are
+ * in. The seeds are then spread to the neighbour cells - each step away from a seed multiplies its value
+ * with the decay of the layer. After @c spread steps a cell holds the strongest decayed seed around it.
+ *
+ * The building is split into steps (@c clear, @c addSeed, @c propagate, @c swap) so the rows can be
+ * propagated in parallel - see @c Zone::setInfluenceMap for the owner that does this once per tick.
+ *
+ * Positions outside of the grid are clamped to the border cells.
+ *
+ * @note Not thread safe
+ */
+class InfluenceMap {
+private:
+	struct Layer {
+		std::string name;
+		float decay;
+		int spread;
+		std::vector<float> seeds;
+		// the result of the last build
+		std::vector<float> values;
+		// ping pong buffers for the propagation
+		std::vector<float> current;
+		std::vector<float> next;
+	};
+
+	const glm::vec3 _mins;
+	const float _cellSize;
+	const float _invCellSize;
+	const int _width;
+	const int _height;
+	std::vector<Layer> _layers;
+
+	inline int column(float x) const {
+		return clamp(static_cast<int>(std::floor((x - _mins.x) * _invCellSize)), 0, _width - 1);
+	}
+
+	inline int row(float z) const {
+		return clamp(static_cast<int>(std::floor((z - _mins.z) * _invCellSize)), 0, _height - 1);
+	}
+
+	inline std::size_t cell(const glm::vec3& position) const {
+		return static_cast<std::size_t>(row(position.z)) * _width + column(position.x);
+	}
+
+public:
+	/**
+	 * @param mins The lower corner of the covered area - the height is ignored
+	 * @param maxs The upper corner of the covered area - the height is ignored
+	 * @param cellSize The edge length of one cell
+	 */
+	InfluenceMap(const glm::vec3& mins, const glm::vec3& maxs, float cellSize) :
+			_mins(mins), _cellSize(cellSize), _invCellSize(1.0f / cellSize),
+			_width(std::max(1, static_cast<int>(std::ceil((maxs.x - mins.x) / cellSize)))),
+			_height(std::max(1, static_cast<int>(std::ceil((maxs.z - mins.z) / cellSize)))) {
+		ai_assert(cellSize > 0.0f, "Invalid cell size given: %f", cellSize);
+	}
+
+	/**
+	 * @param decay The factor a seed is multiplied with per cell it is spread - [0, 1]
+	 * @param spread The amount of cells a seed is spread
+	 * @return The index of the layer - or the index of the existing layer with the given name
+	 */
+	int addLayer(const std::string& name, float decay, int spread);
+
+	/**
+	 * @return The index of the layer with the given name or @c -1
+	 */
+	int getLayer(const std::string& name) const;
+
+	inline int getLayers() const {
+		return static_cast<int>(_layers.size());
+	}
+
+	inline int getWidth() const {
+		return _width;
+	}
+
+	inline int getHeight() const {
+		return _height;
+	}
+
+	inline float getCellSize() const {
+		return _cellSize;
+	}
+
+	/**
+	 * @brief Resets the seeds of all layers - the start of a new build
+	 */
+	void clear();
+
+	/**
+	 * @brief Adds the strength to the cell the position is in
+	 */
+	inline void addSeed(int layer, const glm::vec3& position, float strength) {
+		_layers[layer].seeds[cell(position)] += strength;
+	}
+
+	/**
+	 * @return The amount of propagation steps that are needed for the given layer. Every step
+	 * must be finished for all rows before the next one starts.
+	 */
+	inline int getSteps(int layer) const {
+		return std::max(0, _layers[layer].spread);
+	}
+
+	/**
+	 * @brief Executes the given propagation step for the rows [firstRow, lastRow) of the layer.
+	 * Different rows can be handled in parallel.
+	 */
+	void propagate(int layer, int step, int firstRow, int lastRow);
+
+	/**
+	 * @brief Publishes the propagated values of the layer - call this after all steps are done
+	 */
+	void swap(int layer);
+
+	/**
+	 * @return The value of the cell the position is in
+	 */
+	inline float get(int layer, const glm::vec3& position) const {
+		return _layers[layer].values[cell(position)];
+	}
+
+	/**
+	 * @return The direction in the x/z plane in which the value of the layer rises - the length is the
+	 * change per world unit. Descend the gradient by following the negated vector.
+	 */
+	glm::vec3 getGradient(int layer, const glm::vec3& position) const;
+};
+
+inline int InfluenceMap::addLayer(const std::string& name, float decay, int spread) {
+	const int existing = getLayer(name);
+	if (existing != -1) {
+		return existing;
+	}
+	const std::size_t cells = static_cast<std::size_t>(_width) * _height;
+	Layer layer;
+	layer.name = name;
+	layer.decay = clamp(decay, 0.0f, 1.0f);
+	layer.spread = spread;
+	layer.seeds.assign(cells, 0.0f);
+	layer.values.assign(cells, 0.0f);
+	layer.current.assign(cells, 0.0f);
+	layer.next.assign(cells, 0.0f);
+	_layers.push_back(std::move(layer));
+	return static_cast<int>(_layers.size()) - 1;
+}
+
+inline int InfluenceMap::getLayer(const std::string& name) const {
+	for (std::size_t i = 0; i < _layers.size(); ++i) {
+		if (_layers[i].name == name) {
+			return static_cast<int>(i);
+		}
+	}
+	return -1;
+}
+
+inline void InfluenceMap::clear() {
+	for (Layer& layer : _layers) {
+		std::fill(layer.seeds.begin(), layer.seeds.end(), 0.0f);
+	}
+}
+
+inline void InfluenceMap::propagate(int layerIndex, int step, int firstRow, int lastRow) {
+	Layer& layer = _layers[layerIndex];
+	// the first step reads the seeds directly
+	const std::vector<float>& in = step == 0 ? layer.seeds : ((step & 1) ? layer.current : layer.next);
+	std::vector<float>& out = (step & 1) ? layer.next : layer.current;
+	for (int z = firstRow; z < lastRow; ++z) {
+		const int z0 = std::max(0, z - 1);
+		const int z1 = std::min(_height - 1, z + 1);
+		for (int x = 0; x < _width; ++x) {
+			const int x0 = std::max(0, x - 1);
+			const int x1 = std::min(_width - 1, x + 1);
+			float neighbours = 0.0f;
+			for (int nz = z0; nz <= z1; ++nz) {
+				for (int nx = x0; nx <= x1; ++nx) {
+					neighbours = std::max(neighbours, in[nz * _width + nx]);
+				}
+			}
+			const std::size_t index = static_cast<std::size_t>(z) * _width + x;
+			out[index] = std::max(in[index], neighbours * layer.decay);
+		}
+	}
+}
+
+inline void InfluenceMap::swap(int layerIndex) {
+	Layer& layer = _layers[layerIndex];
+	const int steps = getSteps(layerIndex);
+	if (steps == 0) {
+		layer.values = layer.seeds;
+		return;
+	}
+	// the last step wrote into current if it was even
+	std::swap(layer.values, ((steps - 1) & 1) ? layer.next : layer.current);
+}
+
+inline glm::vec3 InfluenceMap::getGradient(int layerIndex, const glm::vec3& position) const {
+	const Layer& layer = _layers[layerIndex];
+	const int x = column(position.x);
+	const int z = row(position.z);
+	const int x0 = std::max(0, x - 1);
+	const int x1 = std::min(_width - 1, x + 1);
+	const int z0 = std::max(0, z - 1);
+	const int z1 = std::min(_height - 1, z + 1);
+	const float dx = x1 == x0 ? 0.0f : (layer.values[z * _width + x1] - layer.values[z * _width + x0]) / (static_cast<float>(x1 - x0) * _cellSize);
+	const float dz = z1 == z0 ? 0.0f : (layer.values[z1 * _width + x] - layer.values[z0 * _width + x]) / (static_cast<float>(z1 - z0) * _cellSize);
+	return glm::vec3(dx, 0.0f, dz);
+}
+
+}
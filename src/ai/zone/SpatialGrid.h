@@ -0,0 +1,325 @@
+/**
+ * @file
+ * @ingroup Zone
+ */
+#pragma once
+
+#include "common/Math.h"
+#include "common/Distance.h"
+#include "common/Types.h"
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+
+namespace ai {
+
+/**
+ * @brief Collects the k nearest entities with a bounded max heap - the farthest of the current candidates is on
+ * top and is replaced by closer ones. No full sort is needed, just the k candidates are sorted at the end.
+ */
+class NearestNeighbours {
+public:
+	/**
+	 * @brief The squared distance and the id of an entity
+	 */
+	typedef std::pair<float, CharacterId> Neighbour;
+private:
+	std::vector<Neighbour> _heap;
+	const std::size_t _k;
+	const float _maxDistanceSquared;
+public:
+	NearestNeighbours(std::size_t k, float maxDistance) :
+			_k(k), _maxDistanceSquared(maxDistance * maxDistance) {
+		_heap.reserve(k);
+	}
+
+	inline void add(float distanceSquared, CharacterId id) {
+		if (distanceSquared > _maxDistanceSquared || _k == 0u) {
+			return;
+		}
+		if (_heap.size() < _k) {
+			_heap.emplace_back(distanceSquared, id);
+			std::push_heap(_heap.begin(), _heap.end());
+			return;
+		}
+		if (distanceSquared >= _heap.front().first) {
+			return;
+		}
+		std::pop_heap(_heap.begin(), _heap.end());
+		_heap.back() = Neighbour(distanceSquared, id);
+		std::push_heap(_heap.begin(), _heap.end());
+	}
+
+	/**
+	 * @return The squared distance an entity must undercut to become a candidate
+	 */
+	inline float getBoundSquared() const {
+		if (_heap.size() < _k) {
+			return _maxDistanceSquared;
+		}
+		// nothing is accepted if k is 0
+		return _heap.empty() ? -1.0f : _heap.front().first;
+	}
+
+	/**
+	 * @brief Appends the ids of the candidates ordered by their distance - the closest first
+	 * @return The amount of added ids
+	 */
+	std::size_t finish(std::vector<CharacterId>& ids) {
+		std::sort_heap(_heap.begin(), _heap.end());
+		for (const Neighbour& n : _heap) {
+			ids.push_back(n.second);
+		}
+		const std::size_t size = _heap.size();
+		_heap.clear();
+		return size;
+	}
+};
+
+/**
+ * @brief Uniform spatial hash over the x/z plane. Each position is put into the cell of the given
+ * size it falls into - only the occupied cells are stored.
+ *
+ * A radius query only visits the cells that overlap the query circle, so it costs O(neighbours)
+ * instead of O(entities). The height (y) is ignored for the bucketing but not for the distance check.
+ *
+ * @note Not thread safe - the @c Zone guards it with a lock.
+ */
+class SpatialGrid {
+private:
+	/**
+	 * @brief The positions are stored as structure of arrays - so the cells can be checked with the batched distance kernels
+	 */
+	struct Cell {
+		std::vector<CharacterId> ids;
+		PositionArrays positions;
+	};
+	typedef std::unordered_map<int64_t, Cell> Cells;
+	struct Location {
+		int64_t key;
+		// references to the values of an unordered_map stay valid - no matter how many other cells are added
+		Cell* cell;
+		std::size_t slot;
+	};
+	typedef std::unordered_map<CharacterId, Location> Locations;
+
+	const float _cellSize;
+	const float _invCellSize;
+	Cells _cells;
+	Locations _locations;
+
+	inline int32_t coord(float v) const {
+		return static_cast<int32_t>(std::floor(v * _invCellSize));
+	}
+
+	static inline int64_t key(int32_t x, int32_t z) {
+		return static_cast<int64_t>((static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) | static_cast<uint32_t>(z));
+	}
+
+	inline int64_t key(const glm::vec3& position) const {
+		return key(coord(position.x), coord(position.z));
+	}
+
+	void eraseFromCell(const Location& location);
+
+	template<typename Func>
+	void nearestInCell(const Cell& cell, const glm::vec3& center, NearestNeighbours& neighbours, Func& accept) const {
+		Distance::visitSquared(center, cell.positions, [&] (std::size_t index, float distanceSquared) {
+			if (distanceSquared <= neighbours.getBoundSquared() && accept(cell.ids[index])) {
+				neighbours.add(distanceSquared, cell.ids[index]);
+			}
+		});
+	}
+
+	template<typename Func>
+	void visitCell(const Cell& cell, const glm::vec3& center, float radiusSquared, Func& func) const {
+		Distance::visitInRadius(center, radiusSquared, cell.positions, [&] (std::size_t index) {
+			func(cell.ids[index], cell.positions.get(index));
+		});
+	}
+
+public:
+	/**
+	 * @param cellSize The edge length of one cell - should be around the typical query radius
+	 */
+	explicit SpatialGrid(float cellSize) :
+			_cellSize(cellSize), _invCellSize(1.0f / cellSize) {
+		ai_assert(cellSize > 0.0f, "Invalid cell size given: %f", cellSize);
+	}
+
+	inline float getCellSize() const {
+		return _cellSize;
+	}
+
+	/**
+	 * @brief Adds the entity or moves it to the given position
+	 */
+	void update(CharacterId id, const glm::vec3& position);
+
+	/**
+	 * @return @c false if the entity wasn't part of the grid
+	 */
+	bool remove(CharacterId id);
+
+	void clear();
+
+	/**
+	 * @return The amount of entities in the grid
+	 */
+	inline std::size_t size() const {
+		return _locations.size();
+	}
+
+	/**
+	 * @brief Calls the functor with the @c CharacterId and the position of every entity that is not further
+	 * away from the given center than the given radius
+	 */
+	template<typename Func>
+	void visit(const glm::vec3& center, float radius, Func&& func) const {
+		if (radius < 0.0f || _cells.empty()) {
+			return;
+		}
+		const float radiusSquared = radius * radius;
+		const int32_t minX = coord(center.x - radius);
+		const int32_t maxX = coord(center.x + radius);
+		const int32_t minZ = coord(center.z - radius);
+		const int32_t maxZ = coord(center.z + radius);
+		const uint64_t range = static_cast<uint64_t>(static_cast<int64_t>(maxX) - minX + 1) * static_cast<uint64_t>(static_cast<int64_t>(maxZ) - minZ + 1);
+		if (range > _cells.size()) {
+			// huge radius - checking the occupied cells is cheaper than looking up the empty ones
+			for (const auto& e : _cells) {
+				visitCell(e.second, center, radiusSquared, func);
+			}
+			return;
+		}
+		for (int32_t x = minX; x <= maxX; ++x) {
+			for (int32_t z = minZ; z <= maxZ; ++z) {
+				auto i = _cells.find(key(x, z));
+				if (i != _cells.end()) {
+					visitCell(i->second, center, radiusSquared, func);
+				}
+			}
+		}
+	}
+
+	/**
+	 * @brief Finds the @c k entities that are closest to the given center - but not further away than @c maxDistance.
+	 *
+	 * The cells are visited ring by ring around the cell of the center. The search stops as soon as the
+	 * next ring can't contain anything closer than the k candidates that were found so far.
+	 *
+	 * @param accept Called with the @c CharacterId of the entities that are close enough to become a candidate.
+	 * Return @c false to skip the entity.
+	 * @param ids The ids are appended ordered by their distance - the closest first
+	 * @return The amount of ids that were added
+	 */
+	template<typename Func>
+	std::size_t nearest(const glm::vec3& center, std::size_t k, float maxDistance, Func&& accept, std::vector<CharacterId>& ids) const {
+		NearestNeighbours neighbours(k, maxDistance);
+		if (k == 0u || maxDistance < 0.0f || _cells.empty()) {
+			return 0u;
+		}
+		const int64_t cx = coord(center.x);
+		const int64_t cz = coord(center.z);
+		std::size_t visited = 0u;
+		auto visitAt = [&] (int64_t x, int64_t z) {
+			auto i = _cells.find(key(static_cast<int32_t>(x), static_cast<int32_t>(z)));
+			if (i != _cells.end()) {
+				visited += i->second.ids.size();
+				nearestInCell(i->second, center, neighbours, accept);
+			}
+		};
+		for (int64_t ring = 0;; ++ring) {
+			const uint64_t side = static_cast<uint64_t>(2 * ring + 1);
+			if (ring > 0 && side * side > _cells.size()) {
+				// the rings got bigger than the occupied area - check the remaining cells directly
+				for (const auto& e : _cells) {
+					const int64_t x = static_cast<int32_t>(static_cast<uint32_t>(static_cast<uint64_t>(e.first) >> 32));
+					const int64_t z = static_cast<int32_t>(static_cast<uint32_t>(e.first));
+					if (std::max(std::abs(x - cx), std::abs(z - cz)) >= ring) {
+						nearestInCell(e.second, center, neighbours, accept);
+					}
+				}
+				break;
+			}
+			if (ring == 0) {
+				visitAt(cx, cz);
+			} else {
+				for (int64_t x = cx - ring; x <= cx + ring; ++x) {
+					visitAt(x, cz - ring);
+					visitAt(x, cz + ring);
+				}
+				for (int64_t z = cz - ring + 1; z <= cz + ring - 1; ++z) {
+					visitAt(cx - ring, z);
+					visitAt(cx + ring, z);
+				}
+			}
+			if (visited >= _locations.size()) {
+				break;
+			}
+			// everything in the next rings is at least this far away
+			const float reach = static_cast<float>(ring) * _cellSize;
+			if (reach > maxDistance || reach * reach >= neighbours.getBoundSquared()) {
+				break;
+			}
+		}
+		return neighbours.finish(ids);
+	}
+};
+
+inline void SpatialGrid::eraseFromCell(const Location& location) {
+	Cell& cell = *location.cell;
+	const std::size_t last = cell.ids.size() - 1;
+	if (location.slot != last) {
+		cell.ids[location.slot] = cell.ids[last];
+		_locations[cell.ids[location.slot]].slot = location.slot;
+	}
+	cell.ids.pop_back();
+	cell.positions.swapRemove(location.slot);
+	if (cell.ids.empty()) {
+		_cells.erase(location.key);
+	}
+}
+
+inline void SpatialGrid::update(CharacterId id, const glm::vec3& position) {
+	const int64_t k = key(position);
+	auto i = _locations.find(id);
+	if (i != _locations.end()) {
+		Location& location = i->second;
+		if (location.key == k) {
+			location.cell->positions.set(location.slot, position);
+			return;
+		}
+		eraseFromCell(location);
+		Cell& cell = _cells[k];
+		location = Location{k, &cell, cell.ids.size()};
+		cell.ids.push_back(id);
+		cell.positions.push_back(position);
+		return;
+	}
+	Cell& cell = _cells[k];
+	_locations.emplace(id, Location{k, &cell, cell.ids.size()});
+	cell.ids.push_back(id);
+	cell.positions.push_back(position);
+}
+
+inline bool SpatialGrid::remove(CharacterId id) {
+	auto i = _locations.find(id);
+	if (i == _locations.end()) {
+		return false;
+	}
+	const Location location = i->second;
+	_locations.erase(i);
+	eraseFromCell(location);
+	return true;
+}
+
+inline void SpatialGrid::clear() {
+	_cells.clear();
+	_locations.clear();
+}
+
+}
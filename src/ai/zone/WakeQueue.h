@@ -0,0 +1,39 @@
+/**
+ * @file
+ * @ingroup Zone
+ */
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace ai {
+
+class AI;
+typedef std::shared_ptr<AI> AIPtr;
+
+/**
+ * @brief Collects the sleeping @c AI instances that were woken up from any thread. The @c Zone
+ * puts them back into the update in its next @c Zone::update call.
+ */
+class WakeQueue {
+private:
+	std::mutex _mutex;
+	std::vector<AIPtr> _ais;
+public:
+	inline void push(const AIPtr& ai) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_ais.push_back(ai);
+	}
+
+	/**
+	 * @brief Hands over the queued @c AI instances
+	 */
+	inline void swap(std::vector<AIPtr>& ais) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_ais.swap(ais);
+	}
+};
+
+}
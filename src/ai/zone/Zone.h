@@ -19,9 +19,24 @@
 #include "common/ThreadPool.h"
 #include "common/Types.h"
 #include "common/ExecutionTime.h"
+#include "common/TimerWheel.h"
+#include "zone/WakeQueue.h"
+#include "zone/SpatialGrid.h"
+#include "zone/AABBTree.h"
+#include "zone/InfluenceMap.h"
+#include "perception/Stimulus.h"
+#include "world/IWorldQuery.h"
+#include "path/Pathfinder.h"
+#include "path/FlowField.h"
+#include "tree/TreeProgram.h"
 #include <unordered_map>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <limits>
 
 namespace ai {
 
@@ -39,58 +54,634 @@ typedef std::shared_ptr<AI> AIPtr;
  */
 class Zone {
 public:
-	typedef std::unordered_map<CharacterId, AIPtr> AIMap;
+	/**
+	 * @brief Dense storage of the @c AI instances - removals are done by swapping in the last element
+	 */
+	typedef std::vector<AIPtr> AIList;
+	/**
+	 * @brief Maps the @c CharacterId to the slot in the @c AIList
+	 */
+	typedef std::unordered_map<CharacterId, std::size_t> AISlots;
 	typedef std::vector<AIPtr> AIScheduleList;
+	/**
+	 * @brief Returns the strength an entity adds to an influence layer - see @c addInfluenceLayer
+	 */
+	typedef std::function<float(const AIPtr&)> InfluenceSource;
 	typedef std::vector<CharacterId> CharacterIdList;
-	typedef AIMap::const_iterator AIMapConstIter;
-	typedef AIMap::iterator AIMapIter;
+	typedef AISlots::const_iterator AISlotsConstIter;
+	typedef AISlots::iterator AISlotsIter;
+	/**
+	 * @brief Returns the update interval for the given @c AI - see @c AI::setUpdateInterval()
+	 */
+	typedef std::function<int(const AIPtr&)> UpdateIntervalFunc;
 
 protected:
+	/**
+	 * @brief View of the zone members. There are two instances - readers never lock, they just have to
+	 * announce themselves at the published one (see @c ScopedSnapshot). The scheduled changes are applied
+	 * in place to the other instance, which is published afterwards. So a change doesn't copy the members,
+	 * and no matter how many readers overlap, there are never more than the two instances.
+	 */
+	struct Snapshot {
+		AIList ais;
+		AISlots slots;
+		/**
+		 * @brief The amount of threads that are currently reading this instance
+		 */
+		mutable std::atomic_int readers {0};
+	};
+	/**
+	 * @brief A member that was added to (@c ai is set) or removed from the published @c Snapshot
+	 */
+	struct SnapshotChange {
+		AIPtr ai;
+		CharacterId id;
+	};
+	typedef std::vector<SnapshotChange> SnapshotChanges;
+
 	const std::string _name;
-	AIMap _ais;
+	Snapshot _snapshots[2];
+	std::atomic<const Snapshot*> _snapshot;
+	/**
+	 * @brief The changes of the last publish that the other instance doesn't have yet, because it was still
+	 * read - they are replayed on it before the next changes are applied to it
+	 */
+	SnapshotChanges _snapshotChanges;
 	AIScheduleList _scheduledAdd;
 	AIScheduleList _scheduledRemove;
 	CharacterIdList _scheduledDestroy;
 	bool _debug;
+	/**
+	 * @brief The amount of @c update calls (or completed rounds of the time budgeted update) - used to
+	 * find the @c AI instances that are due in an update interval
+	 */
+	uint64_t _tick;
+	/**
+	 * @brief The sum of all the delta times that were given to @c update
+	 */
+	int64_t _time;
+	/**
+	 * @brief The position in @c _round where the next time budgeted update continues
+	 */
+	std::size_t _cursor;
+	/**
+	 * @brief The active entities at the start of the current round of the time budgeted update. Sleeping,
+	 * waking and removing entities reorders @c _active - this list keeps its order until the round is done.
+	 */
+	AIList _round;
+	/**
+	 * @brief The zone time before the update call that started the current round of the time budgeted update
+	 */
+	int64_t _roundStart;
+	std::atomic<int64_t> _lag;
+	UpdateIntervalFunc _updateIntervalFunc;
+	/**
+	 * @brief The mode that was requested by @c setDoubleBuffering - it's applied in the next @c update call
+	 */
+	std::atomic_bool _doubleBuffering {false};
+	/**
+	 * @brief Whether the characters of the members are currently double buffered
+	 */
+	bool _doubleBuffered = false;
+	/**
+	 * @brief Optional spatial indices over the character positions - see @c setSpatialGrid and
+	 * @c setSpatialTree. Only one of them is set.
+	 */
+	std::unique_ptr<SpatialGrid> _grid;
+	std::unique_ptr<AABBTree> _tree;
+	/**
+	 * @brief Set while a mass spawn is applied - the tree is built after all the entities were added
+	 */
+	bool _rebuildSpatialTree = false;
+	ReadWriteLock _spatialLock {"zone-spatial"};
+	StimulusQueue _stimulusQueue;
+	/**
+	 * @brief Optional influence layers - see @c setInfluenceMap. The sources are indexed like the layers.
+	 */
+	std::unique_ptr<InfluenceMap> _influenceMap;
+	std::vector<InfluenceSource> _influenceSources;
+	// the strengths of the entities for all layers - entity major
+	std::vector<float> _influenceStrengths;
+	ReadWriteLock _influenceLock {"zone-influence"};
+	/**
+	 * @brief The game side of the world queries - see @c setWorldQuery
+	 */
+	WorldQueryPtr _worldQuery;
+	ShardedQueue<WorldQuery> _worldQueryQueue;
+	// reused by every flush
+	WorldQueries _worldQueries;
+	WorldQueryResultList _worldQueryResults;
+	std::shared_ptr<Pathfinder> _pathfinder;
+	std::shared_ptr<FlowFields> _flowFields;
+
+	/**
+	 * @brief The @c AI instances that are not sleeping - only these are visited by @c update.
+	 * Only touched by the thread that updates the zone.
+	 */
+	AIList _active;
+	struct SleepRequest {
+		AIPtr ai;
+		int64_t millis;
+		uint32_t wakeups;
+	};
+	std::mutex _sleepRequestsMutex;
+	std::vector<SleepRequest> _sleepRequests;
+	struct SleepTimer {
+		AIPtr ai;
+		uint32_t generation;
+	};
+	TimerWheel<SleepTimer> _sleepTimers;
+	WakeQueue _wakeQueue;
+	/**
+	 * @brief Serializes the publishing of new snapshots - readers don't need it
+	 */
 	ReadWriteLock _lock {"zone"};
 	ReadWriteLock _scheduleLock {"zone-schedulelock"};
 	ai::GroupMgr _groupManager;
-	mutable ThreadPool _threadPool;
+	/**
+	 * @brief Only set if the zone doesn't share the @c ThreadPool of a @c ZoneScheduler
+	 */
+	std::unique_ptr<ThreadPool> _ownThreadPool;
+	ThreadPool* _threadPool;
 
 	/**
-	 * @brief called in the zone update to add new @c AI instances.
-	 *
-	 * @note Make sure to also call @c removeAI whenever you despawn the given @c AI instance
-	 * @note This doesn't lock the zone - but because @c Zone::update already does it
+	 * @brief Gives access to the current @c Snapshot. The snapshot stays unchanged as long as this object lives -
+	 * a reader of the instance that is not published anymore delays the next changes (see @c applyScheduled).
+	 * Nothing is locked - so the functors that are executed for the members may query the zone again.
+	 */
+	class ScopedSnapshot {
+	private:
+		const Snapshot* _snapshot;
+	public:
+		explicit ScopedSnapshot(const Zone& zone) {
+			for (;;) {
+				_snapshot = zone._snapshot.load();
+				++_snapshot->readers;
+				// the changes are only applied to an instance that has no readers after it was replaced - so
+				// if it's still the published one after announcing the reader, it won't be touched until we are done
+				if (zone._snapshot.load() == _snapshot) {
+					break;
+				}
+				--_snapshot->readers;
+			}
+		}
+		~ScopedSnapshot() {
+			--_snapshot->readers;
+		}
+		inline const Snapshot* operator->() const {
+			return _snapshot;
+		}
+	};
+
+	/**
+	 * @brief Removes the @c AI at the given slot by moving the last @c AI into it
+	 */
+	void eraseSlot(Snapshot& snapshot, AISlotsIter i);
+
+	/**
+	 * @brief Adds the @c AI to the end of the given instance
+	 * @return @c false if there is already a member with the given id
+	 */
+	bool insertSlot(Snapshot& snapshot, const CharacterId& id, const AIPtr& ai);
+
+	/**
+	 * @brief Replays the changes that were applied to the published instance on the given one
+	 */
+	void syncSnapshot(Snapshot& snapshot);
+
+	template<typename Func>
+	void doParallelFor(Func& func, std::size_t grainSize) const {
+		const ScopedSnapshot snapshot(*this);
+		const AIList& ais = snapshot->ais;
+		doParallelFor(func, grainSize, ais, 0u, ais.size());
+	}
+
+	/**
+	 * @brief Executes the functor for the @c AI instances in the range [first, last) of the given list
+	 */
+	template<typename Func>
+	void doParallelFor(Func& func, std::size_t grainSize, const AIList& ais, std::size_t first, std::size_t last) const {
+		auto range = [&func, &ais] (std::size_t begin, std::size_t end) {
+			for (std::size_t i = begin; i < end; ++i) {
+				func(ais[i]);
+			}
+		};
+		doParallelRanges(range, grainSize, first, last);
+	}
+
+	/**
+	 * @brief Splits [first, last) into one range per worker (and the calling thread) and calls the
+	 * functor with the bounds of each range
+	 */
+	template<typename Func>
+	void doParallelRanges(Func& func, std::size_t grainSize, std::size_t first, std::size_t last) const {
+		if (first >= last) {
+			return;
+		}
+		const std::size_t n = last - first;
+		const std::size_t ranges = _threadPool->size() + 1u;
+		const std::size_t rangeSize = std::max(std::max(grainSize, std::size_t(1u)), (n + ranges - 1u) / ranges);
+		const std::size_t tasks = (n - 1u) / rangeSize;
+		Latch latch(tasks);
+		for (std::size_t task = 1u; task <= tasks; ++task) {
+			const std::size_t begin = first + task * rangeSize;
+			const std::size_t end = std::min(last, begin + rangeSize);
+			_threadPool->schedule([&func, &latch, begin, end] () {
+				func(begin, end);
+				latch.countDown();
+			});
+		}
+		func(first, first + std::min(n, rangeSize));
+		// help the workers instead of blocking them - we might run inside a task of a shared pool
+		while (!latch.tryWait()) {
+			if (!_threadPool->runPendingTask()) {
+				latch.wait();
+				break;
+			}
+		}
+	}
+
+	/**
+	 * @brief Applies the scheduled adds, removals and destroys in place to the @c Snapshot instance that
+	 * is not published and publishes it. Running iterations keep on using the instance they started with.
+	 * @note The unpublished instance is first brought up to date with the changes of the last publish. If
+	 * it is still read by somebody that started before that publish, nothing is applied and the changes stay
+	 * scheduled for the next call. The replaced instance is synced right away if nobody reads it.
 	 */
-	bool doAddAI(const AIPtr& ai);
+	void applyScheduled();
+
 	/**
-	 * @note This doesn't lock the zone - but because @c Zone::update already does it
+	 * @brief called in the zone update to add new @c AI instances to the snapshot that is going to be published.
+	 *
+	 * @note Make sure to also call @c removeAI whenever you despawn the given @c AI instance
 	 */
-	bool doRemoveAI(const AIPtr& ai);
+	bool doAddAI(Snapshot& snapshot, const AIPtr& ai);
+	bool doRemoveAI(Snapshot& snapshot, const AIPtr& ai);
 	/**
 	 * @brief @c removeAI will access the character and the @c AI object, this method does not need access to the data anymore.
 	 *
 	 * @note That means, that this can be called in case the attached @c ICharacter instances or the @c AI instance itself is
 	 * already invalid.
-	 * @note This doesn't lock the zone - but because @c Zone::update already does it
 	 */
-	bool doDestroyAI(const CharacterId& id);
+	bool doDestroyAI(Snapshot& snapshot, const CharacterId& id);
+
+	/**
+	 * @brief Updates the given @c AI with the zone time that passed since its last update - if it's due in the given tick
+	 */
+	void updateAI(const AIPtr& ai, uint64_t tick);
+
+	/**
+	 * @brief Puts the @c AI back into the list of entities that are updated
+	 */
+	void activate(const AIPtr& ai);
+	/**
+	 * @brief Removes the @c AI from the list of entities that are updated
+	 */
+	void deactivate(const AIPtr& ai);
+	/**
+	 * @brief Puts the @c AI instances to sleep that requested it in the last tick
+	 */
+	void applySleepRequests();
+	/**
+	 * @brief Activates the @c AI instances that were woken up or whose sleep time passed
+	 */
+	void applyWakeups();
+	/**
+	 * @brief Switches the characters of all members to the requested buffering mode
+	 */
+	void applyDoubleBuffering();
+	/**
+	 * @brief Publishes the values that were written to the double buffered characters in the range [first, last) of the given list.
+	 * Runs on the zone thread between the parallel updates - the characters that didn't change are skipped.
+	 */
+	void commitStates(const AIList& ais, std::size_t first, std::size_t last);
+	/**
+	 * @brief Moves the entities in the range [first, last) of the given list to their current position in the spatial index
+	 */
+	void updateSpatialIndex(const AIList& ais, std::size_t first, std::size_t last);
+	/**
+	 * @brief Puts all the members of the given snapshot into the spatial tree in one go
+	 */
+	void buildSpatialTree(const Snapshot& snapshot);
+	/**
+	 * @brief Calls the functor for all the entries of the spatial index in the given radius
+	 * @return @c false if there is no spatial index
+	 * @note The caller must hold the lock of the spatial index
+	 */
+	template<typename Func>
+	bool visitSpatialIndex(const glm::vec3& center, float radius, Func&& func) const {
+		if (_grid) {
+			_grid->visit(center, radius, func);
+			return true;
+		}
+		if (_tree) {
+			_tree->visit(center, radius, func);
+			return true;
+		}
+		return false;
+	}
+	/**
+	 * @brief Hands the stimuli that were emitted since the last tick to the entities in their radius
+	 */
+	void deliverStimuli();
+
+	/**
+	 * @brief Builds the influence layers from the current positions - before the entities are updated,
+	 * so they all read the same values in this tick
+	 */
+	void updateInfluenceMap();
+
+	/**
+	 * @brief Continues building the requested flow fields - before the entities are updated
+	 */
+	void updateFlowFields();
+
+	/**
+	 * @brief Hands the world queries that were submitted during the update of the entities over to
+	 * the @c IWorldQuery in one batch and delivers the results
+	 */
+	void flushWorldQueries();
 
 public:
 	Zone(const std::string& name, int threadCount = std::min(1u, std::thread::hardware_concurrency())) :
-			_name(name), _debug(false), _threadPool(threadCount) {
+			_name(name), _snapshot(&_snapshots[0]), _debug(false), _tick(0u), _time(0), _cursor(0u), _roundStart(0), _lag(0), _ownThreadPool(new ThreadPool(threadCount)), _threadPool(_ownThreadPool.get()) {
+	}
+
+	/**
+	 * @brief Creates a zone that doesn't spawn own threads but uses the given pool.
+	 * @note The pool must outlive the zone. Usually this is the pool of a @c ZoneScheduler, see
+	 * @c ZoneScheduler::getThreadPool
+	 */
+	Zone(const std::string& name, ThreadPool& threadPool) :
+			_name(name), _snapshot(&_snapshots[0]), _debug(false), _tick(0u), _time(0), _cursor(0u), _roundStart(0), _lag(0), _threadPool(&threadPool) {
 	}
 
-	virtual ~Zone() {}
+	virtual ~Zone() {
+		const Snapshot* snapshot = _snapshot.load();
+		for (const AIPtr& ai : snapshot->ais) {
+			ai->_wakeQueue = nullptr;
+			ai->_activeSlot = std::numeric_limits<std::size_t>::max();
+			ai->getCharacter()->setDoubleBuffered(false);
+		}
+	}
 
 	/**
 	 * @brief Update all the @c ICharacter and @c AI instances in this zone.
+	 *
+	 * @c AI instances with an update interval (see @c AI::setUpdateInterval()) are only updated in every
+	 * n-th call. They are staggered by their @c CharacterId - so the entities of one interval are spread
+	 * evenly over the ticks instead of being updated all together in every n-th tick.
+	 *
+	 * Sleeping @c AI instances (see @c AI::sleep()) are not visited at all - the costs of this call only
+	 * depend on the amount of active entities.
+	 *
+	 * The scheduled additions and removals are applied first - unless a caller of e.g. @c execute() that
+	 * started before the previous changes were applied is still iterating. Then they wait for the next call.
+	 *
 	 * @param dt Delta time in millis since the last update call happened
 	 * @note You have to call this on your own.
 	 */
 	void update(int64_t dt);
 
+	/**
+	 * @brief Update as many @c AI instances as fit into the given wall clock budget.
+	 *
+	 * The next call continues with the @c AI instances that were not updated (round robin). Every @c AI
+	 * gets the zone time that passed since its own last update as delta time - so no time is lost for
+	 * those entities that had to wait. Use this to keep a fixed frame time even if the zone suddenly grows.
+	 * At least one @c AI is updated per call, and none is updated twice in the same call - a call ends with the
+	 * last entities of a round even if the budget isn't used up, and the next round starts with the next call.
+	 *
+	 * @param dt Delta time in millis since the last update call happened
+	 * @param budget The time that may be spent for updating the @c AI instances
+	 * @sa getUpdateLag()
+	 */
+	void update(int64_t dt, std::chrono::microseconds budget);
+
+	/**
+	 * @brief How far the time budgeted update is behind: the zone time in millis that passed since the
+	 * current round over all @c AI instances started. @c 0 means that all the entities were updated in the last
+	 * @c update call. If this keeps on growing, the zone is overloaded for the given budget.
+	 */
+	int64_t getUpdateLag() const;
+
+	/**
+	 * @brief Wakes up the sleeping @c AI with the given id - it is updated again in the next @c update call
+	 * @return @c false if the given @c CharacterId wasn't found in this zone
+	 * @sa AI::sleep()
+	 */
+	bool wake(CharacterId id);
+
+	/**
+	 * @brief Double buffer the position, orientation and speed of the characters in this zone.
+	 *
+	 * While the zone is updated every @c AI reads the values of the last tick (e.g. of its selection or
+	 * its group) and only writes the values for the next tick. The zone publishes them once all the
+	 * entities of the tick are updated. The results don't depend on the order in which the workers pick up
+	 * the entities anymore - and reading other characters doesn't race with their updates.
+	 *
+	 * The mode is switched in the next @c update call.
+	 * @note The values that are set for the characters of sleeping @c AI instances are published when they
+	 * are updated again. Call @c ICharacter::commitState() in between two ticks if they should show up earlier.
+	 * @sa ICharacter::getNextPosition()
+	 */
+	void setDoubleBuffering(bool doubleBuffering);
+	bool isDoubleBuffering() const;
+
+	/**
+	 * @brief Maintain a spatial hash of the character positions to answer radius queries (see @c queryRadius)
+	 * in O(neighbours) instead of O(entities).
+	 *
+	 * The positions are taken after every @c update call for the entities that were updated - and when
+	 * entities are added.
+	 * @param cellSize The edge length of a grid cell - should be around the typical query radius. A value
+	 * @c <= 0 removes the grid.
+	 * @note Don't call this while the zone is updated. This replaces the spatial tree.
+	 */
+	void setSpatialGrid(float cellSize);
+	bool hasSpatialGrid() const;
+
+	/**
+	 * @brief Maintain a dynamic bounding volume tree of the character positions instead of a grid - for huge
+	 * and sparse zones with clustered entities (see @c AABBTree).
+	 *
+	 * The tree is updated like the grid. If at least as many entities are added in one @c update call as
+	 * there are already in the zone (e.g. the initial spawn), the tree is built again in one go.
+	 * @param margin The distance an entity may move before it has to be inserted again. A value @c < 0
+	 * removes the tree.
+	 * @note Don't call this while the zone is updated. This replaces the spatial grid.
+	 */
+	void setSpatialTree(float margin);
+	bool hasSpatialTree() const;
+
+	/**
+	 * @brief Collects the ids of all the entities whose characters are not further away from the center than the given radius.
+	 * @note Without a spatial index (see @c setSpatialGrid and @c setSpatialTree) this checks every entity in the zone.
+	 * @return The amount of ids that were added to the given list
+	 */
+	std::size_t queryRadius(const glm::vec3& center, float radius, CharacterIdList& ids) const;
+
+	/**
+	 * @brief Collects the ids of all the entities whose characters are inside the given box.
+	 * @note Without a spatial index (see @c setSpatialGrid and @c setSpatialTree) this checks every entity in the zone.
+	 * The grid answers this with a radius query around the box.
+	 * @return The amount of ids that were added to the given list
+	 */
+	std::size_t queryBox(const glm::vec3& mins, const glm::vec3& maxs, CharacterIdList& ids) const;
+
+	/**
+	 * @brief The entities around the given one (without itself) - with their positions and headings.
+	 *
+	 * The neighbours are gathered once per update of the @c AI (see @c queryRadius) and shared by all the
+	 * callers - a call with a larger radius than before gathers them again.
+	 * @note Only call this from the update of the given @c AI
+	 */
+	const Neighbours& getNeighbours(const AIPtr& ai, float radius) const;
+
+	/**
+	 * @brief Maintain influence layers over the given area - 2D grids that are built once per @c update
+	 * call from all entities of the zone (see @c InfluenceMap and @c addInfluenceLayer).
+	 *
+	 * Questions like "how dangerous is this area" are then answered in O(1) by @c getInfluence instead of
+	 * every entity checking the aggro lists or group members around it.
+	 * @param cellSize The edge length of a cell. A value @c <= 0 removes the map.
+	 * @note This removes all the layers. Don't call this while the zone is updated.
+	 */
+	void setInfluenceMap(const glm::vec3& mins, const glm::vec3& maxs, float cellSize);
+	bool hasInfluenceMap() const;
+
+	/**
+	 * @brief Adds a layer to the influence map. The source is called for every entity once per @c update
+	 * call - in parallel, but before the entities are updated.
+	 *
+	 * @param decay The factor the influence of an entity is multiplied with per cell - see @c InfluenceMap
+	 * @param spread The amount of cells the influence of an entity reaches
+	 * @return @c false if there is no influence map or a layer with the given name already exists
+	 * @note Don't query the influence map from within the source.
+	 * @sa aggroInfluence(), groupInfluence()
+	 */
+	bool addInfluenceLayer(const std::string& name, const InfluenceSource& source, float decay = 0.5f, int spread = 4);
+
+	/**
+	 * @return The value of the given layer at the given position - @c 0 if there is no such layer
+	 */
+	float getInfluence(const std::string& layer, const glm::vec3& position) const;
+
+	/**
+	 * @return The direction in which the value of the given layer rises fastest at the given position
+	 * (see @c InfluenceMap::getGradient()) - @c ZERO if there is no such layer
+	 */
+	glm::vec3 getInfluenceGradient(const std::string& layer, const glm::vec3& position) const;
+
+	/**
+	 * @brief Influence source for threat layers: the highest aggro value of an entity - so entities that
+	 * are fighting make their area dangerous
+	 */
+	static InfluenceSource aggroInfluence();
+
+	/**
+	 * @brief Influence source for ally density layers: @c 1 for each member of the given group
+	 */
+	static InfluenceSource groupInfluence(GroupId id);
+
+	/**
+	 * @brief Collects the ids of the @c k entities whose characters are closest to the given center - ordered by
+	 * their distance, the closest first.
+	 *
+	 * @param accept Called with the @c CharacterId of the candidates - return @c false to skip an entity
+	 * (e.g. the one that is asking).
+	 * @param maxDistance Entities that are further away are ignored
+	 * @note Without a spatial index (see @c setSpatialGrid and @c setSpatialTree) this checks every entity in the zone.
+	 * @return The amount of ids that were added to the given list
+	 */
+	template<typename Func>
+	std::size_t queryNearest(const glm::vec3& center, std::size_t k, float maxDistance, CharacterIdList& ids, const Func& accept) const {
+		{
+			ScopedReadLock scopedLock(_spatialLock);
+			if (_grid) {
+				return _grid->nearest(center, k, maxDistance, accept, ids);
+			}
+			if (_tree) {
+				return _tree->nearest(center, k, maxDistance, accept, ids);
+			}
+		}
+		NearestNeighbours neighbours(k, maxDistance);
+		execute([&] (const AIPtr& ai) {
+			const float distanceSquared = glm::distance2(ai->getCharacter()->getPosition(), center);
+			if (distanceSquared <= neighbours.getBoundSquared() && accept(ai->getId())) {
+				neighbours.add(distanceSquared, ai->getId());
+			}
+		});
+		return neighbours.finish(ids);
+	}
+
+	/**
+	 * @sa queryNearest()
+	 */
+	std::size_t queryNearest(const glm::vec3& center, std::size_t k, float maxDistance, CharacterIdList& ids) const {
+		return queryNearest(center, k, maxDistance, ids, [] (CharacterId) {
+			return true;
+		});
+	}
+
+	/**
+	 * @brief Let all the entities in the given radius perceive something - e.g. an explosion.
+	 *
+	 * This can be called from any thread. The stimuli are delivered to the @c PerceptionMemory of the
+	 * entities (see @c AI::getPerception()) at the beginning of the next @c update call, all in one pass.
+	 * Sleeping entities are woken up.
+	 * @param source The entity that caused the stimulus - or @c AI_NOTHING_SELECTED
+	 * @note The distance is checked against the character positions of the last tick (or the positions in the
+	 * spatial grid if there is one - see @c setSpatialGrid()).
+	 */
+	void emitStimulus(StimulusType type, const glm::vec3& position, float radius, CharacterId source = AI_NOTHING_SELECTED);
+
+	/**
+	 * @brief Set the game side that answers the world queries of the entities (see @c submitWorldQuery()).
+	 * Without one, all the queries fail: rays are blocked and navigation targets can't be reached
+	 * (see @c WorldQueryResult::unanswered()).
+	 * @note Don't call this while the zone is updated
+	 */
+	void setWorldQuery(const WorldQueryPtr& worldQuery);
+	const WorldQueryPtr& getWorldQuery() const;
+
+	/**
+	 * @brief Ask the game world something - e.g. a raycast from a condition.
+	 *
+	 * This can be called from any thread. The queries are collected during the update of the entities and
+	 * handed over to the @c IWorldQuery in one batch after all the entities of the @c update call ran. The
+	 * result is delivered to the requester and can be read in its next update (see @c AI::getWorldResults()).
+	 * Sleeping entities are woken up by the result.
+	 */
+	void submitWorldQuery(const WorldQuery& query);
+
+	/**
+	 * @brief Set the path finding service that is used by the @c MoveTo task of the entities in this zone
+	 * @note Don't call this while the zone is updated
+	 */
+	void setPathfinder(const std::shared_ptr<Pathfinder>& pathfinder);
+	const std::shared_ptr<Pathfinder>& getPathfinder() const;
+
+	/**
+	 * @brief Set the flow fields that are sampled by the @c FlowFieldSeek steering of the entities in this zone.
+	 *
+	 * Use them instead of the @c Pathfinder if a lot of entities head to the same goal - one field per goal
+	 * is built (spread over several @c update calls) and shared by all of them.
+	 * @note Don't call this while the zone is updated
+	 */
+	void setFlowFields(const std::shared_ptr<FlowFields>& flowFields);
+	const std::shared_ptr<FlowFields>& getFlowFields() const;
+
+	/**
+	 * @brief Let the zone decide about the update intervals of the @c AI instances, e.g. by the distance to the players.
+	 *
+	 * The function is called for every @c AI that isn't paused in every @c update call, before the
+	 * zone checks whether the @c AI is due. It is executed in the thread pool - so make sure to
+	 * synchronize it. Pass an empty function to keep the intervals that were set with @c AI::setUpdateInterval().
+	 * @note Don't call this while the zone is updated
+	 */
+	void setUpdateIntervalFunc(const UpdateIntervalFunc& func);
+
 	/**
 	 * @brief If you need to add new @code AI entities to a zone from within the @code AI tick (e.g. spawning via behaviour
 	 * tree) - then you need to schedule the spawn. Otherwise you will end up in a deadlock
@@ -161,21 +752,25 @@ public:
 
 	const GroupMgr& getGroupMgr() const;
 
+	/**
+	 * @return The pool that executes the parallel updates of this zone - might be shared with other zones
+	 */
+	ThreadPool& getThreadPool() const;
+
 	/**
 	 * @brief Lookup for a particular @c AI in the zone.
 	 *
 	 * @return empty @c AIPtr() in the case the given @c CharacterId wasn't found in this zone.
 	 *
-	 * @note This locks the zone for reading to perform the CharacterId lookup
+	 * @note This doesn't lock the zone - the lookup is done in the current @c Snapshot
 	 */
 	inline AIPtr getAI(CharacterId id) const {
-		ScopedReadLock scopedLock(_lock);
-		auto i = _ais.find(id);
-		if (i == _ais.end()) {
+		const ScopedSnapshot snapshot(*this);
+		auto i = snapshot->slots.find(id);
+		if (i == snapshot->slots.end()) {
 			return AIPtr();
 		}
-		const AIPtr& ai = i->second;
-		return ai;
+		return snapshot->ais[i->second];
 	}
 
 	/**
@@ -187,7 +782,7 @@ public:
 	 * We also don't wait for the functor or lambda here, we are scheduling it in a worker in the
 	 * thread pool.
 	 *
-	 * @note This locks the zone for reading to perform the CharacterId lookup
+	 * @note This doesn't lock the zone - the lookup is done in the current @c Snapshot
 	 */
 	template<typename Func>
 	inline bool executeAsync(CharacterId id, const Func& func) const {
@@ -210,7 +805,7 @@ public:
 	template<typename Func>
 	inline auto executeAsync(const AIPtr& ai, const Func& func) const
 		-> std::future<typename std::result_of<Func(const AIPtr&)>::type> {
-		return _threadPool.enqueue(func, ai);
+		return _threadPool->enqueue(func, ai);
 	}
 
 	template<typename Func>
@@ -247,26 +842,44 @@ public:
 		return execute(getAI(id), func);
 	}
 
+	/**
+	 * @brief Executes a lambda or functor for all the @c AI instances in this zone.
+	 *
+	 * The @c AI instances are split into one contiguous range per worker of the thread pool (plus one range
+	 * that is executed by the calling thread). Each range is executed as one task and we are waiting for all
+	 * of them to finish.
+	 *
+	 * @param[in] func The lambda or functor that is called with each @c AIPtr. Make sure to synchronize it.
+	 * @param[in] grainSize The minimum amount of @c AI instances per range. Use this if the work per
+	 * @c AI is so small that the scheduling would outweigh it. @c 0 means that the ranges are only sized
+	 * by the amount of workers.
+	 *
+	 * @note The @c AI instances are not copied - the iteration is done over the @c Snapshot that was
+	 * current when the call started. Changes that are published in the meantime are not visible.
+	 */
+	template<typename Func>
+	void parallelFor(Func& func, std::size_t grainSize = 0u) {
+		doParallelFor(func, grainSize);
+	}
+
+	/**
+	 * @sa parallelFor()
+	 */
+	template<typename Func>
+	void parallelFor(const Func& func, std::size_t grainSize = 0u) const {
+		doParallelFor(func, grainSize);
+	}
+
 	/**
 	 * @brief Executes a lambda or functor for all the @c AI instances in this zone
 	 * @note This is executed in a thread pool - so make sure to synchronize your lambda or functor.
 	 * We are waiting for the execution of this.
 	 *
-	 * @note This locks the zone for reading
+	 * @sa parallelFor()
 	 */
 	template<typename Func>
 	void executeParallel(Func& func) {
-		std::vector<std::future<void> > results;
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
-			results.emplace_back(executeAsync(ai, func));
-		}
-		for (auto & result: results) {
-			result.wait();
-		}
+		doParallelFor(func, 0u);
 	}
 
 	/**
@@ -274,36 +887,24 @@ public:
 	 * @note This is executed in a thread pool - so make sure to synchronize your lambda or functor.
 	 * We are waiting for the execution of this.
 	 *
-	 * @note This locks the zone for reading
+	 * @sa parallelFor()
 	 */
 	template<typename Func>
 	void executeParallel(const Func& func) const {
-		std::vector<std::future<void> > results;
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
-			results.emplace_back(executeAsync(ai, func));
-		}
-		for (auto & result: results) {
-			result.wait();
-		}
+		doParallelFor(func, 0u);
 	}
 
 	/**
 	 * @brief Executes a lambda or functor for all the @c AI instances in this zone
 	 * We are waiting for the execution of this.
 	 *
-	 * @note This locks the zone for reading
+	 * @note The @c AI instances are not copied - the iteration is done over the @c Snapshot that was
+	 * current when the call started. Changes that are published in the meantime are not visible.
 	 */
 	template<typename Func>
 	void execute(const Func& func) const {
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
+		const ScopedSnapshot snapshot(*this);
+		for (const AIPtr& ai : snapshot->ais) {
 			func(ai);
 		}
 	}
@@ -312,22 +913,20 @@ public:
 	 * @brief Executes a lambda or functor for all the @c AI instances in this zone
 	 * We are waiting for the execution of this.
 	 *
-	 * @note This locks the zone for reading
+	 * @note The @c AI instances are not copied - the iteration is done over the @c Snapshot that was
+	 * current when the call started. Changes that are published in the meantime are not visible.
 	 */
 	template<typename Func>
 	void execute(Func& func) {
-		_lock.lockRead();
-		AIMap copy(_ais);
-		_lock.unlockRead();
-		for (auto i = copy.begin(); i != copy.end(); ++i) {
-			const AIPtr& ai = i->second;
+		const ScopedSnapshot snapshot(*this);
+		for (const AIPtr& ai : snapshot->ais) {
 			func(ai);
 		}
 	}
 
 	inline std::size_t size() const {
-		ScopedReadLock scopedLock(_lock);
-		return _ais.size();
+		const ScopedSnapshot snapshot(*this);
+		return snapshot->ais.size();
 	}
 };
 
@@ -339,6 +938,472 @@ inline bool Zone::isDebug () const {
 	return _debug;
 }
 
+inline void Zone::setUpdateIntervalFunc(const UpdateIntervalFunc& func) {
+	_updateIntervalFunc = func;
+}
+
+inline void Zone::setDoubleBuffering(bool doubleBuffering) {
+	_doubleBuffering = doubleBuffering;
+}
+
+inline bool Zone::isDoubleBuffering() const {
+	return _doubleBuffering;
+}
+
+inline void Zone::applyDoubleBuffering() {
+	const bool doubleBuffered = _doubleBuffering;
+	if (_doubleBuffered == doubleBuffered) {
+		return;
+	}
+	_doubleBuffered = doubleBuffered;
+	const ScopedSnapshot snapshot(*this);
+	for (const AIPtr& ai : snapshot->ais) {
+		ai->getCharacter()->setDoubleBuffered(doubleBuffered);
+	}
+}
+
+inline void Zone::commitStates(const AIList& ais, std::size_t first, std::size_t last) {
+	if (!_doubleBuffered) {
+		return;
+	}
+	// the workers are done with these entities - the latch of the parallel update orders their writes
+	// before this point, and the next tasks are only scheduled after it
+	for (std::size_t i = first; i < last; ++i) {
+		ais[i]->getCharacter()->commitState();
+	}
+}
+
+inline void Zone::setSpatialGrid(float cellSize) {
+	ScopedWriteLock scopedLock(_spatialLock);
+	if (cellSize <= 0.0f) {
+		_grid.reset();
+		return;
+	}
+	_tree.reset();
+	_grid.reset(new SpatialGrid(cellSize));
+	const ScopedSnapshot snapshot(*this);
+	for (const AIPtr& ai : snapshot->ais) {
+		const ICharacterPtr& chr = ai->getCharacter();
+		_grid->update(chr->getId(), chr->getPosition());
+	}
+}
+
+inline bool Zone::hasSpatialGrid() const {
+	ScopedReadLock scopedLock(_spatialLock);
+	return (bool)_grid;
+}
+
+inline void Zone::setSpatialTree(float margin) {
+	ScopedWriteLock scopedLock(_spatialLock);
+	if (margin < 0.0f) {
+		_tree.reset();
+		return;
+	}
+	_grid.reset();
+	_tree.reset(new AABBTree(margin));
+	const ScopedSnapshot snapshot(*this);
+	buildSpatialTree(*snapshot.operator->());
+}
+
+inline bool Zone::hasSpatialTree() const {
+	ScopedReadLock scopedLock(_spatialLock);
+	return (bool)_tree;
+}
+
+inline void Zone::buildSpatialTree(const Snapshot& snapshot) {
+	AABBTree::Entries entries;
+	entries.reserve(snapshot.ais.size());
+	for (const AIPtr& ai : snapshot.ais) {
+		const ICharacterPtr& chr = ai->getCharacter();
+		entries.emplace_back(chr->getId(), chr->getPosition());
+	}
+	_tree->build(entries);
+}
+
+inline std::size_t Zone::queryRadius(const glm::vec3& center, float radius, CharacterIdList& ids) const {
+	const std::size_t before = ids.size();
+	{
+		ScopedReadLock scopedLock(_spatialLock);
+		if (visitSpatialIndex(center, radius, [&] (CharacterId id, const glm::vec3&) {
+			ids.push_back(id);
+		})) {
+			return ids.size() - before;
+		}
+	}
+	// gather the positions once and check them with the batched kernel
+	const ScopedSnapshot snapshot(*this);
+	const AIList& ais = snapshot->ais;
+	PositionArrays positions;
+	positions.reserve(ais.size());
+	for (const AIPtr& ai : ais) {
+		positions.push_back(ai->getCharacter()->getPosition());
+	}
+	Distance::visitInRadius(center, radius * radius, positions, [&] (std::size_t index) {
+		ids.push_back(ais[index]->getId());
+	});
+	return ids.size() - before;
+}
+
+inline const Neighbours& Zone::getNeighbours(const AIPtr& ai, float radius) const {
+	Neighbours& neighbours = ai->_neighbours;
+	if (neighbours.covers(radius)) {
+		return neighbours;
+	}
+	static thread_local CharacterIdList ids;
+	ids.clear();
+	const glm::vec3& center = ai->getCharacter()->getPosition();
+	queryRadius(center, radius, ids);
+	std::vector<Neighbour>& list = neighbours.gather(radius);
+	const ScopedSnapshot snapshot(*this);
+	for (CharacterId id : ids) {
+		if (id == ai->getId()) {
+			continue;
+		}
+		auto i = snapshot->slots.find(id);
+		if (i == snapshot->slots.end()) {
+			continue;
+		}
+		const ICharacterPtr& chr = snapshot->ais[i->second]->getCharacter();
+		const glm::vec3& position = chr->getPosition();
+		list.push_back(Neighbour{id, position, fromRadians(chr->getOrientation()), glm::distance(position, center)});
+	}
+	return neighbours;
+}
+
+inline std::size_t Zone::queryBox(const glm::vec3& mins, const glm::vec3& maxs, CharacterIdList& ids) const {
+	const std::size_t before = ids.size();
+	const AABBTree::AABB box{mins, maxs};
+	auto func = [&] (CharacterId id, const glm::vec3& position) {
+		if (box.contains(position)) {
+			ids.push_back(id);
+		}
+	};
+	{
+		ScopedReadLock scopedLock(_spatialLock);
+		if (_tree) {
+			_tree->visitBox(mins, maxs, func);
+			return ids.size() - before;
+		}
+		if (_grid) {
+			const glm::vec3 center = (mins + maxs) * 0.5f;
+			_grid->visit(center, glm::length(maxs - center), func);
+			return ids.size() - before;
+		}
+	}
+	execute([&] (const AIPtr& ai) {
+		const ICharacterPtr& chr = ai->getCharacter();
+		func(chr->getId(), chr->getPosition());
+	});
+	return ids.size() - before;
+}
+
+inline void Zone::updateSpatialIndex(const AIList& ais, std::size_t first, std::size_t last) {
+	ScopedWriteLock scopedLock(_spatialLock);
+	if (_grid) {
+		for (std::size_t i = first; i < last; ++i) {
+			const ICharacterPtr& chr = ais[i]->getCharacter();
+			_grid->update(chr->getId(), chr->getPosition());
+		}
+	} else if (_tree) {
+		for (std::size_t i = first; i < last; ++i) {
+			const ICharacterPtr& chr = ais[i]->getCharacter();
+			_tree->update(chr->getId(), chr->getPosition());
+		}
+	}
+}
+
+inline void Zone::setInfluenceMap(const glm::vec3& mins, const glm::vec3& maxs, float cellSize) {
+	ScopedWriteLock scopedLock(_influenceLock);
+	_influenceSources.clear();
+	if (cellSize <= 0.0f) {
+		_influenceMap.reset();
+		return;
+	}
+	_influenceMap.reset(new InfluenceMap(mins, maxs, cellSize));
+}
+
+inline bool Zone::hasInfluenceMap() const {
+	ScopedReadLock scopedLock(_influenceLock);
+	return (bool)_influenceMap;
+}
+
+inline bool Zone::addInfluenceLayer(const std::string& name, const InfluenceSource& source, float decay, int spread) {
+	ScopedWriteLock scopedLock(_influenceLock);
+	if (!_influenceMap || _influenceMap->getLayer(name) != -1) {
+		return false;
+	}
+	_influenceMap->addLayer(name, decay, spread);
+	_influenceSources.push_back(source);
+	return true;
+}
+
+inline float Zone::getInfluence(const std::string& layer, const glm::vec3& position) const {
+	ScopedReadLock scopedLock(_influenceLock);
+	if (!_influenceMap) {
+		return 0.0f;
+	}
+	const int index = _influenceMap->getLayer(layer);
+	if (index == -1) {
+		return 0.0f;
+	}
+	return _influenceMap->get(index, position);
+}
+
+inline glm::vec3 Zone::getInfluenceGradient(const std::string& layer, const glm::vec3& position) const {
+	ScopedReadLock scopedLock(_influenceLock);
+	if (!_influenceMap) {
+		return ZERO;
+	}
+	const int index = _influenceMap->getLayer(layer);
+	if (index == -1) {
+		return ZERO;
+	}
+	return _influenceMap->getGradient(index, position);
+}
+
+inline Zone::InfluenceSource Zone::aggroInfluence() {
+	return [] (const AIPtr& ai) {
+		const EntryPtr entry = ai->getAggroMgr().getHighestEntry();
+		return entry == nullptr ? 0.0f : entry->getAggro();
+	};
+}
+
+inline Zone::InfluenceSource Zone::groupInfluence(GroupId id) {
+	return [id] (const AIPtr& ai) {
+		const Zone* zone = ai->getZone();
+		return zone != nullptr && zone->getGroupMgr().isInGroup(id, ai) ? 1.0f : 0.0f;
+	};
+}
+
+inline void Zone::updateInfluenceMap() {
+	ScopedWriteLock scopedLock(_influenceLock);
+	if (!_influenceMap || _influenceSources.empty()) {
+		return;
+	}
+	InfluenceMap& map = *_influenceMap;
+	const std::size_t layers = _influenceSources.size();
+	const ScopedSnapshot snapshot(*this);
+	const AIList& ais = snapshot->ais;
+	// the sources might be expensive - ask them in parallel and seed the map afterwards
+	_influenceStrengths.resize(ais.size() * layers);
+	auto strengths = [&] (std::size_t begin, std::size_t end) {
+		for (std::size_t i = begin; i < end; ++i) {
+			for (std::size_t layer = 0u; layer < layers; ++layer) {
+				_influenceStrengths[i * layers + layer] = _influenceSources[layer](ais[i]);
+			}
+		}
+	};
+	doParallelRanges(strengths, 256u, 0u, ais.size());
+	map.clear();
+	for (std::size_t i = 0u; i < ais.size(); ++i) {
+		const glm::vec3& position = ais[i]->getCharacter()->getPosition();
+		for (std::size_t layer = 0u; layer < layers; ++layer) {
+			const float strength = _influenceStrengths[i * layers + layer];
+			if (strength != 0.0f) {
+				map.addSeed(static_cast<int>(layer), position, strength);
+			}
+		}
+	}
+	for (int layer = 0; layer < map.getLayers(); ++layer) {
+		const int steps = map.getSteps(layer);
+		for (int step = 0; step < steps; ++step) {
+			auto rows = [&map, layer, step] (std::size_t begin, std::size_t end) {
+				map.propagate(layer, step, static_cast<int>(begin), static_cast<int>(end));
+			};
+			doParallelRanges(rows, 16u, 0u, static_cast<std::size_t>(map.getHeight()));
+		}
+		map.swap(layer);
+	}
+}
+
+inline void Zone::setWorldQuery(const WorldQueryPtr& worldQuery) {
+	_worldQuery = worldQuery;
+}
+
+inline const WorldQueryPtr& Zone::getWorldQuery() const {
+	return _worldQuery;
+}
+
+inline void Zone::submitWorldQuery(const WorldQuery& query) {
+	_worldQueryQueue.push(query);
+}
+
+inline void Zone::setPathfinder(const std::shared_ptr<Pathfinder>& pathfinder) {
+	_pathfinder = pathfinder;
+}
+
+inline const std::shared_ptr<Pathfinder>& Zone::getPathfinder() const {
+	return _pathfinder;
+}
+
+inline void Zone::setFlowFields(const std::shared_ptr<FlowFields>& flowFields) {
+	_flowFields = flowFields;
+}
+
+inline const std::shared_ptr<FlowFields>& Zone::getFlowFields() const {
+	return _flowFields;
+}
+
+inline void Zone::updateFlowFields() {
+	if (_flowFields) {
+		_flowFields->update();
+	}
+}
+
+inline void Zone::flushWorldQueries() {
+	_worldQueries.clear();
+	_worldQueryQueue.drain(_worldQueries);
+	if (_worldQueries.empty()) {
+		return;
+	}
+	_worldQueryResults.clear();
+	for (const WorldQuery& query : _worldQueries) {
+		_worldQueryResults.push_back(WorldQueryResult::unanswered(query));
+	}
+	if (_worldQuery) {
+		_worldQuery->execute(_worldQueries, _worldQueryResults);
+	} else {
+		ai_log_warn("Zone %s: %i world queries without an IWorldQuery", _name.c_str(), static_cast<int>(_worldQueries.size()));
+	}
+	const ScopedSnapshot snapshot(*this);
+	for (const WorldQueryResult& result : _worldQueryResults) {
+		auto i = snapshot->slots.find(result.query.requester);
+		if (i == snapshot->slots.end()) {
+			continue;
+		}
+		const AIPtr& ai = snapshot->ais[i->second];
+		ai->_worldResults.deliver(result);
+		ai->wake();
+	}
+}
+
+inline void Zone::emitStimulus(StimulusType type, const glm::vec3& position, float radius, CharacterId source) {
+	_stimulusQueue.push(Stimulus{type, position, radius, source});
+}
+
+inline void Zone::deliverStimuli() {
+	std::vector<Stimulus> stimuli;
+	_stimulusQueue.drain(stimuli);
+	if (stimuli.empty()) {
+		return;
+	}
+	const ScopedSnapshot snapshot(*this);
+	auto deliver = [this] (const AIPtr& ai, const Stimulus& stimulus) {
+		// the time of the entity if it would be updated right now
+		const int64_t time = ai->_time + (_time - ai->_lastZoneUpdate);
+		ai->_perception.perceive(stimulus, time);
+		ai->wake();
+	};
+	{
+		ScopedReadLock scopedLock(_spatialLock);
+		if (_grid || _tree) {
+			for (const Stimulus& stimulus : stimuli) {
+				visitSpatialIndex(stimulus.position, stimulus.radius, [&] (CharacterId id, const glm::vec3&) {
+					auto i = snapshot->slots.find(id);
+					if (i != snapshot->slots.end()) {
+						deliver(snapshot->ais[i->second], stimulus);
+					}
+				});
+			}
+			return;
+		}
+	}
+	// bucket the stimuli instead - then every entity only has to look into the cells around it
+	float maxRadius = 0.0f;
+	for (const Stimulus& stimulus : stimuli) {
+		maxRadius = std::max(maxRadius, stimulus.radius);
+	}
+	SpatialGrid buckets(std::max(maxRadius, 1.0f));
+	for (std::size_t i = 0u; i < stimuli.size(); ++i) {
+		buckets.update(static_cast<CharacterId>(i), stimuli[i].position);
+	}
+	for (const AIPtr& ai : snapshot->ais) {
+		const glm::vec3& position = ai->getCharacter()->getPosition();
+		buckets.visit(position, maxRadius, [&] (CharacterId index, const glm::vec3&) {
+			const Stimulus& stimulus = stimuli[index];
+			if (glm::distance2(position, stimulus.position) <= stimulus.radius * stimulus.radius) {
+				deliver(ai, stimulus);
+			}
+		});
+	}
+}
+
+inline int64_t Zone::getUpdateLag() const {
+	return _lag;
+}
+
+inline bool Zone::wake(CharacterId id) {
+	const AIPtr& ai = getAI(id);
+	if (!ai) {
+		return false;
+	}
+	ai->wake();
+	return true;
+}
+
+inline void Zone::activate(const AIPtr& ai) {
+	if (ai->_activeSlot != std::numeric_limits<std::size_t>::max()) {
+		return;
+	}
+	ai->_activeSlot = _active.size();
+	_active.push_back(ai);
+}
+
+inline void Zone::deactivate(const AIPtr& ai) {
+	const std::size_t slot = ai->_activeSlot;
+	if (slot == std::numeric_limits<std::size_t>::max()) {
+		return;
+	}
+	ai->_activeSlot = std::numeric_limits<std::size_t>::max();
+	const std::size_t last = _active.size() - 1;
+	if (slot != last) {
+		_active[slot] = std::move(_active[last]);
+		_active[slot]->_activeSlot = slot;
+	}
+	_active.pop_back();
+}
+
+inline void Zone::applySleepRequests() {
+	std::vector<SleepRequest> requests;
+	{
+		std::unique_lock<std::mutex> lock(_sleepRequestsMutex);
+		requests.swap(_sleepRequests);
+	}
+	for (const SleepRequest& request : requests) {
+		const AIPtr& ai = request.ai;
+		if (ai->_wakeQueue != &_wakeQueue || ai->_wakeups != request.wakeups) {
+			// removed from the zone or already woken up again
+			continue;
+		}
+		deactivate(ai);
+		const uint32_t generation = ++ai->_sleepGeneration;
+		ai->_sleeping = true;
+		if (request.millis >= 0) {
+			_sleepTimers.add(_time + request.millis, SleepTimer{ai, generation});
+		}
+		// a wake() call that didn't see the sleeping flag yet
+		if (ai->_wakeups != request.wakeups && ai->_sleeping.exchange(false)) {
+			activate(ai);
+		}
+	}
+}
+
+inline void Zone::applyWakeups() {
+	std::vector<AIPtr> woken;
+	_wakeQueue.swap(woken);
+	for (const AIPtr& ai : woken) {
+		if (ai->_wakeQueue == &_wakeQueue && ai->_sleeping.exchange(false)) {
+			activate(ai);
+		}
+	}
+	_sleepTimers.advance(_time, [this] (const SleepTimer& timer) {
+		const AIPtr& ai = timer.ai;
+		if (ai->_sleepGeneration == timer.generation && ai->_wakeQueue == &_wakeQueue && ai->_sleeping.exchange(false)) {
+			activate(ai);
+		}
+	});
+}
+
 inline const std::string& Zone::getName() const {
 	return _name;
 }
@@ -351,40 +1416,107 @@ inline const GroupMgr& Zone::getGroupMgr() const {
 	return _groupManager;
 }
 
-inline bool Zone::doAddAI(const AIPtr& ai) {
+inline ThreadPool& Zone::getThreadPool() const {
+	return *_threadPool;
+}
+
+inline void Zone::eraseSlot(Snapshot& snapshot, AISlotsIter i) {
+	AIList& ais = snapshot.ais;
+	const std::size_t slot = i->second;
+	const std::size_t last = ais.size() - 1;
+	snapshot.slots.erase(i);
+	if (slot != last) {
+		AIPtr& moved = ais[slot];
+		moved = std::move(ais[last]);
+		snapshot.slots[moved->getCharacter()->getId()] = slot;
+	}
+	ais.pop_back();
+}
+
+inline bool Zone::insertSlot(Snapshot& snapshot, const CharacterId& id, const AIPtr& ai) {
+	if (!snapshot.slots.insert(std::make_pair(id, snapshot.ais.size())).second) {
+		return false;
+	}
+	snapshot.ais.push_back(ai);
+	return true;
+}
+
+inline bool Zone::doAddAI(Snapshot& snapshot, const AIPtr& ai) {
 	if (ai == nullptr) {
 		return false;
 	}
 	const CharacterId& id = ai->getCharacter()->getId();
-	if (_ais.find(id) != _ais.end()) {
+	if (!insertSlot(snapshot, id, ai)) {
 		return false;
 	}
-	_ais.insert(std::make_pair(id, ai));
+	_snapshotChanges.push_back(SnapshotChange{ai, id});
 	ai->setZone(this);
+	ai->_lastZoneUpdate = _time;
+	ai->_sleeping = false;
+	ai->_wakeQueue = &_wakeQueue;
+	// an entity is only active in one zone
+	ai->_activeSlot = std::numeric_limits<std::size_t>::max();
+	activate(ai);
+	const ICharacterPtr& chr = ai->getCharacter();
+	chr->setDoubleBuffered(_doubleBuffered);
+	if (_grid) {
+		ScopedWriteLock scopedLock(_spatialLock);
+		_grid->update(id, chr->getPosition());
+	} else if (_tree && !_rebuildSpatialTree) {
+		ScopedWriteLock scopedLock(_spatialLock);
+		_tree->update(id, chr->getPosition());
+	}
 	return true;
 }
 
-inline bool Zone::doRemoveAI(const AIPtr& ai) {
+inline bool Zone::doRemoveAI(Snapshot& snapshot, const AIPtr& ai) {
 	if (!ai) {
 		return false;
 	}
 	const CharacterId& id = ai->getCharacter()->getId();
-	AIMapIter i = _ais.find(id);
-	if (i == _ais.end()) {
+	AISlotsIter i = snapshot.slots.find(id);
+	if (i == snapshot.slots.end()) {
 		return false;
 	}
-	i->second->setZone(nullptr);
-	_groupManager.removeFromAllGroups(i->second);
-	_ais.erase(i);
+	const AIPtr& removed = snapshot.ais[i->second];
+	removed->setZone(nullptr);
+	removed->_wakeQueue = nullptr;
+	removed->_sleeping = false;
+	++removed->_sleepGeneration;
+	deactivate(removed);
+	removed->getCharacter()->setDoubleBuffered(false);
+	if (_grid) {
+		ScopedWriteLock scopedLock(_spatialLock);
+		_grid->remove(id);
+	} else if (_tree) {
+		ScopedWriteLock scopedLock(_spatialLock);
+		_tree->remove(id);
+	}
+	_groupManager.removeFromAllGroups(removed);
+	_snapshotChanges.push_back(SnapshotChange{AIPtr(), id});
+	eraseSlot(snapshot, i);
 	return true;
 }
 
-inline bool Zone::doDestroyAI(const CharacterId& id) {
-	AIMapIter i = _ais.find(id);
-	if (i == _ais.end()) {
+inline bool Zone::doDestroyAI(Snapshot& snapshot, const CharacterId& id) {
+	AISlotsIter i = snapshot.slots.find(id);
+	if (i == snapshot.slots.end()) {
 		return false;
 	}
-	_ais.erase(i);
+	const AIPtr& destroyed = snapshot.ais[i->second];
+	destroyed->_wakeQueue = nullptr;
+	destroyed->_sleeping = false;
+	++destroyed->_sleepGeneration;
+	deactivate(destroyed);
+	if (_grid) {
+		ScopedWriteLock scopedLock(_spatialLock);
+		_grid->remove(id);
+	} else if (_tree) {
+		ScopedWriteLock scopedLock(_spatialLock);
+		_tree->remove(id);
+	}
+	_snapshotChanges.push_back(SnapshotChange{AIPtr(), id});
+	eraseSlot(snapshot, i);
 	return true;
 }
 
@@ -412,40 +1544,177 @@ inline bool Zone::removeAI(const AIPtr& ai) {
 	return true;
 }
 
-inline void Zone::update(int64_t dt) {
-	{
-		AIScheduleList scheduledRemove;
-		AIScheduleList scheduledAdd;
-		CharacterIdList scheduledDestroy;
-		{
-			ScopedWriteLock scopedLock(_scheduleLock);
-			scheduledAdd.swap(_scheduledAdd);
-			scheduledRemove.swap(_scheduledRemove);
-			scheduledDestroy.swap(_scheduledDestroy);
-		}
-		ScopedWriteLock scopedLock(_lock);
-		for (const AIPtr& ai : scheduledAdd) {
-			doAddAI(ai);
-		}
-		scheduledAdd.clear();
-		for (const AIPtr& ai : scheduledRemove) {
-			doRemoveAI(ai);
+inline void Zone::syncSnapshot(Snapshot& snapshot) {
+	// in the order the changes were applied to the published instance - so both end up with the same slots
+	for (const SnapshotChange& change : _snapshotChanges) {
+		if (change.ai) {
+			insertSlot(snapshot, change.id, change.ai);
+		} else {
+			eraseSlot(snapshot, snapshot.slots.find(change.id));
 		}
-		scheduledRemove.clear();
-		for (auto id : scheduledDestroy) {
-			doDestroyAI(id);
-		}
-		scheduledDestroy.clear();
 	}
+	_snapshotChanges.clear();
+}
 
-	auto func = [&] (const AIPtr& ai) {
-		if (ai->isPause()) {
-			return;
-		}
-		ai->update(dt, _debug);
+inline void Zone::applyScheduled() {
+	AIScheduleList scheduledRemove;
+	AIScheduleList scheduledAdd;
+	CharacterIdList scheduledDestroy;
+	ScopedWriteLock scopedLock(_lock);
+	Snapshot& next = _snapshot.load() == &_snapshots[0] ? _snapshots[1] : _snapshots[0];
+	if (next.readers > 0) {
+		// somebody that started before the last publish still reads it - the changes stay scheduled
+		return;
+	}
+	syncSnapshot(next);
+	{
+		ScopedWriteLock scopedScheduleLock(_scheduleLock);
+		scheduledAdd.swap(_scheduledAdd);
+		scheduledRemove.swap(_scheduledRemove);
+		scheduledDestroy.swap(_scheduledDestroy);
+	}
+	if (scheduledAdd.empty() && scheduledRemove.empty() && scheduledDestroy.empty()) {
+		return;
+	}
+	next.ais.reserve(next.ais.size() + scheduledAdd.size());
+	// a mass spawn - building the tree in one go is cheaper than inserting the entities one by one
+	_rebuildSpatialTree = _tree && scheduledAdd.size() >= _tree->size();
+	for (const AIPtr& ai : scheduledAdd) {
+		doAddAI(next, ai);
+	}
+	for (const AIPtr& ai : scheduledRemove) {
+		doRemoveAI(next, ai);
+	}
+	for (auto id : scheduledDestroy) {
+		doDestroyAI(next, id);
+	}
+	if (_rebuildSpatialTree) {
+		_rebuildSpatialTree = false;
+		ScopedWriteLock scopedSpatialLock(_spatialLock);
+		buildSpatialTree(next);
+	}
+	_snapshot.store(&next);
+	Snapshot& previous = &next == &_snapshots[0] ? _snapshots[1] : _snapshots[0];
+	if (previous.readers == 0) {
+		// a reader that loads it from now on sees that it isn't published anymore - and the removed
+		// members shouldn't be kept alive until the next changes
+		syncSnapshot(previous);
+	}
+}
+
+inline void Zone::updateAI(const AIPtr& ai, uint64_t tick) {
+	if (ai->isPause()) {
+		// paused entities don't collect the time
+		ai->_lastZoneUpdate = _time;
+		return;
+	}
+	if (_updateIntervalFunc) {
+		ai->setUpdateInterval(_updateIntervalFunc(ai));
+	}
+	const uint64_t interval = static_cast<uint64_t>(ai->_updateInterval);
+	if (interval > 1u && (tick + static_cast<uint32_t>(ai->getId())) % interval != 0u) {
+		return;
+	}
+	const int64_t dt = _time - ai->_lastZoneUpdate;
+	ai->_lastZoneUpdate = _time;
+	ai->update(dt, _debug);
+	const TreeProgramPtr& program = ai->_program;
+	if (program && program->getRoot() == ai->_behaviour) {
+		program->execute(ai, dt);
+	} else {
 		ai->getBehaviour()->execute(ai, dt);
+	}
+	if (ai->_sleepRequested) {
+		ai->_sleepRequested = false;
+		std::unique_lock<std::mutex> lock(_sleepRequestsMutex);
+		_sleepRequests.push_back(SleepRequest{ai, ai->_sleepMillis, ai->_wakeups});
+	}
+}
+
+inline void Zone::update(int64_t dt) {
+	applyScheduled();
+	applyDoubleBuffering();
+	_time += dt;
+	deliverStimuli();
+	applyWakeups();
+	updateInfluenceMap();
+	updateFlowFields();
+	const uint64_t tick = _tick++;
+
+	auto func = [this, tick] (const AIPtr& ai) {
+		updateAI(ai, tick);
 	};
-	executeParallel(func);
+	doParallelFor(func, 0u, _active, 0u, _active.size());
+	commitStates(_active, 0u, _active.size());
+	updateSpatialIndex(_active, 0u, _active.size());
+	flushWorldQueries();
+	applySleepRequests();
+	_cursor = 0u;
+	_round.clear();
+	_lag = 0;
+	_groupManager.update(dt);
+}
+
+inline void Zone::update(int64_t dt, std::chrono::microseconds budget) {
+	// the amount of entities that are updated before the cost per entity is known
+	static const std::size_t FIRST_CHUNK = 64u;
+	const auto start = std::chrono::steady_clock::now();
+	applyScheduled();
+	applyDoubleBuffering();
+	_time += dt;
+	deliverStimuli();
+	applyWakeups();
+	updateInfluenceMap();
+	updateFlowFields();
+
+	if (_cursor > 0u) {
+		// drop the entities that went to sleep or left the zone since the last call - the order of the
+		// others is kept, so nobody is skipped or updated twice in this round. Woken entities join the next one.
+		_round.erase(std::remove_if(_round.begin() + _cursor, _round.end(), [] (const AIPtr& ai) {
+			return ai->_activeSlot == std::numeric_limits<std::size_t>::max();
+		}), _round.end());
+		if (_cursor == _round.size()) {
+			_cursor = 0u;
+			++_tick;
+		}
+	}
+	if (_cursor == 0u) {
+		_round = _active;
+		_roundStart = _time - dt;
+	}
+	std::size_t processed = 0u;
+	std::size_t chunk = (_threadPool->size() + 1u) * FIRST_CHUNK;
+	while (_cursor < _round.size()) {
+		const std::size_t count = std::min(chunk, _round.size() - _cursor);
+		const uint64_t tick = _tick;
+		auto func = [this, tick] (const AIPtr& ai) {
+			updateAI(ai, tick);
+		};
+		doParallelFor(func, 0u, _round, _cursor, _cursor + count);
+		commitStates(_round, _cursor, _cursor + count);
+		updateSpatialIndex(_round, _cursor, _cursor + count);
+		processed += count;
+		_cursor += count;
+		if (_cursor == _round.size()) {
+			// the next round starts with the next call - the swap-and-pop of removals and sleeps might have
+			// moved entities that were already updated in this call to the front of the active list
+			_cursor = 0u;
+			++_tick;
+			_round.clear();
+			break;
+		}
+		const auto elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed >= budget) {
+			break;
+		}
+		// size the next chunk by the measured cost per entity
+		const double perEntity = std::chrono::duration<double>(elapsed).count() / processed;
+		const double remaining = std::chrono::duration<double>(budget - elapsed).count();
+		chunk = std::max(std::size_t(1u), static_cast<std::size_t>(remaining / std::max(perEntity, 1e-9)));
+	}
+	flushWorldQueries();
+	applySleepRequests();
+	_lag = _cursor == 0u ? 0 : _time - _roundStart;
 	_groupManager.update(dt);
 }
 
@@ -0,0 +1,218 @@
+/**
+ * @file
+ * @ingroup Zone
+ */
+#pragma once
+
+#include "zone/Zone.h"
+#include "common/Thread.h"
+#include "common/ThreadPool.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+namespace ai {
+
+/**
+ * @brief Updates many @c Zone instances with one @c ThreadPool that is sized to the machine.
+ *
+ * Every zone that is created with its own thread pool spawns own threads - with a lot of zones
+ * you end up with far more threads than cores. Create your zones with the pool of the scheduler
+ * instead (see @c getThreadPool) and register them here. @c ZoneScheduler::update will then
+ * tick all the registered zones in parallel, while the zones still split their own @c AI instances
+ * over the same workers.
+ *
+ * The zones that took the most time in the last ticks are started first - that way the busy
+ * zones are spread over the workers and the small ones fill the gaps.
+ *
+ * @code
+ * ai::ZoneScheduler scheduler;
+ * ai::Zone zone1("zone1", scheduler.getThreadPool());
+ * ai::Zone zone2("zone2", scheduler.getThreadPool());
+ * scheduler.addZone(&zone1);
+ * scheduler.addZone(&zone2);
+ * [...]
+ * scheduler.update(dt);
+ * @endcode
+ */
+class ZoneScheduler {
+public:
+	/**
+	 * @brief The tick cost of a registered @c Zone
+	 */
+	struct ZoneStats {
+		Zone* zone;
+		/**
+		 * @brief The microseconds the last @c Zone::update call took
+		 */
+		int64_t lastMicros;
+		/**
+		 * @brief The smoothed microseconds of the @c Zone::update calls
+		 */
+		int64_t averageMicros;
+		/**
+		 * @brief The amount of @c Zone::update calls
+		 */
+		int64_t ticks;
+	};
+	typedef std::vector<ZoneStats> ZoneStatsList;
+
+protected:
+	struct Entry {
+		explicit Entry(Zone* _zone) :
+				zone(_zone), lastMicros(0), averageMicros(0), ticks(0) {
+		}
+		Zone* zone;
+		std::atomic<int64_t> lastMicros;
+		std::atomic<int64_t> averageMicros;
+		std::atomic<int64_t> ticks;
+	};
+	typedef std::vector<std::unique_ptr<Entry> > Entries;
+
+	ThreadPool _threadPool;
+	Entries _entries;
+	ReadWriteLock _lock {"zonescheduler"};
+
+	void updateZone(Entry& entry, int64_t dt);
+
+public:
+	explicit ZoneScheduler(std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency())) :
+			_threadPool(threadCount) {
+	}
+
+	/**
+	 * @brief The pool that you should give to the @c Zone instances that are registered here
+	 */
+	ThreadPool& getThreadPool();
+
+	/**
+	 * @note The zone should use the pool of this scheduler - see @c getThreadPool
+	 * @return @c false if the zone was already registered
+	 */
+	bool addZone(Zone* zone);
+
+	/**
+	 * @return @c false if the zone wasn't registered
+	 */
+	bool removeZone(Zone* zone);
+
+	std::size_t size() const;
+
+	/**
+	 * @brief Updates all the registered zones and waits until they are done
+	 * @param dt Delta time in millis since the last update call happened
+	 */
+	void update(int64_t dt);
+
+	/**
+	 * @brief Query the tick cost of a single zone
+	 * @return @c false if the zone isn't registered
+	 */
+	bool getStats(const Zone* zone, ZoneStats& stats) const;
+
+	/**
+	 * @brief The tick costs of all the registered zones
+	 */
+	ZoneStatsList getStats() const;
+};
+
+inline ThreadPool& ZoneScheduler::getThreadPool() {
+	return _threadPool;
+}
+
+inline bool ZoneScheduler::addZone(Zone* zone) {
+	ai_assert(&zone->getThreadPool() == &_threadPool, "Zone %s doesn't use the pool of the scheduler", zone->getName().c_str());
+	ScopedWriteLock scopedLock(_lock);
+	for (const std::unique_ptr<Entry>& entry : _entries) {
+		if (entry->zone == zone) {
+			return false;
+		}
+	}
+	_entries.emplace_back(new Entry(zone));
+	return true;
+}
+
+inline bool ZoneScheduler::removeZone(Zone* zone) {
+	ScopedWriteLock scopedLock(_lock);
+	for (auto i = _entries.begin(); i != _entries.end(); ++i) {
+		if ((*i)->zone == zone) {
+			_entries.erase(i);
+			return true;
+		}
+	}
+	return false;
+}
+
+inline std::size_t ZoneScheduler::size() const {
+	ScopedReadLock scopedLock(_lock);
+	return _entries.size();
+}
+
+inline void ZoneScheduler::updateZone(Entry& entry, int64_t dt) {
+	const auto start = std::chrono::steady_clock::now();
+	entry.zone->update(dt);
+	const int64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+	const int64_t average = entry.averageMicros;
+	entry.lastMicros = micros;
+	// the first tick is taken as is - afterwards we smooth out the spikes
+	entry.averageMicros = entry.ticks == 0 ? micros : average + (micros - average) / 8;
+	++entry.ticks;
+}
+
+inline void ZoneScheduler::update(int64_t dt) {
+	// the zones can't get removed while they are updated
+	ScopedReadLock scopedLock(_lock);
+	if (_entries.empty()) {
+		return;
+	}
+	std::vector<Entry*> order;
+	order.reserve(_entries.size());
+	for (const std::unique_ptr<Entry>& entry : _entries) {
+		order.push_back(entry.get());
+	}
+	std::stable_sort(order.begin(), order.end(), [] (const Entry* a, const Entry* b) {
+		return a->averageMicros > b->averageMicros;
+	});
+	Latch latch(order.size());
+	for (Entry* entry : order) {
+		_threadPool.schedule([this, entry, dt, &latch] () {
+			updateZone(*entry, dt);
+			latch.countDown();
+		});
+	}
+	while (!latch.tryWait()) {
+		if (!_threadPool.runPendingTask()) {
+			latch.wait();
+			break;
+		}
+	}
+}
+
+inline bool ZoneScheduler::getStats(const Zone* zone, ZoneStats& stats) const {
+	ScopedReadLock scopedLock(_lock);
+	for (const std::unique_ptr<Entry>& entry : _entries) {
+		if (entry->zone != zone) {
+			continue;
+		}
+		stats.zone = entry->zone;
+		stats.lastMicros = entry->lastMicros;
+		stats.averageMicros = entry->averageMicros;
+		stats.ticks = entry->ticks;
+		return true;
+	}
+	return false;
+}
+
+inline ZoneScheduler::ZoneStatsList ZoneScheduler::getStats() const {
+	ScopedReadLock scopedLock(_lock);
+	ZoneStatsList list;
+	list.reserve(_entries.size());
+	for (const std::unique_ptr<Entry>& entry : _entries) {
+		list.push_back(ZoneStats{entry->zone, entry->lastMicros, entry->averageMicros, entry->ticks});
+	}
+	return list;
+}
+
+}
@@ -29,7 +29,7 @@ GameEntity::GameEntity(const ai::CharacterId& id, const ai::example::GameMap* ma
 void GameEntity::update(int64_t /*deltaTime*/, bool debuggingActive) {
 	// cap position to the map
 	const float sizeF = static_cast<float>(_map->getSize());
-	const glm::vec3& currentPos = _position;
+	const glm::vec3 currentPos = getNextPosition();
 	glm::vec3 newPos(currentPos);
 	if (currentPos.x < -sizeF) {
 		newPos.x = sizeF;
@@ -41,7 +41,9 @@ void GameEntity::update(int64_t /*deltaTime*/, bool debuggingActive) {
 	} else if (currentPos.z > sizeF) {
 		newPos.z = -sizeF;
 	}
-	setPosition(newPos);
+	if (newPos != currentPos) {
+		setPosition(newPos);
+	}
 
 	// update attributes for debugging
 	if (debuggingActive) {
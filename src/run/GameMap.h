@@ -51,7 +51,7 @@ public:
 
 	inline void addEntity(const ai::AIPtr& entity, GroupId groupId) {
 		{
-			ai::ScopedReadLock lock(_lock);
+			ai::ScopedWriteLock lock(_lock);
 			_entities.insert(std::make_pair(entity->getId(), entity));
 		}
 		ai_assert_always(_zone.addAI(entity), "Could not add entity to zone with id %i", entity->getId());
@@ -68,7 +68,7 @@ public:
 	}
 
 	inline bool remove(const ai::CharacterId& id) {
-		ai::ScopedReadLock lock(_lock);
+		ai::ScopedWriteLock lock(_lock);
 		auto iter = _entities.find(id);
 		if (iter == _entities.end())
 			return false;
@@ -83,8 +83,15 @@ public:
 		return remove(entity->getId());
 	}
 
-	inline void update(int64_t dt) {
-		_zone.update(dt);
+	/**
+	 * @param budget The time the zone update may take - zero means that all entities are updated
+	 */
+	inline void update(int64_t dt, std::chrono::microseconds budget) {
+		if (budget.count() <= 0) {
+			_zone.update(dt);
+			return;
+		}
+		_zone.update(dt, budget);
 	}
 
 	inline int getSize() const {
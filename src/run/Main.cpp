@@ -175,6 +175,11 @@ static void handleInput(const std::string& filename, const std::vector<ai::examp
 				zone.execute(func);
 				ai_log(" - sum: %i entities", count);
 			}
+		} else if (c == "l") {
+			for (ai::example::GameMap* map : maps) {
+				const ai::Zone& zone = map->getZone();
+				ai_log("%s: %i entities, update lag: %i ms", map->getName().c_str(), (int)zone.size(), (int)zone.getUpdateLag());
+			}
 		} else if (c == "t") {
 			autospawn = !autospawn;
 			ai_log("automatic respawn: %s", (autospawn ? "true" : "false"));
@@ -223,6 +228,7 @@ static void handleInput(const std::string& filename, const std::vector<ai::examp
 			ai_log("g      - group info");
 			ai_log("t      - trigger automatic respawn");
 			ai_log("d      - detail");
+			ai_log("l      - update lag of the maps");
 			ai_log("reload - reload the behaviour tree from file");
 		}
 	}
@@ -239,6 +245,8 @@ int main(int argc, char **argv) {
 		ai_log_error("-maps 4               - how many maps should get spawned");
 		ai_log_error("-autospawn true|false - automatic respawn (despawn random and respawn) of entities");
 		ai_log_error("-seed 1               - use a fixed seed for all the random actions");
+		ai_log_error("-budget 0             - max milliseconds per map update, 0 updates all entities");
+		ai_log_error("-doublebuffer false   - double buffer the position, orientation and speed of the entities");
 		ai_log_error("-help -h              - show this help screen");
 		ai_log_error("Network related options");
 		ai_log_error("-interface 0.0.0.0    - the interface the server will listen on");
@@ -253,6 +261,8 @@ int main(int argc, char **argv) {
 	int seed = std::stoi(getOptParam(b, e, "-seed", "-1"));
 	const int mapAmount = std::stoi(getOptParam(b, e, "-maps", "4"));
 	const int amount = std::stoi(getOptParam(b, e, "-amount", "10"));
+	const std::chrono::milliseconds budget(std::stoi(getOptParam(b, e, "-budget", "0")));
+	const bool doubleBuffer = getOptParam(b, e, "-doublebuffer", "false") == "true";
 	const short port = static_cast<short>(std::stoi(getOptParam(b, e, "-port", "10001")));
 	const std::string& filename = getOptParam(b, e, "-file");
 	const std::string& netInterface = getOptParam(b, e, "-interface", "0.0.0.0");
@@ -286,14 +296,16 @@ int main(int argc, char **argv) {
 
 	std::vector<ai::example::GameMap*> maps;
 	for (int i = 1; i <= mapAmount; ++i) {
-		maps.push_back(createMap(amount, server, "map-" + std::to_string(i)));
+		ai::example::GameMap* map = createMap(amount, server, "map-" + std::to_string(i));
+		map->getZone().setDoubleBuffering(doubleBuffer);
+		maps.push_back(map);
 	}
 
 	{
 		ai::ThreadScheduler threadScheduler;
 		int i = 0;
 		for (ai::example::GameMap* map : maps) {
-			threadScheduler.scheduleAtFixedRate(std::chrono::milliseconds(i++ * 50), std::chrono::milliseconds(250), [=] () {map->update(250u);});
+			threadScheduler.scheduleAtFixedRate(std::chrono::milliseconds(i++ * 50), std::chrono::milliseconds(250), [=] () {map->update(250u, budget);});
 		}
 		for (ai::example::GameMap* map : maps) {
 			threadScheduler.scheduleAtFixedRate(std::chrono::milliseconds(800), std::chrono::milliseconds(15000), runDespawnSpawn, map);
@@ -0,0 +1,55 @@
+#include "AllocatorBenchmark.h"
+#include <thread>
+
+namespace {
+template<class AllocatorClass>
+class Node: public ai::_MemObject<AllocatorClass> {
+public:
+	char data[120];
+};
+}
+
+class AllocatorBenchmark: public BenchmarkSuite {
+protected:
+	const int _iterations = 20;
+	const int _objects = 20000;
+
+	/**
+	 * @brief Every thread spawns and destroys the given amount of nodes - like loading trees for a
+	 * mass spawn on the workers of a zone
+	 */
+	template<class AllocatorClass>
+	double spawn(int threads) {
+		return measure(_iterations, [&] () {
+			std::vector<std::thread> workers;
+			for (int t = 0; t < threads; ++t) {
+				workers.emplace_back([this] () {
+					std::vector<std::shared_ptr<Node<AllocatorClass> > > nodes;
+					nodes.reserve(_objects);
+					for (int i = 0; i < _objects; ++i) {
+						nodes.push_back(std::allocate_shared<Node<AllocatorClass> >(ai::_StlAllocator<Node<AllocatorClass>, AllocatorClass>()));
+					}
+				});
+			}
+			for (std::thread& worker : workers) {
+				worker.join();
+			}
+		});
+	}
+
+	void compare(int threads) {
+		const double heap = spawn<ai::_DefaultAllocator>(threads);
+		const double pool = spawn<ai::PoolAllocator>(threads);
+		ai_log("%2i threads, %i nodes per thread: default %10.4f msec, pool %10.4f msec", threads, _objects, heap, pool);
+		const ai::PoolAllocator::Stats& stats = ai::PoolAllocator::getStats();
+		ai_log("pool: %i thread caches, %i kb reserved", stats.threadCaches, (int)(stats.reservedBytes / 1024u));
+	}
+};
+
+TEST_F(AllocatorBenchmark, spawn1Thread) {
+	compare(1);
+}
+
+TEST_F(AllocatorBenchmark, spawn8Threads) {
+	compare(8);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "TestShared.h"
+#include <chrono>
+
+/**
+ * @brief Base class for the benchmarks. They are not part of the unit tests, but are
+ * executed via the simpleai-benchmarks binary.
+ */
+class BenchmarkSuite: public TestSuite {
+protected:
+	/**
+	 * @return The average milliseconds per call of the given functor
+	 */
+	template<typename Func>
+	double measure(int iterations, Func&& func) const {
+		const auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < iterations; ++i) {
+			func();
+		}
+		const auto end = std::chrono::high_resolution_clock::now();
+		const double micros = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+		return micros / 1000.0 / (double)iterations;
+	}
+
+	void report(const char* name, int entities, double millis) const {
+		ai_log("%-32s %8i entities: %10.4f msec", name, entities, millis);
+	}
+};
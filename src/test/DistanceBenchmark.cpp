@@ -0,0 +1,61 @@
+#include "DistanceBenchmark.h"
+
+class DistanceBenchmark: public BenchmarkSuite {
+protected:
+	const int _iterations = 200;
+	const glm::vec3 _center = glm::vec3(500.0f, 0.0f, 500.0f);
+	const float _radius = 100.0f;
+
+	std::vector<glm::vec3> positions(int n) const {
+		ai::randomSeed(n);
+		std::vector<glm::vec3> positions;
+		positions.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			positions.emplace_back(ai::randomf(1000.0f), ai::randomf(10.0f), ai::randomf(1000.0f));
+		}
+		return positions;
+	}
+
+	void reportPerElement(const char* name, int n, double millis) const {
+		ai_log("%-32s %8i entities: %10.4f nsec per entity", name, n, millis * 1000000.0 / (double)n);
+	}
+
+	/**
+	 * @brief Compares the radius check one entity at a time with the batched kernels
+	 */
+	void radius(int n) {
+		const std::vector<glm::vec3> aos = positions(n);
+		ai::PositionArrays soa;
+		for (const glm::vec3& p : aos) {
+			soa.push_back(p);
+		}
+		std::vector<uint32_t> indices(n);
+		std::size_t expected = 0u;
+		reportPerElement("glm::distance", n, measure(_iterations, [&] () {
+			expected = 0u;
+			for (int i = 0; i < n; ++i) {
+				if (glm::distance(aos[i], _center) <= _radius) {
+					indices[expected++] = i;
+				}
+			}
+		}));
+		std::size_t found = 0u;
+		reportPerElement("Distance::selectInRadiusScalar", n, measure(_iterations, [&] () {
+			found = ai::Distance::selectInRadiusScalar(_center, _radius * _radius, soa.x(), soa.y(), soa.z(), n, indices.data());
+		}));
+		ASSERT_EQ(expected, found);
+		reportPerElement("Distance::selectInRadius", n, measure(_iterations, [&] () {
+			found = ai::Distance::selectInRadius(_center, _radius * _radius, soa.x(), soa.y(), soa.z(), n, indices.data());
+		}));
+		ASSERT_EQ(expected, found);
+	}
+};
+
+TEST_F(DistanceBenchmark, radius1000) {
+	ai_log("kernel lanes: %i", (int)ai::Distance::Lanes);
+	radius(1000);
+}
+
+TEST_F(DistanceBenchmark, radius100000) {
+	radius(100000);
+}
@@ -1,4 +1,6 @@
 #include "GeneralTest.h"
+#include <thread>
+#include <cstring>
 
 class GeneralTest: public TestSuite {
 };
@@ -26,3 +28,115 @@ TEST_F(GeneralTest, testMath) {
 	ASSERT_FLOAT_EQ(0.0f, angle.y);
 	ASSERT_FLOAT_EQ(glm::pi<float>(), glm::abs(ai::angle(angle)));
 }
+
+TEST_F(GeneralTest, testDistanceKernels) {
+	ai::randomSeed(1);
+	const glm::vec3 center(1.0f, 2.0f, 3.0f);
+	const float radiusSquared = 25.0f;
+	// sizes that are no multiple of the lanes - the tail is done by the scalar code
+	for (std::size_t n : {0u, 1u, 7u, 64u, 301u}) {
+		ai::PositionArrays positions;
+		for (std::size_t i = 0u; i < n; ++i) {
+			positions.push_back(glm::vec3(ai::randomf(20.0f) - 9.0f, ai::randomf(4.0f), ai::randomf(20.0f) - 7.0f));
+		}
+		std::vector<float> simd(n + 1u);
+		std::vector<float> scalar(n + 1u);
+		ai::Distance::squared(center, positions.x(), positions.y(), positions.z(), n, simd.data());
+		ai::Distance::squaredScalar(center, positions.x(), positions.y(), positions.z(), n, scalar.data());
+		for (std::size_t i = 0u; i < n; ++i) {
+			ASSERT_FLOAT_EQ(glm::distance2(positions.get(i), center), simd[i]);
+			ASSERT_FLOAT_EQ(scalar[i], simd[i]);
+		}
+
+		std::vector<uint32_t> simdIndices(n + 1u);
+		std::vector<uint32_t> scalarIndices(n + 1u);
+		const std::size_t found = ai::Distance::selectInRadius(center, radiusSquared, positions.x(), positions.y(), positions.z(), n, simdIndices.data());
+		ASSERT_EQ(ai::Distance::selectInRadiusScalar(center, radiusSquared, positions.x(), positions.y(), positions.z(), n, scalarIndices.data()), found);
+		simdIndices.resize(found);
+		scalarIndices.resize(found);
+		ASSERT_EQ(scalarIndices, simdIndices);
+
+		std::vector<uint32_t> visited;
+		ai::Distance::visitInRadius(center, radiusSquared, positions, [&] (std::size_t index) {
+			visited.push_back(static_cast<uint32_t>(index));
+		});
+		ASSERT_EQ(scalarIndices, visited);
+	}
+}
+
+namespace {
+class PooledObject: public ai::_MemObject<ai::PoolAllocator> {
+public:
+	char data[100];
+};
+}
+
+TEST_F(GeneralTest, testPoolAllocator) {
+	// size classes
+	for (std::size_t size = 0u; size <= 1024u; ++size) {
+		const uint32_t c = ai::PoolAllocator::sizeClass(size);
+		ASSERT_GE(ai::PoolAllocator::classSize(c), size);
+		if (c > 0u) {
+			ASSERT_LT(ai::PoolAllocator::classSize(c - 1u), size) << "size " << size << " should use the smaller class";
+		}
+	}
+	ASSERT_EQ(19u, ai::PoolAllocator::sizeClass(1024u));
+
+	const ai::PoolAllocator::Stats before = ai::PoolAllocator::getStats();
+	std::vector<void*> blocks;
+	for (std::size_t size = 1u; size <= 1024u; size += 7u) {
+		void* ptr = ai::PoolAllocator::allocate(size);
+		ASSERT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) % 16u) << "block of size " << size << " is not aligned";
+		std::memset(ptr, 0xff, size);
+		blocks.push_back(ptr);
+	}
+	for (void* ptr : blocks) {
+		ai::PoolAllocator::deallocate(ptr);
+	}
+	// the freed block is reused
+	void* first = ai::PoolAllocator::allocate(40u);
+	ai::PoolAllocator::deallocate(first);
+	ASSERT_EQ(first, ai::PoolAllocator::allocate(48u));
+	ai::PoolAllocator::deallocate(first);
+	void* large = ai::PoolAllocator::allocate(4096u);
+	std::memset(large, 0xff, 4096u);
+	ai::PoolAllocator::deallocate(large);
+
+	ai::PoolAllocator::Stats stats = ai::PoolAllocator::getStats();
+	ASSERT_EQ(blocks.size() + 2u, stats.allocations - before.allocations);
+	ASSERT_EQ(blocks.size() + 2u, stats.deallocations - before.deallocations);
+	ASSERT_EQ(1u, stats.largeAllocations - before.largeAllocations);
+	ASSERT_EQ(1u, stats.largeDeallocations - before.largeDeallocations);
+
+	// freed by another thread - handed back to the allocating one
+	std::vector<PooledObject*> objects;
+	for (int i = 0; i < 1000; ++i) {
+		objects.push_back(new PooledObject());
+	}
+	std::thread other([&objects] () {
+		for (PooledObject* object : objects) {
+			delete object;
+		}
+	});
+	other.join();
+	stats = ai::PoolAllocator::getStats();
+	ASSERT_EQ(1000u, stats.remoteDeallocations - before.remoteDeallocations);
+	ASSERT_EQ(stats.allocations - before.allocations, stats.deallocations - before.deallocations);
+	const std::size_t reserved = stats.reservedBytes;
+	for (int i = 0; i < 1000; ++i) {
+		objects[i] = new PooledObject();
+	}
+	for (PooledObject* object : objects) {
+		delete object;
+	}
+	ASSERT_EQ(reserved, ai::PoolAllocator::getStats().reservedBytes) << "The handed back blocks should be reused";
+
+	// shared pointers put the object and the counter into the pool
+	const uint64_t allocations = ai::PoolAllocator::getStats().allocations;
+	{
+		const std::shared_ptr<PooledObject> shared = std::allocate_shared<PooledObject>(ai::_StlAllocator<PooledObject, ai::PoolAllocator>());
+		ASSERT_EQ(allocations + 1u, ai::PoolAllocator::getStats().allocations);
+	}
+	stats = ai::PoolAllocator::getStats();
+	ASSERT_EQ(stats.allocations - before.allocations, stats.deallocations - before.deallocations);
+}
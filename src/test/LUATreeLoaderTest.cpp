@@ -36,7 +36,7 @@ TEST_F(LUATreeLoaderTest, testLoadExample) {
 	const ai::TreeNodePtr& tree = _loader.load("example");
 	ASSERT_NE(nullptr, tree.get()) << "Could not find the expected behaviour";
 	ASSERT_EQ("root1", tree->getName()) << "unexpected root node name";
-	const ai::TreeNodes& children = tree->getChildren();
+	const ai::TreeNodes& children = static_cast<const ai::TreeNode&>(*tree).getChildren();
 	const int childrenAmount = children.size();
 	ASSERT_EQ(1, childrenAmount) << "expected amount of children";
 	ASSERT_EQ("idle3000_1", children[0]->getName()) << "unexpected child node name";
@@ -47,7 +47,7 @@ TEST_F(LUATreeLoaderTest, testLoadExample2) {
 	const ai::TreeNodePtr& tree = _loader.load("example2");
 	ASSERT_NE(nullptr, tree.get()) << "Could not find the expected behaviour";
 	ASSERT_EQ("root2", tree->getName()) << "unexpected root node name";
-	const ai::TreeNodes& children = tree->getChildren();
+	const ai::TreeNodes& children = static_cast<const ai::TreeNode&>(*tree).getChildren();
 	const int childrenAmount = children.size();
 	ASSERT_EQ(2, childrenAmount) << "expected amount of children";
 	ASSERT_EQ("idle3000_2", children[0]->getName()) << "unexpected child node name";
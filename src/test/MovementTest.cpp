@@ -101,3 +101,59 @@ TEST_F(MovementTest, testWeightedSteering) {
 	const glm::vec3 result = glm::vec3(-_speed, 0.0f, 0.0f) * 0.8f + glm::vec3(_speed, 0.0f, 0.0f) * 0.2f;
 	EXPECT_EQ(result, mv.getVector());
 }
+
+TEST_F(MovementTest, testNeighbourSteerings) {
+	ai::Zone zone("movementTest");
+	zone.setSpatialGrid(4.0f);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const glm::vec3 positions[] = {glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+			glm::vec3(100.0f, 0.0f, 0.0f), glm::vec3(100.0f, 0.0f, 0.0f)};
+	const float orientations[] = {0.0f, 0.0f, glm::half_pi<float>(), 0.0f, 0.0f};
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 5; ++i) {
+		const ai::ICharacterPtr& entity = std::make_shared<ai::ICharacter>(i + 1);
+		entity->setPosition(positions[i]);
+		entity->setOrientation(orientations[i]);
+		const ai::AIPtr& ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(entity);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v));
+	zone.update(1l);
+
+	const ai::AIPtr& ai = v[0];
+	const glm::vec3 diagonal = glm::normalize(glm::vec3(1.0f, 0.0f, 1.0f)) * _speed;
+	const ai::MoveVector& separation = ai::movement::Separation("2").execute(ai, _speed);
+	EXPECT_NEAR(-diagonal.x, separation.getVector().x, 0.001f);
+	EXPECT_NEAR(-diagonal.z, separation.getVector().z, 0.001f);
+	const ai::MoveVector& cohesion = ai::movement::Cohesion("2").execute(ai, _speed);
+	EXPECT_NEAR(diagonal.x, cohesion.getVector().x, 0.001f);
+	EXPECT_NEAR(diagonal.z, cohesion.getVector().z, 0.001f);
+	const ai::MoveVector& alignment = ai::movement::Alignment("2").execute(ai, _speed);
+	EXPECT_NEAR(diagonal.x, alignment.getVector().x, 0.001f);
+	EXPECT_NEAR(diagonal.z, alignment.getVector().z, 0.001f);
+	ASSERT_EQ(1, ai->getNeighbours().getGathers()) << "The steerings should share the neighbours";
+	ASSERT_EQ(2u, ai->getNeighbours().get().size());
+
+	// a smaller radius is answered from the same list
+	ASSERT_TRUE(ai::isInfinite(ai::movement::Cohesion("0.5").execute(ai, _speed).getVector()));
+	ASSERT_EQ(1, ai->getNeighbours().getGathers());
+	ai::movement::Separation("3").execute(ai, _speed);
+	ASSERT_EQ(2, ai->getNeighbours().getGathers()) << "A larger radius should gather the neighbours again";
+	zone.update(1l);
+	ai::movement::Separation("2").execute(ai, _speed);
+	ASSERT_EQ(3, ai->getNeighbours().getGathers()) << "Every update should gather the neighbours again";
+
+	// entities on the same spot are pushed into opposite directions
+	const ai::MoveVector& first = ai::movement::Separation("1").execute(v[3], _speed);
+	const ai::MoveVector& second = ai::movement::Separation("1").execute(v[4], _speed);
+	ASSERT_FALSE(ai::isInfinite(first.getVector()));
+	EXPECT_NEAR(-_speed * _speed, glm::dot(first.getVector(), second.getVector()), 0.01f);
+
+	// nobody around
+	zone.removeAI(v[4]);
+	zone.update(1l);
+	ASSERT_TRUE(ai::isInfinite(ai::movement::Separation("1").execute(v[3], _speed).getVector()));
+	ASSERT_TRUE(ai::isInfinite(ai::movement::Alignment("1").execute(v[3], _speed).getVector()));
+	ASSERT_TRUE(ai::isInfinite(ai::movement::Cohesion("1").execute(v[3], _speed).getVector()));
+}
@@ -3,6 +3,21 @@
 class NodeTest: public TestSuite {
 };
 
+namespace {
+class CountingCondition: public ai::ICondition {
+public:
+	CONDITION_CLASS(CountingCondition)
+
+	bool value = true;
+	int evaluations = 0;
+
+	bool evaluate(const ai::AIPtr& /*entity*/) override {
+		++evaluations;
+		return value;
+	}
+};
+}
+
 TEST_F(NodeTest, testSequence) {
 	ai::Sequence::Factory f;
 	ai::TreeNodeFactoryContext ctx("testsequence", "", ai::True::get());
@@ -57,6 +72,24 @@ TEST_F(NodeTest, testIdle) {
 	ASSERT_EQ(ai::FINISHED, node->execute(entity, 1000));
 }
 
+TEST_F(NodeTest, testIdleShared) {
+	ai::Idle::Factory f;
+	ai::TreeNodeFactoryContext ctx("testidle", "2", ai::True::get());
+	ai::TreeNodePtr node = f.create(&ctx);
+	ai::AIPtr e1(new ai::AI(node));
+	e1->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	ai::AIPtr e2(new ai::AI(node));
+	e2->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	// every entity has its own timer
+	ASSERT_EQ(ai::RUNNING, node->execute(e1, 1));
+	ASSERT_EQ(ai::RUNNING, node->execute(e1, 1));
+	ASSERT_EQ(ai::RUNNING, node->execute(e2, 1));
+	ASSERT_EQ(ai::FINISHED, node->execute(e1, 1));
+	ASSERT_EQ(ai::RUNNING, node->execute(e2, 1));
+	ASSERT_EQ(ai::RUNNING, node->execute(e1, 1));
+	ASSERT_EQ(ai::FINISHED, node->execute(e2, 1));
+}
+
 TEST_F(NodeTest, testParallel) {
 	ai::Parallel::Factory f;
 	ai::TreeNodeFactoryContext ctx("testparallel", "", ai::True::get());
@@ -149,3 +182,404 @@ TEST_F(NodeTest, testPrioritySelectorWithCondition) {
 	ASSERT_EQ(ai::CANNOTEXECUTE, idle1->getLastStatus(e));
 	ASSERT_EQ(ai::FINISHED, idle2->getLastStatus(e));
 }
+
+TEST_F(NodeTest, testNodeIndices) {
+	ai::Sequence::Factory f;
+	ai::TreeNodeFactoryContext ctx("testsequence", "", ai::True::get());
+	ai::TreeNodePtr node = f.create(&ctx);
+
+	ai::Idle::Factory idleFac;
+	ai::TreeNodeFactoryContext idleCtx1("testidle", "2", ai::True::get());
+	ai::TreeNodePtr idle1 = idleFac.create(&idleCtx1);
+	ai::TreeNodeFactoryContext idleCtx2("testidle2", "2", ai::True::get());
+	ai::TreeNodePtr idle2 = idleFac.create(&idleCtx2);
+	node->addChild(idle1);
+
+	ASSERT_EQ(2, ai::TreeNode::index(*node));
+	ASSERT_EQ(0, node->getIndex());
+	ASSERT_EQ(1, idle1->getIndex());
+	ASSERT_EQ(-1, idle2->getIndex());
+
+	ai::AIPtr e(new ai::AI(node));
+	ai::ICharacterPtr chr(new ai::ICharacter(1));
+	e->setCharacter(chr);
+	e->update(1, true);
+	e->getBehaviour()->execute(e, 1);
+	ASSERT_EQ(ai::RUNNING, idle1->getLastStatus(e));
+
+	// a node that is added later keeps the states of the others
+	node->addChild(idle2);
+	ASSERT_EQ(3, ai::TreeNode::index(*node));
+	ASSERT_EQ(1, idle1->getIndex());
+	ASSERT_EQ(2, idle2->getIndex());
+	ASSERT_EQ(ai::RUNNING, idle1->getLastStatus(e));
+	ASSERT_EQ(ai::UNKNOWN, idle2->getLastStatus(e));
+	e->update(1, true);
+	e->getBehaviour()->execute(e, 1);
+	e->update(1, true);
+	e->getBehaviour()->execute(e, 1);
+	ASSERT_EQ(ai::FINISHED, idle1->getLastStatus(e));
+	ASSERT_EQ(ai::RUNNING, idle2->getLastStatus(e));
+}
+
+TEST_F(NodeTest, testNodeIndicesSharedSubtree) {
+	const ai::TreeNodePtr shared = std::make_shared<ai::Sequence>("shared", "", ai::True::get());
+	const ai::TreeNodePtr idle = std::make_shared<ai::Idle>("idle", "2", ai::True::get());
+	shared->addChild(idle);
+	const ai::TreeNodePtr rootA = std::make_shared<ai::Sequence>("a", "", ai::True::get());
+	rootA->addChild(shared);
+	const ai::TreeNodePtr rootB = std::make_shared<ai::Sequence>("b", "", ai::True::get());
+	rootB->addChild(std::make_shared<ai::Idle>("before", "1", ai::True::get()));
+	rootB->addChild(shared);
+
+	ASSERT_EQ(3, ai::TreeNode::index(*rootA));
+	ASSERT_EQ(1, shared->getIndex());
+	ASSERT_EQ(2, idle->getIndex());
+	// the shared nodes keep the indices of the first tree
+	ASSERT_EQ(2, ai::TreeNode::index(*rootB));
+	ASSERT_EQ(1, shared->getIndex());
+	ASSERT_EQ(2, idle->getIndex());
+
+	// but every entity has its own states of them
+	ai::AIPtr a(new ai::AI(rootA));
+	a->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	ai::AIPtr b(new ai::AI(rootB));
+	b->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	for (int i = 0; i < 2; ++i) {
+		a->update(1, true);
+		rootA->execute(a, 1);
+		b->update(1, true);
+		rootB->execute(b, 1);
+	}
+	ASSERT_EQ(ai::RUNNING, idle->getLastStatus(a));
+	ASSERT_EQ(ai::RUNNING, idle->getLastStatus(b));
+	a->update(1, true);
+	rootA->execute(a, 1);
+	b->update(1, true);
+	rootB->execute(b, 1);
+	ASSERT_EQ(ai::FINISHED, idle->getLastStatus(a));
+	ASSERT_EQ(ai::RUNNING, idle->getLastStatus(b));
+
+	// a node that is added later is indexed right away - and only outdates the programs of its tree
+	const ai::TreeProgramPtr programA = ai::TreeProgram::compile(rootA);
+	ai::TreeProgramPtr programB = ai::TreeProgram::compile(rootB);
+	const ai::TreeNodePtr after = std::make_shared<ai::Idle>("after", "1", ai::True::get());
+	rootB->addChild(after);
+	ASSERT_EQ(2, after->getIndex());
+	ASSERT_EQ(3, ai::TreeNode::index(*rootB));
+	ASSERT_TRUE(programA->isValid());
+	ASSERT_FALSE(programB->isValid());
+
+	// changing the shared subtree outdates the programs of both trees
+	programB = ai::TreeProgram::compile(rootB);
+	ASSERT_TRUE(programB->isValid());
+	shared->setGuard(true);
+	ASSERT_FALSE(programA->isValid());
+	ASSERT_FALSE(programB->isValid());
+
+	// the deprecated mutable access to the children outdates the programs, the new nodes are indexed with the root
+	programB = ai::TreeProgram::compile(rootB);
+	const ai::TreeNodePtr late = std::make_shared<ai::Idle>("late", "1", ai::True::get());
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+	rootB->getChildren().push_back(late);
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+	ASSERT_FALSE(programB->isValid());
+	ASSERT_EQ(-1, late->getIndex());
+	ASSERT_EQ(4, ai::TreeNode::index(*rootB));
+	ASSERT_EQ(3, late->getIndex());
+	ASSERT_EQ(1, shared->getIndex()) << "The indexed nodes must keep their index";
+	ASSERT_TRUE(ai::TreeProgram::compile(rootB)->isValid());
+}
+
+TEST_F(NodeTest, testTreeProgram) {
+	const ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("root", "", ai::True::get());
+	const ai::TreeNodePtr disabled = std::make_shared<ai::Sequence>("disabled", "", ai::False::get());
+	disabled->addChild(std::make_shared<ai::Idle>("idle", "1", ai::True::get()));
+	root->addChild(disabled);
+
+	const ai::TreeNodePtr limit = std::make_shared<ai::Limit>("limit", "3", ai::True::get());
+	const ai::TreeNodePtr sequence = std::make_shared<ai::Sequence>("sequence", "", ai::True::get());
+	const ai::TreeNodePtr fail = std::make_shared<ai::Fail>("fail", "", ai::True::get());
+	fail->addChild(std::make_shared<ai::Idle>("idle", "1", ai::True::get()));
+	sequence->addChild(std::make_shared<ai::Idle>("idle", "2", ai::True::get()));
+	sequence->addChild(fail);
+	limit->addChild(sequence);
+	root->addChild(limit);
+
+	const ai::TreeNodePtr parallel = std::make_shared<ai::Parallel>("parallel", "", ai::True::get());
+	const ai::TreeNodePtr invert = std::make_shared<ai::Invert>("invert", "", ai::True::get());
+	const ai::TreeNodePtr fail2 = std::make_shared<ai::Fail>("fail", "", ai::True::get());
+	fail2->addChild(std::make_shared<ai::Idle>("idle", "1", ai::True::get()));
+	invert->addChild(fail2);
+	const ai::TreeNodePtr succeed = std::make_shared<ai::Succeed>("succeed", "", ai::True::get());
+	succeed->addChild(std::make_shared<ai::Idle>("idle", "2", ai::True::get()));
+	parallel->addChild(std::make_shared<ai::Idle>("idle", "3", ai::True::get()));
+	parallel->addChild(invert);
+	parallel->addChild(succeed);
+	root->addChild(parallel);
+
+	const ai::TreeProgramPtr program = ai::TreeProgram::compile(root);
+	ASSERT_TRUE(program->isValid());
+	ASSERT_EQ(12, program->getInstructions());
+	ASSERT_EQ(6, program->getInlined());
+
+	std::vector<ai::TreeNodePtr> nodes;
+	std::vector<ai::TreeNodePtr> todo(1, root);
+	while (!todo.empty()) {
+		const ai::TreeNodePtr node = todo.back();
+		todo.pop_back();
+		nodes.push_back(node);
+		const ai::TreeNodes& children = static_cast<const ai::TreeNode&>(*node).getChildren();
+		todo.insert(todo.end(), children.begin(), children.end());
+	}
+
+	ai::AIPtr recursive(new ai::AI(root));
+	recursive->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	ai::AIPtr compiled(new ai::AI(root));
+	compiled->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	compiled->setProgram(program);
+	for (int i = 0; i < 20; ++i) {
+		recursive->update(1, true);
+		compiled->update(1, true);
+		ASSERT_EQ(root->execute(recursive, 1), program->execute(compiled, 1)) << "tick " << i;
+		for (const ai::TreeNodePtr& node : nodes) {
+			ASSERT_EQ(node->getLastStatus(recursive), node->getLastStatus(compiled)) << "tick " << i << " node " << node->getName();
+			ASSERT_EQ(node->getLastExecMillis(recursive), node->getLastExecMillis(compiled)) << "tick " << i << " node " << node->getName();
+		}
+	}
+	ASSERT_NE(ai::UNKNOWN, limit->getLastStatus(compiled));
+
+	// outdated programs fall back to the tree
+	root->addChild(std::make_shared<ai::Idle>("idle", "1", ai::True::get()));
+	ASSERT_FALSE(program->isValid());
+	ASSERT_EQ(root->execute(recursive, 1), program->execute(compiled, 1));
+}
+
+TEST_F(NodeTest, testTreeProgramResume) {
+	const std::shared_ptr<CountingCondition> guard = std::make_shared<CountingCondition>();
+	const std::shared_ptr<CountingCondition> condition = std::make_shared<CountingCondition>();
+	const ai::TreeNodePtr root = std::make_shared<ai::Sequence>("root", "", guard);
+	root->setGuard(true);
+	const ai::TreeNodePtr sequence = std::make_shared<ai::Sequence>("sequence", "", condition);
+	const ai::TreeNodePtr idle1 = std::make_shared<ai::Idle>("idle1", "3", ai::True::get());
+	const ai::TreeNodePtr idle2 = std::make_shared<ai::Idle>("idle2", "3", ai::True::get());
+	sequence->addChild(idle1);
+	sequence->addChild(idle2);
+	root->addChild(sequence);
+
+	const ai::TreeProgramPtr program = ai::TreeProgram::compile(root, true);
+	ASSERT_TRUE(program->isResuming());
+	ai::AIPtr e(new ai::AI(root));
+	e->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	e->setProgram(program);
+	auto tick = [&] () {
+		e->update(1, true);
+		return program->execute(e, 1);
+	};
+
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(1, guard->evaluations);
+	ASSERT_EQ(1, condition->evaluations);
+	ASSERT_EQ(ai::RUNNING, idle1->getLastStatus(e));
+
+	// only the guard is checked on the way down to the running node
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(3, guard->evaluations);
+	ASSERT_EQ(1, condition->evaluations);
+
+	// the sequence continues with the next child once the running node is done
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(ai::FINISHED, idle1->getLastStatus(e));
+	ASSERT_EQ(ai::RUNNING, idle2->getLastStatus(e));
+	ASSERT_EQ(1, condition->evaluations);
+
+	// waking the entity up starts at the root again
+	e->wake();
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(2, condition->evaluations);
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(2, condition->evaluations);
+
+	// a failing guard interrupts the running node
+	guard->value = false;
+	ASSERT_EQ(ai::CANNOTEXECUTE, tick());
+	ASSERT_EQ(ai::CANNOTEXECUTE, root->getLastStatus(e));
+
+	// the same without debugging - nothing is recorded on the way up then
+	guard->value = true;
+	ai::AIPtr e2(new ai::AI(root));
+	e2->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	e2->setProgram(program);
+	const int evaluations = condition->evaluations;
+	for (int i = 0; i < 3; ++i) {
+		e2->update(1, false);
+		ASSERT_EQ(ai::RUNNING, program->execute(e2, 1));
+	}
+	ASSERT_EQ(evaluations + 1, condition->evaluations);
+	e2->update(1, false);
+	ASSERT_EQ(ai::RUNNING, program->execute(e2, 1));
+	ASSERT_EQ(evaluations + 1, condition->evaluations);
+	e2->update(1, false);
+	e2->update(1, false);
+	ASSERT_EQ(ai::FINISHED, program->execute(e2, 3));
+	ASSERT_EQ(evaluations + 1, condition->evaluations);
+}
+
+TEST_F(NodeTest, testTreeProgramResumeAgainstTree) {
+	const std::shared_ptr<CountingCondition> walkCondition = std::make_shared<CountingCondition>();
+	const ai::TreeNodePtr root = std::make_shared<ai::Sequence>("root", "", ai::True::get());
+	const ai::TreeNodePtr walk = std::make_shared<ai::Sequence>("walk", "", walkCondition);
+	walk->addChild(std::make_shared<ai::Idle>("walking", "3", ai::True::get()));
+	const ai::TreeNodePtr select = std::make_shared<ai::PrioritySelector>("select", "", ai::True::get());
+	const ai::TreeNodePtr combo = std::make_shared<ai::Sequence>("combo", "", ai::True::get());
+	const ai::TreeNodePtr first = std::make_shared<ai::Idle>("first", "2", ai::True::get());
+	const ai::TreeNodePtr second = std::make_shared<ai::Idle>("second", "2", ai::True::get());
+	combo->addChild(first);
+	combo->addChild(second);
+	select->addChild(combo);
+	root->addChild(walk);
+	root->addChild(select);
+
+	std::vector<ai::TreeNodePtr> nodes;
+	std::vector<ai::TreeNodePtr> todo(1, root);
+	while (!todo.empty()) {
+		const ai::TreeNodePtr node = todo.back();
+		todo.pop_back();
+		nodes.push_back(node);
+		const ai::TreeNodes& children = static_cast<const ai::TreeNode&>(*node).getChildren();
+		todo.insert(todo.end(), children.begin(), children.end());
+	}
+
+	ai::AIPtr recursive(new ai::AI(root));
+	recursive->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	ai::AIPtr resumed(new ai::AI(root));
+	resumed->setCharacter(ai::ICharacterPtr(new ai::ICharacter(2)));
+	const ai::TreeProgramPtr program = ai::TreeProgram::compile(root, true);
+	resumed->setProgram(program);
+	ai::TreeNodeStatus results[2];
+	auto tick = [&] () {
+		recursive->update(1, true);
+		resumed->update(1, true);
+		results[0] = root->execute(recursive, 1);
+		results[1] = program->execute(resumed, 1);
+	};
+	auto agree = [&] (int i) {
+		tick();
+		ASSERT_EQ(results[0], results[1]) << "tick " << i;
+		for (const ai::TreeNodePtr& node : nodes) {
+			ASSERT_EQ(node->getLastStatus(recursive), node->getLastStatus(resumed)) << "tick " << i << " node " << node->getName();
+		}
+	};
+
+	// the intended difference: the condition of the resumed walk is not checked again - it's no guard
+	int i = 0;
+	agree(i++);
+	ASSERT_EQ(ai::RUNNING, walk->getLastStatus(resumed));
+	walkCondition->value = false;
+	tick();
+	ASSERT_EQ(ai::CANNOTEXECUTE, results[0]);
+	ASSERT_EQ(ai::RUNNING, results[1]);
+
+	// until the way is dropped
+	resumed->wake();
+	agree(i++);
+	ASSERT_EQ(ai::CANNOTEXECUTE, results[1]);
+
+	// both start over with the same states
+	recursive->setBehaviour(root);
+	resumed->setBehaviour(root);
+	resumed->setProgram(program);
+	walkCondition->value = true;
+
+	// the other intended difference: the recursive priority selector resets its running child in every
+	// execution - the sequence below it starts over at its first child, the resumed one continues
+	agree(i++);
+	bool recursiveFinished = false;
+	bool resumedFinished = false;
+	for (int j = 0; j < 8; ++j) {
+		tick();
+		recursiveFinished |= second->getLastStatus(recursive) == ai::FINISHED;
+		resumedFinished |= second->getLastStatus(resumed) == ai::FINISHED;
+	}
+	ASSERT_FALSE(recursiveFinished) << "The recursive sequence below the priority selector should start over";
+	ASSERT_TRUE(resumedFinished) << "The resumed sequence below the priority selector should continue";
+}
+
+TEST_F(NodeTest, testTreeProgramResumePriority) {
+	const std::shared_ptr<CountingCondition> fleeCondition = std::make_shared<CountingCondition>();
+	fleeCondition->value = false;
+	const std::shared_ptr<CountingCondition> patrolCondition = std::make_shared<CountingCondition>();
+	const ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("root", "", ai::True::get());
+	const ai::TreeNodePtr flee = std::make_shared<ai::Idle>("flee", "2", fleeCondition);
+	const ai::TreeNodePtr patrol = std::make_shared<ai::Sequence>("patrol", "", patrolCondition);
+	const ai::TreeNodePtr walk1 = std::make_shared<ai::Idle>("walk1", "3", ai::True::get());
+	const ai::TreeNodePtr walk2 = std::make_shared<ai::Idle>("walk2", "3", ai::True::get());
+	patrol->addChild(walk1);
+	patrol->addChild(walk2);
+	root->addChild(flee);
+	root->addChild(patrol);
+
+	const ai::TreeProgramPtr program = ai::TreeProgram::compile(root, true);
+	ai::AIPtr e(new ai::AI(root));
+	e->setCharacter(ai::ICharacterPtr(new ai::ICharacter(1)));
+	e->setProgram(program);
+	auto tick = [&] () {
+		e->update(1, true);
+		return program->execute(e, 1);
+	};
+	auto selected = [&] () {
+		std::vector<bool> active;
+		root->getRunningChildren(e, active);
+		return std::find(active.begin(), active.end(), true) - active.begin();
+	};
+
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(ai::CANNOTEXECUTE, flee->getLastStatus(e));
+	ASSERT_EQ(ai::RUNNING, walk1->getLastStatus(e));
+	ASSERT_EQ(1, selected());
+	ASSERT_EQ(1, patrolCondition->evaluations);
+
+	// resumed below the priority selector - the condition of the higher priority branch is checked as
+	// implicit guard, the one of the patrol is not
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(3, fleeCondition->evaluations);
+	ASSERT_EQ(1, patrolCondition->evaluations);
+
+	// and the sequence continues instead of starting over
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(ai::FINISHED, walk1->getLastStatus(e));
+	ASSERT_EQ(ai::RUNNING, walk2->getLastStatus(e));
+	ASSERT_EQ(1, patrolCondition->evaluations);
+
+	// the higher priority branch interrupts the running patrol
+	fleeCondition->value = true;
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(ai::RUNNING, flee->getLastStatus(e));
+	ASSERT_EQ(0, selected());
+	ASSERT_EQ(1, patrolCondition->evaluations) << "The patrol shouldn't be executed anymore";
+
+	// once it can't run anymore, the patrol starts over
+	fleeCondition->value = false;
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(ai::CANNOTEXECUTE, flee->getLastStatus(e));
+	ASSERT_EQ(1, selected());
+	ASSERT_EQ(ai::RUNNING, walk1->getLastStatus(e));
+	ASSERT_EQ(2, patrolCondition->evaluations);
+
+	// waking the entity up also lets the priority selector start at its first child
+	ASSERT_EQ(ai::RUNNING, tick());
+	const int fleeEvaluations = fleeCondition->evaluations;
+	e->wake();
+	ASSERT_EQ(ai::RUNNING, tick());
+	ASSERT_EQ(fleeEvaluations + 1, fleeCondition->evaluations);
+	ASSERT_EQ(ai::CANNOTEXECUTE, flee->getLastStatus(e));
+	ASSERT_EQ(3, patrolCondition->evaluations);
+	ASSERT_EQ(1, selected());
+}
@@ -154,6 +154,18 @@ TEST_F(ParserTest, testInnerFiltersCombination) {
 	ASSERT_NE(nullptr, c.get()) << parser.getError();
 }
 
+TEST_F(ParserTest, testFilterSelectNearest) {
+	ai::ConditionParser parser(_registry, "Filter(First(SelectNearest{3,50}))");
+	const ai::ConditionPtr& c = parser.getCondition();
+	ASSERT_NE(nullptr, c.get()) << parser.getError();
+}
+
+TEST_F(ParserTest, testStimulus) {
+	ai::ConditionParser parser(_registry, "And(HasStimulus{1},Filter(SelectStimulus{1}))");
+	const ai::ConditionPtr& c = parser.getCondition();
+	ASSERT_NE(nullptr, c.get()) << parser.getError();
+}
+
 TEST_F(ParserTest, testMultipleFilterInAnd) {
 	ai::ConditionParser parser(_registry, "And(Filter(SelectEmpty,SelectHighestAggro),True,And(Filter(SelectEmpty,SelectHighestAggro),True))");
 	const ai::ConditionPtr& c = parser.getCondition();
@@ -0,0 +1,179 @@
+#include "SpatialBenchmark.h"
+#include <random>
+
+namespace {
+
+/**
+ * @brief A recorded entity distribution and the queries that were issued against it
+ */
+struct Recording {
+	struct Query {
+		glm::vec3 center;
+		float radius;
+		// box queries use the radius as half extent
+		bool box;
+	};
+	const char* name;
+	std::vector<glm::vec3> positions;
+	std::vector<Query> queries;
+};
+
+const float WorldSize = 20000.0f;
+
+/**
+ * @brief Replays a sparse open world: entities spread evenly over the whole map
+ */
+Recording uniform(int n, int queries, unsigned int seed) {
+	std::mt19937 rnd(seed);
+	std::uniform_real_distribution<float> coord(0.0f, WorldSize);
+	std::uniform_real_distribution<float> height(0.0f, 50.0f);
+	Recording r;
+	r.name = "uniform";
+	for (int i = 0; i < n; ++i) {
+		r.positions.emplace_back(coord(rnd), height(rnd), coord(rnd));
+	}
+	std::uniform_real_distribution<float> radius(10.0f, 200.0f);
+	for (int i = 0; i < queries; ++i) {
+		r.queries.push_back(Recording::Query{glm::vec3(coord(rnd), 0.0f, coord(rnd)), radius(rnd), i % 4 == 0});
+	}
+	return r;
+}
+
+/**
+ * @brief Replays a map with a few dense camps and nothing in between. Most of the queries
+ * are issued by the entities in the camps.
+ */
+Recording camps(int n, int queries, unsigned int seed) {
+	std::mt19937 rnd(seed);
+	std::uniform_real_distribution<float> coord(0.0f, WorldSize);
+	std::normal_distribution<float> offset(0.0f, 40.0f);
+	std::vector<glm::vec3> centers;
+	for (int i = 0; i < 64; ++i) {
+		centers.emplace_back(coord(rnd), 0.0f, coord(rnd));
+	}
+	std::uniform_int_distribution<std::size_t> camp(0u, centers.size() - 1u);
+	Recording r;
+	r.name = "camps";
+	for (int i = 0; i < n; ++i) {
+		const glm::vec3& c = centers[camp(rnd)];
+		r.positions.emplace_back(c.x + offset(rnd), 0.0f, c.z + offset(rnd));
+	}
+	std::uniform_real_distribution<float> radius(10.0f, 100.0f);
+	std::uniform_int_distribution<std::size_t> entity(0u, r.positions.size() - 1u);
+	for (int i = 0; i < queries; ++i) {
+		const bool fromCamp = i % 8 != 0;
+		const glm::vec3 center = fromCamp ? r.positions[entity(rnd)] : glm::vec3(coord(rnd), 0.0f, coord(rnd));
+		r.queries.push_back(Recording::Query{center, radius(rnd), i % 4 == 0});
+	}
+	return r;
+}
+
+}
+
+class SpatialBenchmark: public BenchmarkSuite {
+protected:
+	const int _iterations = 5;
+	const int _queries = 500;
+
+	void fill(ai::Zone& zone, const Recording& recording) const {
+		const ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("bench", "", ai::True::get());
+		std::vector<ai::AIPtr> ais;
+		ais.reserve(recording.positions.size());
+		for (std::size_t i = 0; i < recording.positions.size(); ++i) {
+			const ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+			character->setPosition(recording.positions[i]);
+			const ai::AIPtr ai = std::make_shared<ai::AI>(root);
+			ai->setCharacter(character);
+			ais.push_back(ai);
+		}
+		zone.addAIs(ais);
+		zone.update(0);
+	}
+
+	/**
+	 * @brief Replays the queries of the recording via the spatial index of the zone
+	 * @return The amount of found entities - to compare the different indices
+	 */
+	std::size_t replay(const ai::Zone& zone, const Recording& recording) const {
+		std::size_t found = 0u;
+		ai::Zone::CharacterIdList ids;
+		for (const Recording::Query& q : recording.queries) {
+			ids.clear();
+			if (q.box) {
+				found += zone.queryBox(q.center - glm::vec3(q.radius), q.center + glm::vec3(q.radius), ids);
+			} else {
+				found += zone.queryRadius(q.center, q.radius, ids);
+			}
+		}
+		return found;
+	}
+
+	/**
+	 * @brief Replays the queries of the recording by checking every entity of the zone
+	 */
+	std::size_t replayScan(const ai::Zone& zone, const Recording& recording) const {
+		std::size_t found = 0u;
+		for (const Recording::Query& q : recording.queries) {
+			const glm::vec3 mins = q.center - glm::vec3(q.radius);
+			const glm::vec3 maxs = q.center + glm::vec3(q.radius);
+			const float radiusSquared = q.radius * q.radius;
+			zone.execute([&] (const ai::AIPtr& ai) {
+				const glm::vec3& p = ai->getCharacter()->getPosition();
+				if (q.box) {
+					if (glm::all(glm::greaterThanEqual(p, mins)) && glm::all(glm::lessThanEqual(p, maxs))) {
+						++found;
+					}
+				} else if (glm::distance2(p, q.center) <= radiusSquared) {
+					++found;
+				}
+			});
+		}
+		return found;
+	}
+
+	void run(const Recording& recording) {
+		const int n = static_cast<int>(recording.positions.size());
+		ai_log("%s: %i queries", recording.name, (int)recording.queries.size());
+		ai::Zone zone("bench");
+		fill(zone, recording);
+		std::size_t expected = 0u;
+		report("Zone::execute scan", n, measure(1, [&] () {
+			expected = replayScan(zone, recording);
+		}));
+
+		zone.setSpatialGrid(100.0f);
+		ASSERT_EQ(expected, replay(zone, recording));
+		report("SpatialGrid", n, measure(_iterations, [&] () {
+			replay(zone, recording);
+		}));
+
+		zone.setSpatialTree(2.0f);
+		ASSERT_EQ(expected, replay(zone, recording));
+		report("AABBTree", n, measure(_iterations, [&] () {
+			replay(zone, recording);
+		}));
+
+		// the bulk build that is done if a zone is populated at once
+		report("AABBTree spawn", n, measure(1, [&] () {
+			ai::Zone spawn("spawn");
+			spawn.setSpatialTree(2.0f);
+			fill(spawn, recording);
+		}));
+	}
+};
+
+TEST_F(SpatialBenchmark, uniform10000) {
+	run(uniform(10000, _queries, 1u));
+}
+
+TEST_F(SpatialBenchmark, uniform50000) {
+	run(uniform(50000, _queries, 2u));
+}
+
+TEST_F(SpatialBenchmark, camps10000) {
+	run(camps(10000, _queries, 3u));
+}
+
+TEST_F(SpatialBenchmark, camps50000) {
+	run(camps(50000, _queries, 4u));
+}
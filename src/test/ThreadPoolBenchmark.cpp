@@ -0,0 +1,175 @@
+#include "ThreadPoolBenchmark.h"
+#include <queue>
+
+namespace {
+
+/**
+ * @brief The thread pool as it was before the work stealing queues were introduced: one
+ * task queue for all workers that is guarded by one mutex.
+ */
+class LegacyThreadPool {
+private:
+	std::vector<std::thread> _workers;
+	std::queue<std::function<void()> > _tasks;
+	std::mutex _queueMutex;
+	std::condition_variable _condition;
+	std::atomic_bool _stop;
+public:
+	explicit LegacyThreadPool(size_t threads) :
+			_stop(false) {
+		for (size_t i = 0; i < threads; ++i) {
+			_workers.emplace_back([this] {
+				for (;;) {
+					std::function<void()> task;
+					{
+						std::unique_lock<std::mutex> lock(_queueMutex);
+						_condition.wait(lock, [this] {
+							return _stop || !_tasks.empty();
+						});
+						if (_stop && _tasks.empty()) {
+							return;
+						}
+						task = std::move(_tasks.front());
+						_tasks.pop();
+					}
+					task();
+				}
+			});
+		}
+	}
+
+	~LegacyThreadPool() {
+		_stop = true;
+		_condition.notify_all();
+		for (std::thread &worker : _workers) {
+			worker.join();
+		}
+	}
+
+	template<class F, class ... Args>
+	auto enqueue(F&& f, Args&&... args) -> std::future<typename std::result_of<F(Args...)>::type> {
+		using return_type = typename std::result_of<F(Args...)>::type;
+		auto task = std::make_shared<std::packaged_task<return_type()> >(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+		std::future<return_type> res = task->get_future();
+		{
+			std::unique_lock<std::mutex> lock(_queueMutex);
+			_tasks.emplace([task]() {(*task)();});
+		}
+		_condition.notify_one();
+		return res;
+	}
+};
+
+}
+
+class ThreadPoolBenchmark: public BenchmarkSuite {
+protected:
+	const int _threads = 4;
+	const int _producers = 4;
+	const int _iterations = 5;
+	std::vector<ai::AIPtr> _ais;
+
+	void SetUp() override {
+		BenchmarkSuite::SetUp();
+		const ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("bench", "", ai::True::get());
+		const int n = 100000;
+		_ais.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			const ai::AIPtr ai = std::make_shared<ai::AI>(root);
+			ai->setCharacter(std::make_shared<TestEntity>(i));
+			_ais.push_back(ai);
+		}
+	}
+
+	static void tick(const ai::AIPtr& ai) {
+		ai->update(1, false);
+		ai->getBehaviour()->execute(ai, 1);
+	}
+
+	/**
+	 * @brief One future per AI - this is how the zone ticked its entities before the parallel for
+	 */
+	template<class Pool>
+	double enqueuePerAI(Pool& pool, int n) {
+		return measure(_iterations, [&] () {
+			std::vector<std::future<void> > results;
+			results.reserve(n);
+			for (int i = 0; i < n; ++i) {
+				results.emplace_back(pool.enqueue(tick, _ais[i]));
+			}
+			for (auto& result : results) {
+				result.wait();
+			}
+		});
+	}
+
+	/**
+	 * @brief Several threads are enqueuing at the same time
+	 */
+	template<class Pool>
+	double concurrentProducers(Pool& pool, int n) {
+		return measure(_iterations, [&] () {
+			std::vector<std::thread> producers;
+			const int perProducer = n / _producers;
+			for (int p = 0; p < _producers; ++p) {
+				producers.emplace_back([&, p] () {
+					std::vector<std::future<void> > results;
+					results.reserve(perProducer);
+					for (int i = p * perProducer; i < (p + 1) * perProducer; ++i) {
+						results.emplace_back(pool.enqueue(tick, _ais[i]));
+					}
+					for (auto& result : results) {
+						result.wait();
+					}
+				});
+			}
+			for (std::thread& producer : producers) {
+				producer.join();
+			}
+		});
+	}
+
+	/**
+	 * @brief Nested tasks that are scheduled from within the workers without futures
+	 */
+	double scheduleFromWorkers(ai::ThreadPool& pool, int n) {
+		const int chunks = 64;
+		const int perChunk = n / chunks;
+		return measure(_iterations, [&] () {
+			ai::Latch latch(chunks * perChunk);
+			for (int c = 0; c < chunks; ++c) {
+				pool.schedule([&, c] () {
+					for (int i = c * perChunk; i < (c + 1) * perChunk; ++i) {
+						pool.schedule([&, i] () {
+							tick(_ais[i]);
+							latch.countDown();
+						});
+					}
+				});
+			}
+			latch.wait();
+		});
+	}
+
+	void run(int n) {
+		{
+			LegacyThreadPool pool(_threads);
+			report("legacy enqueue per ai", n, enqueuePerAI(pool, n));
+			report("legacy concurrent producers", n, concurrentProducers(pool, n));
+		}
+		{
+			ai::ThreadPool pool(_threads);
+			report("stealing enqueue per ai", n, enqueuePerAI(pool, n));
+			report("stealing concurrent producers", n, concurrentProducers(pool, n));
+			report("stealing nested schedule", n, scheduleFromWorkers(pool, n));
+		}
+	}
+};
+
+TEST_F(ThreadPoolBenchmark, tasks10000) {
+	run(10000);
+}
+
+TEST_F(ThreadPoolBenchmark, tasks100000) {
+	run(100000);
+}
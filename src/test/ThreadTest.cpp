@@ -0,0 +1,164 @@
+#include "ThreadTest.h"
+
+class ThreadTest: public TestSuite {
+};
+
+TEST_F(ThreadTest, testEnqueue) {
+	ai::ThreadPool pool(2);
+	std::vector<std::future<int> > results;
+	for (int i = 0; i < 100; ++i) {
+		results.emplace_back(pool.enqueue([] (int value) { return value * 2; }, i));
+	}
+	for (int i = 0; i < 100; ++i) {
+		ASSERT_EQ(i * 2, results[i].get());
+	}
+}
+
+TEST_F(ThreadTest, testSchedule) {
+	std::atomic_int count(0);
+	{
+		ai::ThreadPool pool(3);
+		ai::Latch latch(1000);
+		for (int i = 0; i < 1000; ++i) {
+			pool.schedule([&] () {
+				++count;
+				latch.countDown();
+			});
+		}
+		latch.wait();
+		ASSERT_EQ(1000, count);
+	}
+}
+
+TEST_F(ThreadTest, testScheduleFromWorker) {
+	std::atomic_int count(0);
+	{
+		ai::ThreadPool pool(2);
+		for (int i = 0; i < 10; ++i) {
+			pool.schedule([&] () {
+				for (int j = 0; j < 10; ++j) {
+					pool.schedule([&] () {
+						++count;
+					});
+				}
+			});
+		}
+	}
+	ASSERT_EQ(100, count) << "The destructor should wait for all queued tasks";
+}
+
+TEST_F(ThreadTest, testNoWorkers) {
+	ai::ThreadPool pool(0);
+	ASSERT_EQ(42, pool.enqueue([] () { return 42; }).get());
+}
+
+TEST_F(ThreadTest, testConcurrentReaders) {
+	ai::ReadWriteLock lock("test-readers");
+	ai::Latch readersInside(2);
+	ai::Latch release(1);
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 2; ++i) {
+		readers.emplace_back([&] () {
+			ai::ScopedReadLock scopedLock(lock);
+			readersInside.countDown();
+			// only returns if both readers hold the lock at the same time
+			readersInside.wait();
+			release.wait();
+		});
+	}
+	readersInside.wait();
+	release.countDown();
+	for (std::thread& t : readers) {
+		t.join();
+	}
+}
+
+TEST_F(ThreadTest, testWriterExclusive) {
+	ai::ReadWriteLock lock("test-writers");
+	int value = 0;
+	int inside = 0;
+	std::vector<std::thread> threads;
+	for (int i = 0; i < 4; ++i) {
+		threads.emplace_back([&, i] () {
+			for (int j = 0; j < 1000; ++j) {
+				if ((i + j) % 2) {
+					ai::ScopedWriteLock scopedLock(lock);
+					ASSERT_EQ(0, inside);
+					++inside;
+					++value;
+					--inside;
+				} else {
+					ai::ScopedReadLock scopedLock(lock);
+					ASSERT_EQ(0, inside);
+				}
+			}
+		});
+	}
+	for (std::thread& t : threads) {
+		t.join();
+	}
+	ASSERT_EQ(2000, value);
+}
+
+TEST_F(ThreadTest, testLockStats) {
+	// the statistics are aggregated by name - a unique name keeps repeated runs apart
+	static int run = 0;
+	const std::string name = "test-stats-" + std::to_string(run++);
+	{
+		ai::ReadWriteLock lock(name);
+		for (int i = 0; i < 10; ++i) {
+			ai::ScopedReadLock scopedLock(lock);
+		}
+		std::thread writer;
+		{
+			ai::ScopedWriteLock scopedLock(lock);
+			writer = std::thread([&] () {
+				ai::ScopedWriteLock writerLock(lock);
+			});
+			// the writer must be waiting before the lock is released
+			while (lock.getWaitingWriters() == 0) {
+				std::this_thread::yield();
+			}
+		}
+		writer.join();
+	}
+	// the statistics survive the lock
+	for (const ai::LockStats& stats : ai::ReadWriteLock::getStats()) {
+		if (stats.name != name) {
+			continue;
+		}
+		ASSERT_EQ(12u, stats.acquisitions);
+		ASSERT_EQ(1u, stats.contended);
+		return;
+	}
+	FAIL() << "No statistics for the lock";
+}
+
+TEST_F(ThreadTest, testLockStatsUncontended) {
+	static int run = 0;
+	const std::string name = "test-stats-uncontended-" + std::to_string(run++);
+	auto find = [&name] () -> ai::LockStats {
+		for (const ai::LockStats& stats : ai::ReadWriteLock::getStats()) {
+			if (stats.name == name) {
+				return stats;
+			}
+		}
+		return ai::LockStats();
+	};
+	{
+		ai::ReadWriteLock lock(name);
+		ASSERT_NE(name, find().name) << "A lock that was never acquired shouldn't be registered";
+		for (int i = 0; i < 3; ++i) {
+			ai::ScopedReadLock scopedLock(lock);
+		}
+		{
+			ai::ScopedWriteLock scopedLock(lock);
+		}
+		// a live lock that never had to wait
+		const ai::LockStats stats = find();
+		ASSERT_EQ(name, stats.name);
+		ASSERT_EQ(4u, stats.acquisitions);
+		ASSERT_EQ(0u, stats.contended);
+	}
+	ASSERT_EQ(4u, find().acquisitions) << "The statistics should survive the lock";
+}
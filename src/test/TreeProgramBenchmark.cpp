@@ -0,0 +1,110 @@
+#include "TreeProgramBenchmark.h"
+
+class TreeProgramBenchmark: public BenchmarkSuite {
+protected:
+	const int _ticks = 20;
+
+	/**
+	 * @brief A priority selector with several disabled branches in front of a running one - like a
+	 * typical combat behaviour that is idling most of the time
+	 */
+	ai::TreeNodePtr createTree() const {
+		const ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("root", "", ai::True::get());
+		for (int i = 0; i < 8; ++i) {
+			const ai::TreeNodePtr branch = std::make_shared<ai::Sequence>("branch", "", ai::False::get());
+			branch->addChild(std::make_shared<ai::Idle>("idle", "1000", ai::True::get()));
+			root->addChild(branch);
+		}
+		const ai::TreeNodePtr parallel = std::make_shared<ai::Parallel>("parallel", "", ai::True::get());
+		for (int i = 0; i < 4; ++i) {
+			const ai::TreeNodePtr sequence = std::make_shared<ai::Sequence>("sequence", "", ai::True::get());
+			const ai::TreeNodePtr invert = std::make_shared<ai::Invert>("invert", "", ai::True::get());
+			const ai::TreeNodePtr limit = std::make_shared<ai::Limit>("limit", "1000000", ai::True::get());
+			invert->addChild(std::make_shared<ai::Sequence>("empty", "", ai::True::get()));
+			limit->addChild(std::make_shared<ai::Idle>("idle", "1000000", ai::True::get()));
+			sequence->addChild(invert);
+			sequence->addChild(limit);
+			parallel->addChild(sequence);
+		}
+		root->addChild(parallel);
+		return root;
+	}
+
+	/**
+	 * @brief A long running task deep down in the tree - the way down can be resumed
+	 */
+	ai::TreeNodePtr createDeepTree() const {
+		const ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("root", "", ai::True::get());
+		for (int i = 0; i < 8; ++i) {
+			const ai::TreeNodePtr branch = std::make_shared<ai::Sequence>("branch", "", ai::False::get());
+			branch->addChild(std::make_shared<ai::Idle>("idle", "1000", ai::True::get()));
+			root->addChild(branch);
+		}
+		ai::TreeNodePtr parent = root;
+		for (int i = 0; i < 8; ++i) {
+			const ai::TreeNodePtr sequence = std::make_shared<ai::Sequence>("sequence", "", ai::True::get());
+			parent->addChild(sequence);
+			parent = sequence;
+		}
+		parent->addChild(std::make_shared<ai::Idle>("idle", "1000000", ai::True::get()));
+		return root;
+	}
+
+	void resume(int n) {
+		const ai::TreeNodePtr root = createDeepTree();
+		const ai::TreeProgramPtr program = ai::TreeProgram::compile(root);
+		const ai::TreeProgramPtr resuming = ai::TreeProgram::compile(root, true);
+		std::vector<ai::AIPtr> ais;
+		ais.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			const ai::AIPtr ai = std::make_shared<ai::AI>(root);
+			ai->setCharacter(std::make_shared<TestEntity>(i));
+			ais.push_back(ai);
+		}
+		report("TreeProgram::execute", n, measure(_ticks, [&] () {
+			for (const ai::AIPtr& ai : ais) {
+				program->execute(ai, 1);
+			}
+		}));
+		for (const ai::AIPtr& ai : ais) {
+			ai->setProgram(resuming);
+		}
+		report("TreeProgram::execute resume", n, measure(_ticks, [&] () {
+			for (const ai::AIPtr& ai : ais) {
+				resuming->execute(ai, 1);
+			}
+		}));
+	}
+
+	void compare(int n) {
+		const ai::TreeNodePtr root = createTree();
+		const ai::TreeProgramPtr program = ai::TreeProgram::compile(root);
+		std::vector<ai::AIPtr> ais;
+		ais.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			const ai::AIPtr ai = std::make_shared<ai::AI>(root);
+			ai->setCharacter(std::make_shared<TestEntity>(i));
+			ais.push_back(ai);
+		}
+		report("TreeNode::execute", n, measure(_ticks, [&] () {
+			for (const ai::AIPtr& ai : ais) {
+				root->execute(ai, 1);
+			}
+		}));
+		report("TreeProgram::execute", n, measure(_ticks, [&] () {
+			for (const ai::AIPtr& ai : ais) {
+				program->execute(ai, 1);
+			}
+		}));
+	}
+};
+
+TEST_F(TreeProgramBenchmark, execute1000) {
+	compare(1000);
+	resume(1000);
+}
+
+TEST_F(TreeProgramBenchmark, execute10000) {
+	compare(10000);
+	resume(10000);
+}
@@ -42,7 +42,7 @@ TEST_F(XMLTreeLoaderTest, testLoadExample1) {
 	const ai::TreeNodePtr& node = _loader.load("example1");
 	ASSERT_NE(nullptr, node.get()) << "Could not find the espected behaviour";
 	ASSERT_EQ("root1", node->getName()) << "unexpected root node name";
-	const ai::TreeNodes& children = node->getChildren();
+	const ai::TreeNodes& children = static_cast<const ai::TreeNode&>(*node).getChildren();
 	const int childrenAmount = children.size();
 	ASSERT_EQ(1, childrenAmount) << "expected amount of children";
 	ASSERT_EQ("idle1", children[0]->getName()) << "unexpected child node name";
@@ -54,7 +54,7 @@ TEST_F(XMLTreeLoaderTest, testLoadExample2) {
 	const ai::TreeNodePtr& node = _loader.load("example2");
 	ASSERT_NE(nullptr, node.get()) << "Could not find the espected behaviour";
 	ASSERT_EQ("root2", node->getName()) << "unexpected root node name";
-	const ai::TreeNodes& children = node->getChildren();
+	const ai::TreeNodes& children = static_cast<const ai::TreeNode&>(*node).getChildren();
 	const int childrenAmount = children.size();
 	ASSERT_EQ(2, childrenAmount) << "expected amount of children";
 }
@@ -0,0 +1,104 @@
+#include "ZoneBenchmark.h"
+
+class ZoneBenchmark: public BenchmarkSuite {
+protected:
+	const int _ticks = 10;
+
+	void fill(ai::Zone& zone, int n) const {
+		const ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("bench", "", ai::True::get());
+		std::vector<ai::AIPtr> ais;
+		ais.reserve(n);
+		for (int i = 0; i < n; ++i) {
+			const ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+			const ai::AIPtr ai = std::make_shared<ai::AI>(root);
+			ai->setCharacter(character);
+			ais.push_back(ai);
+		}
+		zone.addAIs(ais);
+		zone.update(0);
+	}
+
+	/**
+	 * @brief Measures the tick of the zone
+	 */
+	void update(int n) {
+		ai::Zone zone("bench");
+		fill(zone, n);
+		ASSERT_EQ(n, (int)zone.size());
+		report("Zone::update", n, measure(_ticks, [&] () {
+			zone.update(1);
+		}));
+	}
+
+	/**
+	 * @brief Measures the tick of the zone if 90 percent of the entities are sleeping
+	 */
+	void sleepingUpdate(int n) {
+		ai::Zone zone("bench");
+		fill(zone, n);
+		zone.execute([] (const ai::AIPtr& ai) {
+			if (ai->getId() % 10 != 0) {
+				ai->sleep();
+			}
+		});
+		zone.update(1);
+		report("Zone::update 90% sleeping", n, measure(_ticks, [&] () {
+			zone.update(1);
+		}));
+	}
+
+	/**
+	 * @brief The zone tick as it was done before the dense storage: A copy of a
+	 * hash map is created and each entry is executed in the thread pool.
+	 */
+	void copyUpdate(int n) {
+		ai::Zone zone("bench");
+		fill(zone, n);
+		typedef std::unordered_map<ai::CharacterId, ai::AIPtr> AIMap;
+		AIMap ais;
+		zone.execute([&] (const ai::AIPtr& ai) {
+			ais.insert(std::make_pair(ai->getId(), ai));
+		});
+		auto func = [] (const ai::AIPtr& ai) {
+			if (ai->isPause()) {
+				return;
+			}
+			ai->update(1, false);
+			ai->getBehaviour()->execute(ai, 1);
+		};
+		report("AIMap copy + execute", n, measure(_ticks, [&] () {
+			const AIMap copy(ais);
+			std::vector<std::future<void> > results;
+			for (auto i = copy.begin(); i != copy.end(); ++i) {
+				results.emplace_back(zone.executeAsync(i->second, func));
+			}
+			for (auto& result : results) {
+				result.wait();
+			}
+		}));
+	}
+};
+
+TEST_F(ZoneBenchmark, update1000) {
+	copyUpdate(1000);
+	update(1000);
+	sleepingUpdate(1000);
+}
+
+TEST_F(ZoneBenchmark, update10000) {
+	copyUpdate(10000);
+	update(10000);
+	sleepingUpdate(10000);
+}
+
+TEST_F(ZoneBenchmark, update50000) {
+	copyUpdate(50000);
+	update(50000);
+	sleepingUpdate(50000);
+}
+
+TEST_F(ZoneBenchmark, update100000) {
+	copyUpdate(100000);
+	update(100000);
+	sleepingUpdate(100000);
+}
@@ -45,6 +45,43 @@ protected:
 
 std::vector<ai::AIPtr> ZoneTest::_v;
 
+namespace {
+/**
+ * @brief Moves to the position of its predecessor plus one - the result depends on the update order
+ * if the characters are not double buffered
+ */
+class FollowEntity : public TestEntity {
+private:
+	ai::ICharacterPtr _predecessor;
+public:
+	FollowEntity(const ai::CharacterId& id, const ai::ICharacterPtr& predecessor) :
+			TestEntity(id), _predecessor(predecessor) {
+	}
+
+	void update(int64_t, bool) override {
+		if (_predecessor) {
+			setPosition(_predecessor->getPosition() + glm::vec3(1.0f, 0.0f, 0.0f));
+		}
+	}
+};
+
+/**
+ * @brief Counts its updates
+ */
+class CountingEntity : public TestEntity {
+public:
+	int updates = 0;
+
+	CountingEntity(const ai::CharacterId& id) :
+			TestEntity(id) {
+	}
+
+	void update(int64_t, bool) override {
+		++updates;
+	}
+};
+}
+
 TEST_F(ZoneTest, testChanges) {
 	ai::Zone zone("test1");
 	ai::AIPtr ai = _v[0];
@@ -107,3 +144,1091 @@ TEST_F(ZoneTest, testSingleAdd10000) {
 TEST_F(ZoneTest, testSingleAdd100000) {
 	singleAdd(100000);
 }
+
+TEST_F(ZoneTest, testParallelFor) {
+	ai::Zone zone("test1", 3);
+	const int n = 1000;
+	std::vector<ai::AIPtr> v(_v.begin(), _v.begin() + n);
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	ASSERT_EQ(n, (int)zone.size());
+	for (std::size_t grainSize : {0u, 1u, 7u, 400u, 5000u}) {
+		std::vector<std::atomic_int> visits(n);
+		for (auto& visit : visits) {
+			visit = 0;
+		}
+		auto func = [&] (const ai::AIPtr& ai) {
+			++visits[ai->getId()];
+		};
+		zone.parallelFor(func, grainSize);
+		for (int i = 0; i < n; ++i) {
+			ASSERT_EQ(1, visits[i]) << "Entity " << i << " wasn't visited exactly once with grain size " << grainSize;
+		}
+	}
+}
+
+TEST_F(ZoneTest, testZoneScheduler) {
+	ai::ZoneScheduler scheduler(2);
+	const int zones = 4;
+	const int n = 250;
+	std::vector<std::unique_ptr<ai::Zone> > list;
+	for (int i = 0; i < zones; ++i) {
+		list.emplace_back(new ai::Zone("scheduled" + std::to_string(i), scheduler.getThreadPool()));
+		ai::Zone* zone = list.back().get();
+		std::vector<ai::AIPtr> v(_v.begin() + i * n, _v.begin() + (i + 1) * n);
+		ASSERT_TRUE(zone->addAIs(v)) << "Could not add ai to the zone";
+		ASSERT_TRUE(scheduler.addZone(zone)) << "Could not register the zone";
+	}
+	ASSERT_FALSE(scheduler.addZone(list[0].get())) << "Zone was registered twice";
+	ASSERT_EQ(zones, (int)scheduler.size());
+
+	std::vector<int64_t> times;
+	for (int i = 0; i < zones * n; ++i) {
+		times.push_back(_v[i]->getTime());
+	}
+	const int ticks = 3;
+	for (int i = 0; i < ticks; ++i) {
+		scheduler.update(10);
+	}
+	for (int i = 0; i < zones * n; ++i) {
+		ASSERT_EQ(times[i] + ticks * 10, _v[i]->getTime()) << "Entity " << i << " wasn't updated in every tick";
+	}
+
+	const ai::ZoneScheduler::ZoneStatsList& stats = scheduler.getStats();
+	ASSERT_EQ(zones, (int)stats.size());
+	for (const ai::ZoneScheduler::ZoneStats& s : stats) {
+		ASSERT_EQ(ticks, s.ticks);
+		ASSERT_EQ(n, (int)s.zone->size());
+		ASSERT_GE(s.averageMicros, 0);
+	}
+
+	ASSERT_TRUE(scheduler.removeZone(list[0].get()));
+	ASSERT_FALSE(scheduler.removeZone(list[0].get()));
+	ai::ZoneScheduler::ZoneStats single;
+	ASSERT_FALSE(scheduler.getStats(list[0].get(), single));
+	ASSERT_TRUE(scheduler.getStats(list[1].get(), single));
+	scheduler.update(10);
+	ASSERT_TRUE(scheduler.getStats(list[1].get(), single));
+	ASSERT_EQ(ticks + 1, single.ticks);
+	ASSERT_EQ(times[0] + ticks * 10, _v[0]->getTime()) << "Removed zone was still updated";
+}
+
+TEST_F(ZoneTest, testSnapshot) {
+	ai::Zone zone("test1");
+	const int n = 100;
+	std::vector<ai::AIPtr> v(_v.begin(), _v.begin() + n);
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	ASSERT_EQ(n, (int)zone.size());
+	int visited = 0;
+	auto func = [&] (const ai::AIPtr& ai) {
+		if (visited++ == 0) {
+			// publish a new snapshot while the old one is still iterated
+			zone.removeAIs(v);
+			zone.update(0l);
+			ASSERT_EQ(0, (int)zone.size());
+		}
+		ASSERT_TRUE((bool)ai);
+		ASSERT_FALSE((bool)zone.getAI(ai->getId())) << "The lookup should use the new snapshot";
+	};
+	zone.execute(func);
+	ASSERT_EQ(n, visited) << "The iteration should continue on the old snapshot";
+	zone.update(0l);
+	ASSERT_EQ(0, (int)zone.size());
+}
+
+TEST_F(ZoneTest, testSnapshotReaders) {
+	ai::Zone zone("test1");
+	const int n = 100;
+	std::vector<ai::AIPtr> v(_v.begin(), _v.begin() + n);
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	const std::vector<ai::AIPtr> removed(v.begin(), v.begin() + n / 2);
+	int visited = 0;
+	auto func = [&] (const ai::AIPtr& ai) {
+		if (visited++ == 0) {
+			zone.removeAIs(removed);
+			zone.update(0l);
+			ASSERT_EQ(n / 2, (int)zone.size());
+			// the instance that is iterated here is the one that would be changed next
+			zone.addAIs(removed);
+			zone.update(0l);
+			ASSERT_EQ(n / 2, (int)zone.size()) << "The changes should wait for the reader";
+		}
+		ASSERT_TRUE((bool)ai);
+	};
+	zone.execute(func);
+	ASSERT_EQ(n, visited) << "The iteration should continue on the old snapshot";
+	zone.update(0l);
+	ASSERT_EQ(n, (int)zone.size());
+	for (const ai::AIPtr& ai : v) {
+		ASSERT_EQ(ai, zone.getAI(ai->getId()));
+	}
+
+	// readers that overlap all the time don't keep the changes from being applied
+	std::atomic_bool stop(false);
+	std::thread reader([&] () {
+		while (!stop) {
+			zone.execute([] (const ai::AIPtr& ai) {
+				ASSERT_TRUE((bool)ai);
+			});
+		}
+	});
+	for (int i = 0; i < 100; ++i) {
+		if (i % 2 == 0) {
+			zone.removeAIs(removed);
+		} else {
+			zone.addAIs(removed);
+		}
+		while (zone.size() != (i % 2 == 0 ? n / 2 : n)) {
+			zone.update(0l);
+		}
+	}
+	stop = true;
+	reader.join();
+	zone.removeAIs(v);
+	zone.update(0l);
+	ASSERT_EQ(0, (int)zone.size());
+	zone.update(0l);
+	ASSERT_EQ(0, (int)zone.size());
+}
+
+TEST_F(ZoneTest, testUpdateInterval) {
+	ai::Zone zone("test1");
+	const int n = 64;
+	const int interval = 4;
+	const int64_t dt = 10;
+	std::vector<ai::AIPtr> v(_v.begin(), _v.begin() + n);
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	for (const ai::AIPtr& ai : v) {
+		ai->setUpdateInterval(interval);
+	}
+	std::vector<int64_t> start;
+	for (const ai::AIPtr& ai : v) {
+		start.push_back(ai->getTime());
+	}
+	for (int tick = 0; tick < interval * 2; ++tick) {
+		std::vector<int64_t> before;
+		for (const ai::AIPtr& ai : v) {
+			before.push_back(ai->getTime());
+		}
+		zone.update(dt);
+		int updated = 0;
+		for (int i = 0; i < n; ++i) {
+			if (v[i]->getTime() != before[i]) {
+				++updated;
+			}
+		}
+		ASSERT_EQ(n / interval, updated) << "The updates should be spread evenly over the ticks";
+	}
+	// back to every tick - this hands over the remaining skipped time
+	for (const ai::AIPtr& ai : v) {
+		ai->setUpdateInterval(1);
+	}
+	zone.update(dt);
+	for (int i = 0; i < n; ++i) {
+		ASSERT_EQ((interval * 2 + 1) * dt, v[i]->getTime() - start[i]) << "The skipped ticks should be added to the next update";
+	}
+
+	// the callback overrides the intervals
+	zone.setUpdateIntervalFunc([] (const ai::AIPtr& ai) {
+		return ai->getId() % 2 == 0 ? 1 : 16;
+	});
+	zone.update(dt);
+	for (const ai::AIPtr& ai : v) {
+		ASSERT_EQ(ai->getId() % 2 == 0 ? 1 : 16, ai->getUpdateInterval());
+	}
+	zone.setUpdateIntervalFunc(ai::Zone::UpdateIntervalFunc());
+	for (const ai::AIPtr& ai : v) {
+		ai->setUpdateInterval(1);
+	}
+}
+
+TEST_F(ZoneTest, testUpdateBudget) {
+	ai::Zone zone("test1", 1);
+	const int n = 1000;
+	const int64_t dt = 10;
+	std::vector<ai::AIPtr> v(_v.begin(), _v.begin() + n);
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	std::vector<int64_t> start;
+	for (const ai::AIPtr& ai : v) {
+		start.push_back(ai->getTime());
+	}
+
+	// a budget that is always exceeded after the first chunk of entities
+	int calls = 0;
+	do {
+		zone.update(dt, std::chrono::microseconds(0));
+		++calls;
+		if (zone.getUpdateLag() != 0) {
+			ASSERT_EQ(calls * dt, zone.getUpdateLag());
+		}
+	} while (zone.getUpdateLag() != 0 && calls < n);
+	ASSERT_GT(calls, 1) << "The budget should have split the update";
+	ASSERT_LT(calls, n) << "Every call should update at least one entity";
+
+	// a budget that fits all the entities - every entity gets the time that passed since its own last update
+	zone.update(dt, std::chrono::seconds(10));
+	ASSERT_EQ(0, zone.getUpdateLag());
+	for (int i = 0; i < n; ++i) {
+		ASSERT_EQ((calls + 1) * dt, v[i]->getTime() - start[i]) << "Entity " << i << " lost time";
+	}
+}
+
+TEST_F(ZoneTest, testUpdateBudgetChanges) {
+	ai::Zone zone("test1", 1);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 1000;
+	const int64_t dt = 10;
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < n; ++i) {
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(std::make_shared<TestEntity>(i));
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+
+	// the first chunk of the round
+	zone.update(dt, std::chrono::microseconds(0));
+	ASSERT_EQ(dt, zone.getUpdateLag());
+	std::vector<ai::AIPtr> updated;
+	std::vector<ai::AIPtr> pending;
+	for (const ai::AIPtr& ai : v) {
+		(ai->getTime() == dt ? updated : pending).push_back(ai);
+	}
+	ASSERT_FALSE(updated.empty());
+	ASSERT_GT(pending.size(), 10u);
+
+	// removing entities in the middle of the round must not reorder the entities that are still due
+	std::vector<ai::AIPtr> removed(updated.begin(), updated.begin() + 5);
+	removed.insert(removed.end(), pending.begin(), pending.begin() + 5);
+	for (const ai::AIPtr& ai : removed) {
+		ASSERT_TRUE(zone.removeAI(ai));
+	}
+	int calls = 1;
+	do {
+		zone.update(dt, std::chrono::microseconds(0));
+		++calls;
+		if (zone.getUpdateLag() != 0) {
+			ASSERT_EQ(calls * dt, zone.getUpdateLag());
+		}
+	} while (zone.getUpdateLag() != 0 && calls < n);
+	ASSERT_EQ(0, zone.getUpdateLag());
+	for (const ai::AIPtr& ai : removed) {
+		ASSERT_EQ(std::find(updated.begin(), updated.end(), ai) != updated.end() ? dt : 0, ai->getTime())
+			<< "Entity " << ai->getId() << " was updated after it was removed";
+	}
+	for (std::size_t i = 5u; i < updated.size(); ++i) {
+		ASSERT_EQ(dt, updated[i]->getTime()) << "Entity " << updated[i]->getId() << " was updated twice in the round";
+	}
+	for (std::size_t i = 5u; i < pending.size(); ++i) {
+		ASSERT_NE(0, pending[i]->getTime()) << "Entity " << pending[i]->getId() << " was skipped in the round";
+	}
+}
+
+TEST_F(ZoneTest, testUpdateBudgetOncePerCall) {
+	ai::Zone zone("test1", 1);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 1000;
+	const int64_t dt = 10;
+	std::vector<ai::AIPtr> v;
+	std::vector<std::shared_ptr<CountingEntity> > entities;
+	for (int i = 0; i < n; ++i) {
+		entities.push_back(std::make_shared<CountingEntity>(i));
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(entities.back());
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	for (const std::shared_ptr<CountingEntity>& entity : entities) {
+		entity->updates = 0;
+	}
+
+	// the first chunk of the round - then an entity that was already updated leaves the zone, which
+	// moves the last entity of the active list to the front
+	zone.update(dt, std::chrono::microseconds(0));
+	ASSERT_NE(0, zone.getUpdateLag());
+	ASSERT_EQ(1, entities[0]->updates);
+	ASSERT_EQ(0, entities[n - 1]->updates);
+	ASSERT_TRUE(zone.removeAI(v[0]));
+	for (const std::shared_ptr<CountingEntity>& entity : entities) {
+		entity->updates = 0;
+	}
+
+	// enough budget to finish the round and to start the next one
+	zone.update(dt, std::chrono::seconds(10));
+	ASSERT_EQ(0, zone.getUpdateLag());
+	ASSERT_EQ(0, entities[0]->updates) << "The removed entity was updated";
+	int updated = 0;
+	for (int i = 1; i < n; ++i) {
+		ASSERT_GE(1, entities[i]->updates) << "Entity " << i << " was updated twice in one call";
+		updated += entities[i]->updates;
+	}
+	ASSERT_GT(updated, 0);
+
+	// the next call starts a new round with every entity
+	for (const std::shared_ptr<CountingEntity>& entity : entities) {
+		entity->updates = 0;
+	}
+	zone.update(dt, std::chrono::seconds(10));
+	for (int i = 1; i < n; ++i) {
+		ASSERT_EQ(1, entities[i]->updates) << "Entity " << i << " wasn't updated in the new round";
+	}
+}
+
+TEST_F(ZoneTest, testSleep) {
+	ai::Zone zone("test1");
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 5; ++i) {
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(std::make_shared<TestEntity>(i));
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	ASSERT_TRUE(zone.getGroupMgr().add(1, v[3]));
+
+	const int64_t dt = 10;
+	v[0]->sleep(100);
+	for (int i = 1; i < 5; ++i) {
+		v[i]->sleep();
+	}
+	// the sleep starts after the next tick
+	zone.update(dt);
+	for (const ai::AIPtr& ai : v) {
+		ASSERT_TRUE(ai->isSleeping());
+		ASSERT_EQ(dt, ai->getTime());
+	}
+
+	v[1]->getAggroMgr().addAggro(42, 1.0f);
+	ASSERT_TRUE(zone.wake(v[2]->getId()));
+	ASSERT_TRUE(zone.getGroupMgr().add(1, v[4]));
+	zone.update(dt);
+	ASSERT_TRUE(v[0]->isSleeping());
+	ASSERT_EQ(dt, v[0]->getTime());
+	for (int i = 1; i < 5; ++i) {
+		ASSERT_FALSE(v[i]->isSleeping()) << "Entity " << i << " wasn't woken up";
+		ASSERT_EQ(2 * dt, v[i]->getTime()) << "Entity " << i << " lost the time it was sleeping";
+	}
+
+	// the timer fires once the sleep time passed - and the whole time is handed over
+	int ticks = 2;
+	while (v[0]->isSleeping()) {
+		ASSERT_LT(ticks, 20) << "The sleep timer didn't fire";
+		zone.update(dt);
+		++ticks;
+	}
+	ASSERT_GE(ticks * dt, dt + 100);
+	ASSERT_EQ(ticks * dt, v[0]->getTime());
+
+	// group changes only wake up the affected entity and the leader
+	ai::GroupMgr& groupMgr = zone.getGroupMgr();
+	ASSERT_TRUE(groupMgr.add(1, v[2]));
+	zone.update(dt);
+	for (int i = 2; i < 5; ++i) {
+		v[i]->sleep();
+	}
+	zone.update(dt);
+	for (int i = 2; i < 5; ++i) {
+		ASSERT_TRUE(v[i]->isSleeping());
+	}
+	ASSERT_TRUE(groupMgr.remove(1, v[4]));
+	zone.update(dt);
+	ASSERT_TRUE(v[2]->isSleeping()) << "Other group members shouldn't be woken up";
+	ASSERT_FALSE(v[3]->isSleeping()) << "The leader wasn't woken up";
+	ASSERT_FALSE(v[4]->isSleeping()) << "The removed member wasn't woken up";
+
+	// sleeping entities can be removed
+	v[1]->sleep();
+	zone.update(dt);
+	ASSERT_TRUE(v[1]->isSleeping());
+	ASSERT_TRUE(zone.removeAI(v[1]));
+	zone.update(dt);
+	ASSERT_FALSE(v[1]->isSleeping());
+	ASSERT_FALSE((bool)zone.getAI(v[1]->getId()));
+}
+
+TEST_F(ZoneTest, testSleepNode) {
+	ai::Zone zone("test1");
+	const ai::TreeNodeFactoryContext ctx("sleep", "", ai::True::get());
+	ai::TreeNodePtr root = ai::Sleep::getFactory().create(&ctx);
+	ai::AIPtr ai = std::make_shared<ai::AI>(root);
+	ai->setCharacter(std::make_shared<TestEntity>(1));
+	ASSERT_TRUE(zone.addAI(ai));
+	zone.update(10);
+	ASSERT_TRUE(ai->isSleeping());
+	ai->wake();
+	zone.update(10);
+	ASSERT_EQ(20, ai->getTime());
+	ASSERT_TRUE(ai->isSleeping()) << "The node should put the entity to sleep again";
+}
+
+TEST_F(ZoneTest, testDoubleBuffering) {
+	ai::Zone zone("test1", 4);
+	zone.setDoubleBuffering(true);
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 1000;
+	std::vector<ai::AIPtr> v;
+	ai::ICharacterPtr predecessor;
+	for (int i = 0; i < n; ++i) {
+		ai::ICharacterPtr character = std::make_shared<FollowEntity>(i, predecessor);
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+		predecessor = character;
+	}
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+	ASSERT_TRUE(zone.isDoubleBuffering());
+	ASSERT_TRUE(v[1]->getCharacter()->isDoubleBuffered());
+
+	// every tick only sees the positions of the last tick - so the chain moves one step per tick
+	// (the update that added the entities was the first tick)
+	for (int tick = 2; tick <= 4; ++tick) {
+		zone.update(1l);
+		for (int i = 0; i < n; ++i) {
+			const float expected = static_cast<float>(std::min(i, tick));
+			ASSERT_FLOAT_EQ(expected, v[i]->getCharacter()->getPosition().x) << "Entity " << i << " in tick " << tick;
+		}
+	}
+
+	// the pending values are committed when the mode is switched off
+	const ai::ICharacterPtr& chr = v[0]->getCharacter();
+	chr->setSpeed(5.0f);
+	ASSERT_FLOAT_EQ(0.0f, chr->getSpeed());
+	ASSERT_FLOAT_EQ(5.0f, chr->getNextSpeed());
+	zone.setDoubleBuffering(false);
+	zone.update(1l);
+	ASSERT_FALSE(chr->isDoubleBuffered());
+	ASSERT_FLOAT_EQ(5.0f, chr->getSpeed());
+	chr->setSpeed(6.0f);
+	ASSERT_FLOAT_EQ(6.0f, chr->getSpeed());
+}
+
+TEST_F(ZoneTest, testSpatialGrid) {
+	ai::Zone zone("test1");
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const int n = 100;
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < n; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+
+	auto query = [&] (const glm::vec3& center, float radius) {
+		ai::Zone::CharacterIdList ids;
+		zone.queryRadius(center, radius, ids);
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	};
+	const ai::Zone::CharacterIdList expected = {8, 9, 10, 11, 12};
+	// without a grid every entity is checked
+	ASSERT_FALSE(zone.hasSpatialGrid());
+	ASSERT_EQ(expected, query(glm::vec3(10.0f, 0.0f, 0.0f), 2.5f));
+	zone.setSpatialGrid(4.0f);
+	ASSERT_TRUE(zone.hasSpatialGrid());
+	ASSERT_EQ(expected, query(glm::vec3(10.0f, 0.0f, 0.0f), 2.5f));
+	ASSERT_EQ((std::size_t)n, query(glm::vec3(50.0f, 0.0f, 0.0f), 1000.0f).size());
+	ASSERT_TRUE(query(glm::vec3(10.0f, 0.0f, 10.0f), 2.5f).empty());
+
+	// the grid follows the characters with the next update
+	v[50]->getCharacter()->setPosition(glm::vec3(10.0f, 0.0f, 0.5f));
+	zone.update(1l);
+	const ai::Zone::CharacterIdList moved = {8, 9, 10, 11, 12, 50};
+	ASSERT_EQ(moved, query(glm::vec3(10.0f, 0.0f, 0.0f), 2.5f));
+
+	ASSERT_TRUE(zone.removeAI(v[9]));
+	zone.update(1l);
+	const ai::Zone::CharacterIdList removed = {8, 10, 11, 12, 50};
+	ASSERT_EQ(removed, query(glm::vec3(10.0f, 0.0f, 0.0f), 2.5f));
+
+	ai::SelectInRadius filter("2.5");
+	const ai::AIPtr& ai = v[10];
+	filter.filter(ai);
+	ai::FilteredEntities selection = ai->getFilteredEntities();
+	std::sort(selection.begin(), selection.end());
+	const ai::FilteredEntities expectedSelection = {8, 11, 12, 50};
+	ASSERT_EQ(expectedSelection, selection) << "The entity itself must not be selected";
+}
+
+TEST_F(ZoneTest, testNearest) {
+	ai::Zone zone("test1");
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	ai::randomSeed(1);
+	const int n = 1000;
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < n; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(glm::vec3(ai::randomf(200.0f) - 100.0f, 0.0f, ai::randomf(200.0f) - 100.0f));
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+
+	// sorting the whole zone is the reference
+	auto expected = [&] (const glm::vec3& center, std::size_t k, float maxDistance) {
+		std::vector<std::pair<float, ai::CharacterId> > all;
+		for (const ai::AIPtr& ai : v) {
+			const float d = glm::distance2(ai->getCharacter()->getPosition(), center);
+			if (d <= maxDistance * maxDistance) {
+				all.emplace_back(d, ai->getId());
+			}
+		}
+		std::sort(all.begin(), all.end());
+		ai::Zone::CharacterIdList ids;
+		for (std::size_t i = 0; i < std::min(k, all.size()); ++i) {
+			ids.push_back(all[i].second);
+		}
+		return ids;
+	};
+	auto nearest = [&] (const glm::vec3& center, std::size_t k, float maxDistance) {
+		ai::Zone::CharacterIdList ids;
+		zone.queryNearest(center, k, maxDistance, ids);
+		return ids;
+	};
+	const glm::vec3 centers[] = {glm::vec3(0.0f), glm::vec3(95.0f, 0.0f, -95.0f), glm::vec3(1000.0f, 0.0f, 1000.0f)};
+	for (int grid = 0; grid < 2; ++grid) {
+		for (const glm::vec3& center : centers) {
+			ASSERT_EQ(expected(center, 5, 1000000.0f), nearest(center, 5, 1000000.0f)) << "grid: " << grid;
+			ASSERT_EQ(expected(center, 50, 20.0f), nearest(center, 50, 20.0f)) << "grid: " << grid;
+			ASSERT_EQ(expected(center, 0, 20.0f), nearest(center, 0, 20.0f)) << "grid: " << grid;
+		}
+		ASSERT_EQ((std::size_t)n, nearest(glm::vec3(0.0f), n + 10, 1000000.0f).size());
+		zone.setSpatialGrid(8.0f);
+	}
+
+	// the filter excludes the entity itself and keeps the distance order
+	ai::SelectNearest filter("3");
+	const ai::AIPtr& ai = v[0];
+	filter.filter(ai);
+	ai::Zone::CharacterIdList reference = expected(ai->getCharacter()->getPosition(), 4, 1000000.0f);
+	ASSERT_EQ(ai->getId(), reference.front());
+	reference.erase(reference.begin());
+	ASSERT_EQ(reference, ai->getFilteredEntities());
+}
+
+TEST_F(ZoneTest, testStimulus) {
+	const int noise = 1;
+	const int death = 2;
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	for (int grid = 0; grid < 2; ++grid) {
+		ai::Zone zone("test1", 2);
+		if (grid == 1) {
+			zone.setSpatialGrid(4.0f);
+		}
+		std::vector<ai::AIPtr> v;
+		for (int i = 0; i < 20; ++i) {
+			ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+			character->setPosition(glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+			ai::AIPtr ai = std::make_shared<ai::AI>(root);
+			ai->setCharacter(character);
+			v.push_back(ai);
+		}
+		ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+		zone.update(0l);
+		v[5]->sleep();
+		zone.update(10l);
+		ASSERT_TRUE(v[5]->isSleeping());
+
+		// emitted from several threads - delivered with the next update
+		std::thread t([&] () {
+			zone.emitStimulus(noise, glm::vec3(5.0f, 0.0f, 0.0f), 2.0f, 42);
+		});
+		t.join();
+		zone.emitStimulus(death, glm::vec3(15.0f, 0.0f, 0.0f), 0.5f);
+		ASSERT_FALSE(v[5]->getPerception().has());
+		zone.update(10l);
+
+		ai::HasStimulus hasNoise(std::to_string(noise));
+		ai::HasStimulus hasDeath(std::to_string(death));
+		for (int i = 0; i < 20; ++i) {
+			ASSERT_EQ(i >= 3 && i <= 7, hasNoise.evaluate(v[i])) << "Entity " << i << " grid: " << grid;
+			ASSERT_EQ(i == 15, hasDeath.evaluate(v[i])) << "Entity " << i << " grid: " << grid;
+		}
+		ASSERT_FALSE(v[5]->isSleeping()) << "A stimulus should wake up the entity";
+
+		ai::SelectStimulus filter(std::to_string(noise));
+		filter.filter(v[4]);
+		ASSERT_EQ(ai::FilteredEntities{42}, v[4]->getFilteredEntities());
+
+		// the stimulus is forgotten after the memory time
+		const int64_t memory = v[4]->getPerception().getMemoryMillis();
+		zone.update(memory);
+		ASSERT_TRUE(v[4]->getPerception().has(noise));
+		zone.update(1l);
+		ASSERT_FALSE(v[4]->getPerception().has(noise));
+	}
+}
+
+TEST_F(ZoneTest, testAABBTree) {
+	ai::randomSeed(2);
+	ai::AABBTree tree(1.0f);
+	std::unordered_map<ai::CharacterId, glm::vec3> positions;
+	auto randomPosition = [] () {
+		return glm::vec3(ai::randomf(1000.0f) - 500.0f, ai::randomf(10.0f), ai::randomf(1000.0f) - 500.0f);
+	};
+	for (int i = 0; i < 2000; ++i) {
+		const glm::vec3 p = randomPosition();
+		positions[i] = p;
+		ASSERT_TRUE(tree.update(i, p));
+	}
+	// small moves stay inside of the fat box
+	positions[0] += glm::vec3(0.5f, 0.0f, 0.0f);
+	ASSERT_FALSE(tree.update(0, positions[0]));
+	for (int i = 0; i < 500; ++i) {
+		positions[i] = randomPosition();
+		tree.update(i, positions[i]);
+	}
+	for (int i = 500; i < 1000; ++i) {
+		ASSERT_TRUE(tree.remove(i));
+		positions.erase(i);
+	}
+	ASSERT_FALSE(tree.remove(500));
+	ASSERT_EQ(positions.size(), tree.size());
+	ASSERT_LE(tree.getHeight(), 2 * 11) << "The tree is not balanced";
+
+	auto check = [&] () {
+		for (int q = 0; q < 20; ++q) {
+			const glm::vec3 center = randomPosition();
+			const float radius = ai::randomf(100.0f);
+			std::vector<ai::CharacterId> expected;
+			std::vector<std::pair<float, ai::CharacterId> > sorted;
+			for (const auto& e : positions) {
+				const float d = glm::distance2(e.second, center);
+				if (d <= radius * radius) {
+					expected.push_back(e.first);
+				}
+				sorted.emplace_back(d, e.first);
+			}
+			std::vector<ai::CharacterId> found;
+			tree.visit(center, radius, [&] (ai::CharacterId id, const glm::vec3&) {
+				found.push_back(id);
+			});
+			std::sort(expected.begin(), expected.end());
+			std::sort(found.begin(), found.end());
+			ASSERT_EQ(expected, found);
+
+			const glm::vec3 mins = center - glm::vec3(radius);
+			const glm::vec3 maxs = center + glm::vec3(radius);
+			expected.clear();
+			found.clear();
+			for (const auto& e : positions) {
+				if (glm::all(glm::greaterThanEqual(e.second, mins)) && glm::all(glm::lessThanEqual(e.second, maxs))) {
+					expected.push_back(e.first);
+				}
+			}
+			tree.visitBox(mins, maxs, [&] (ai::CharacterId id, const glm::vec3&) {
+				found.push_back(id);
+			});
+			std::sort(expected.begin(), expected.end());
+			std::sort(found.begin(), found.end());
+			ASSERT_EQ(expected, found);
+
+			std::sort(sorted.begin(), sorted.end());
+			expected.clear();
+			found.clear();
+			for (int i = 0; i < 5; ++i) {
+				expected.push_back(sorted[i].second);
+			}
+			tree.nearest(center, 5, 100000.0f, [] (ai::CharacterId) {return true;}, found);
+			ASSERT_EQ(expected, found);
+		}
+	};
+	check();
+
+	// the bulk build gives the same results
+	ai::AABBTree::Entries entries(positions.begin(), positions.end());
+	tree.build(entries);
+	ASSERT_EQ(positions.size(), tree.size());
+	ASSERT_LE(tree.getHeight(), 11);
+	check();
+}
+
+TEST_F(ZoneTest, testSpatialTree) {
+	ai::Zone zone("test1");
+	zone.setSpatialTree(1.0f);
+	ASSERT_TRUE(zone.hasSpatialTree());
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 100; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v)) << "Could not add ai to the zone";
+	zone.update(0l);
+
+	auto sorted = [] (ai::Zone::CharacterIdList ids) {
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	};
+	ai::Zone::CharacterIdList ids;
+	zone.queryRadius(glm::vec3(10.0f, 0.0f, 0.0f), 2.5f, ids);
+	ASSERT_EQ((ai::Zone::CharacterIdList{8, 9, 10, 11, 12}), sorted(ids));
+	ids.clear();
+	zone.queryBox(glm::vec3(19.5f, -1.0f, -1.0f), glm::vec3(22.0f, 1.0f, 1.0f), ids);
+	ASSERT_EQ((ai::Zone::CharacterIdList{20, 21, 22}), sorted(ids));
+
+	v[50]->getCharacter()->setPosition(glm::vec3(10.0f, 0.0f, 0.5f));
+	ASSERT_TRUE(zone.removeAI(v[9]));
+	zone.update(1l);
+	ids.clear();
+	zone.queryNearest(glm::vec3(10.0f, 0.0f, 0.0f), 3, 100.0f, ids);
+	ASSERT_EQ((ai::Zone::CharacterIdList{10, 50, 11}), ids);
+
+	// switching to the grid removes the tree
+	zone.setSpatialGrid(4.0f);
+	ASSERT_FALSE(zone.hasSpatialTree());
+	ids.clear();
+	zone.queryBox(glm::vec3(19.5f, -1.0f, -1.0f), glm::vec3(22.0f, 1.0f, 1.0f), ids);
+	ASSERT_EQ((ai::Zone::CharacterIdList{20, 21, 22}), sorted(ids));
+}
+
+TEST_F(ZoneTest, testInfluenceMap) {
+	ai::Zone zone("test1");
+	zone.setInfluenceMap(glm::vec3(-50.0f), glm::vec3(50.0f), 1.0f);
+	ASSERT_TRUE(zone.hasInfluenceMap());
+	ASSERT_TRUE(zone.addInfluenceLayer("allies", ai::Zone::groupInfluence(1), 0.5f, 4));
+	ASSERT_TRUE(zone.addInfluenceLayer("threat", ai::Zone::aggroInfluence(), 0.5f, 2));
+	ASSERT_FALSE(zone.addInfluenceLayer("threat", ai::Zone::aggroInfluence()));
+
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 4; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(i < 3 ? glm::vec3(10.5f, 0.0f, 10.5f) : glm::vec3(-9.5f, 0.0f, -9.5f));
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v));
+	zone.update(0l);
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_TRUE(zone.getGroupMgr().add(1, v[i]));
+	}
+	v[3]->getAggroMgr().addAggro(0, 2.0f);
+	zone.update(1l);
+
+	// the members are summed up and decay with every cell
+	ASSERT_FLOAT_EQ(3.0f, zone.getInfluence("allies", glm::vec3(10.5f, 0.0f, 10.5f)));
+	ASSERT_FLOAT_EQ(1.5f, zone.getInfluence("allies", glm::vec3(11.5f, 0.0f, 9.5f)));
+	ASSERT_FLOAT_EQ(0.375f, zone.getInfluence("allies", glm::vec3(13.5f, 0.0f, 10.5f)));
+	ASSERT_FLOAT_EQ(0.0f, zone.getInfluence("allies", glm::vec3(15.5f, 0.0f, 10.5f)));
+	ASSERT_FLOAT_EQ(2.0f, zone.getInfluence("threat", glm::vec3(-9.5f, 0.0f, -9.5f)));
+	ASSERT_FLOAT_EQ(0.0f, zone.getInfluence("threat", glm::vec3(-12.5f, 0.0f, -9.5f)));
+	ASSERT_FLOAT_EQ(0.0f, zone.getInfluence("unknown", glm::vec3(10.5f, 0.0f, 10.5f)));
+
+	// the gradient points to the members
+	const glm::vec3 gradient = zone.getInfluenceGradient("allies", glm::vec3(12.5f, 0.0f, 10.5f));
+	ASSERT_LT(gradient.x, 0.0f);
+	ASSERT_FLOAT_EQ(0.0f, gradient.z);
+
+	const ai::AIPtr& ai = v[0];
+	ai->getCharacter()->setPosition(glm::vec3(12.5f, 0.0f, 10.5f));
+	const ai::MoveVector seek = ai::movement::InfluenceSeek("allies").execute(ai, 1.0f);
+	ASSERT_FLOAT_EQ(-1.0f, seek.getVector().x);
+	const ai::MoveVector flee = ai::movement::InfluenceFlee("allies").execute(ai, 1.0f);
+	ASSERT_FLOAT_EQ(1.0f, flee.getVector().x);
+	ASSERT_TRUE(ai::isInfinite(ai::movement::InfluenceSeek("allies").execute(v[3], 1.0f).getVector()));
+
+	ASSERT_TRUE(ai::HasInfluence("threat,1.5").evaluate(v[3]));
+	ASSERT_FALSE(ai::HasInfluence("threat,2").evaluate(v[3]));
+	ASSERT_FALSE(ai::HasInfluence("threat").evaluate(v[0]));
+
+	zone.setInfluenceMap(glm::vec3(0.0f), glm::vec3(0.0f), 0.0f);
+	ASSERT_FALSE(zone.hasInfluenceMap());
+	ASSERT_FLOAT_EQ(0.0f, zone.getInfluence("allies", glm::vec3(10.5f, 0.0f, 10.5f)));
+}
+
+TEST_F(ZoneTest, testWorldQuery) {
+	ai::Zone zone("test1");
+	const std::shared_ptr<ai::LocalWorldQuery> world = std::make_shared<ai::LocalWorldQuery>();
+	// a wall between the first and the second entity
+	world->addBox(glm::vec3(4.0f, -10.0f, -10.0f), glm::vec3(6.0f, 10.0f, 10.0f));
+	zone.setWorldQuery(world);
+
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const glm::vec3 positions[] = {glm::vec3(0.0f), glm::vec3(10.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 12.0f)};
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 3; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(positions[i]);
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v));
+	zone.update(1l);
+
+	const int owner = 0;
+	zone.submitWorldQuery(ai::WorldQuery{ai::WorldQueryType::Raycast, positions[0], positions[1], 0, &owner});
+	zone.submitWorldQuery(ai::WorldQuery{ai::WorldQueryType::Navigation, positions[0], positions[2], 0, &owner});
+	zone.submitWorldQuery(ai::WorldQuery{ai::WorldQueryType::Navigation, positions[2], positions[1], 2, &owner});
+	zone.update(1l);
+	ASSERT_EQ(1, world->getBatches()) << "The queries of one tick should be answered in one batch";
+	ASSERT_EQ(3, world->getQueries());
+	// delivered after the update - readable in the next one
+	ASSERT_EQ(nullptr, v[0]->getWorldResults().get(&owner));
+	zone.update(1l);
+	ASSERT_EQ(2u, v[0]->getWorldResults().getResults().size());
+	const ai::WorldQueryResult& raycast = v[0]->getWorldResults().getResults()[0];
+	ASSERT_TRUE(raycast.success) << "The wall should block the ray";
+	ASSERT_FLOAT_EQ(4.0f, raycast.point.x);
+	ASSERT_FLOAT_EQ(4.0f, raycast.distance);
+	const ai::WorldQueryResult* navigation = v[0]->getWorldResults().get(&owner);
+	ASSERT_NE(nullptr, navigation);
+	ASSERT_TRUE(navigation->success);
+	ASSERT_FLOAT_EQ(12.0f, navigation->distance);
+	ASSERT_FALSE(v[2]->getWorldResults().get(&owner)->success) << "The wall should be in the way";
+	zone.update(1l);
+	ASSERT_EQ(nullptr, v[0]->getWorldResults().get(&owner)) << "Results should only be readable for one update";
+	ASSERT_EQ(1, world->getBatches());
+
+	// the nearest entity of the first one is behind the wall, the third one sees the first one
+	ai::ConditionParser parser(_registry, "And(Filter(SelectNearest{1}),HasLineOfSight)");
+	const ai::ConditionPtr& condition = parser.getCondition();
+	ASSERT_NE(nullptr, condition.get()) << parser.getError();
+	ASSERT_FALSE(condition->evaluate(v[0]));
+	ASSERT_FALSE(condition->evaluate(v[2])) << "The result should lag one update behind";
+	zone.update(1l);
+	zone.update(1l);
+	ASSERT_FALSE(condition->evaluate(v[0]));
+	ASSERT_TRUE(condition->evaluate(v[2]));
+
+}
+
+TEST_F(ZoneTest, testWorldQueryWithoutWorld) {
+	ai::Zone zone("test1");
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	const glm::vec3 positions[] = {glm::vec3(0.0f), glm::vec3(10.0f, 0.0f, 0.0f)};
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 2; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(positions[i]);
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v));
+	zone.update(1l);
+
+	// without a world all the queries fail - the ray is blocked and the target can't be reached
+	const int raycastOwner = 0;
+	const int navigationOwner = 0;
+	zone.submitWorldQuery(ai::WorldQuery{ai::WorldQueryType::Raycast, positions[0], positions[1], 0, &raycastOwner});
+	zone.submitWorldQuery(ai::WorldQuery{ai::WorldQueryType::Navigation, positions[0], positions[1], 0, &navigationOwner});
+	zone.update(1l);
+	zone.update(1l);
+	const ai::WorldQueryResult* raycast = v[0]->getWorldResults().get(&raycastOwner);
+	ASSERT_NE(nullptr, raycast);
+	ASSERT_TRUE(raycast->success) << "An unanswered ray should be blocked";
+	ASSERT_EQ(positions[0], raycast->point);
+	const ai::WorldQueryResult* navigation = v[0]->getWorldResults().get(&navigationOwner);
+	ASSERT_NE(nullptr, navigation);
+	ASSERT_FALSE(navigation->success);
+
+	// and there is never a line of sight
+	ai::ConditionParser parser(_registry, "And(Filter(SelectNearest{1}),HasLineOfSight)");
+	const ai::ConditionPtr& condition = parser.getCondition();
+	ASSERT_NE(nullptr, condition.get()) << parser.getError();
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_FALSE(condition->evaluate(v[0])) << "No line of sight in update " << i;
+		zone.update(1l);
+	}
+}
+
+TEST_F(ZoneTest, testPathfinding) {
+	ai::Zone zone("test1");
+	const std::shared_ptr<ai::NavigationGrid> grid = std::make_shared<ai::NavigationGrid>(glm::vec3(0.0f), glm::vec3(20.0f, 0.0f, 20.0f), 1.0f);
+	// a wall with a gap at the upper end
+	grid->setBlocked(glm::vec3(9.0f, 0.0f, 0.0f), glm::vec3(9.5f, 0.0f, 14.5f), true);
+	const std::shared_ptr<ai::Pathfinder> pathfinder = std::make_shared<ai::Pathfinder>(grid, zone.getThreadPool());
+	zone.setPathfinder(pathfinder);
+
+	const glm::vec3 start(2.5f, 0.0f, 2.5f);
+	const glm::vec3 goal(17.5f, 0.0f, 2.5f);
+	const ai::Path& path = pathfinder->findPathNow(start, goal);
+	ASSERT_TRUE(path.isValid());
+	ASSERT_EQ(goal, path[path.size() - 1u]);
+	for (std::size_t i = 0u; i < path.size(); ++i) {
+		ASSERT_FALSE(grid->isBlocked(grid->getCell(path[i]))) << "Waypoint " << i << " is blocked";
+		if (path[i].x > 9.0f && path[i].x < 10.0f) {
+			ASSERT_GE(path[i].z, 15.0f) << "The path should pass the wall through the gap";
+		}
+	}
+	ASSERT_FALSE(pathfinder->findPathNow(start, glm::vec3(9.5f, 0.0f, 2.5f)).isValid()) << "The goal is blocked";
+	ASSERT_FALSE(pathfinder->findPathNow(start, glm::vec3(-1.0f)).isValid()) << "The goal is outside of the grid";
+
+	// the same request and every request from a cell on the found way are answered by the cache
+	const ai::Path first = pathfinder->findPath(start, goal).get();
+	const int searches = pathfinder->getSearches();
+	ASSERT_EQ(first.size(), pathfinder->findPath(start, goal).get().size());
+	const ai::Path suffix = pathfinder->findPath(first[3], goal).get();
+	ASSERT_EQ(first.size() - 4u, suffix.size());
+	ASSERT_EQ(first[4], suffix[0]);
+	ASSERT_EQ(searches, pathfinder->getSearches());
+	ASSERT_EQ(2, pathfinder->getCacheHits());
+
+	// changing the grid invalidates the cached paths
+	grid->setBlocked(glm::vec3(9.0f, 0.0f, 15.0f), glm::vec3(9.5f, 0.0f, 15.5f), true);
+	const ai::Path changed = pathfinder->findPath(start, goal).get();
+	ASSERT_EQ(searches + 1, pathfinder->getSearches());
+	ASSERT_TRUE(changed.isValid());
+	ASSERT_GT(changed.size(), first.size()) << "The way around the longer wall should be longer";
+
+	// a crowd walking to the goal
+	const ai::TreeNodePtr moveTo = std::make_shared<ai::MoveTo>("moveto", "17.5:0:2.5", ai::True::get());
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 4; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(start + glm::vec3(0.0f, 0.0f, static_cast<float>(i)));
+		character->setSpeed(20.0f);
+		ai::AIPtr ai = std::make_shared<ai::AI>(moveTo);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v));
+	for (int i = 0; i < 200; ++i) {
+		zone.update(100l);
+	}
+	for (const ai::AIPtr& ai : v) {
+		const glm::vec3& position = ai->getCharacter()->getPosition();
+		ASSERT_NEAR(goal.x, position.x, 0.5f);
+		ASSERT_NEAR(goal.z, position.z, 0.5f);
+		ASSERT_FALSE(grid->isBlocked(grid->getCell(position)));
+		ASSERT_FALSE(ai->getPathFollower().isActive()) << "The path should be done";
+	}
+
+	// following the path in a steering
+	const ai::AIPtr& ai = v.front();
+	ai->getCharacter()->setPosition(start);
+	ai->getPathFollower().setPath(changed, goal);
+	const ai::SteeringPtr& follow = std::make_shared<ai::movement::FollowPath>("");
+	const ai::MoveVector& mv = follow->execute(ai, 10.0f);
+	ASSERT_FLOAT_EQ(10.0f, glm::length(mv.getVector()));
+	ASSERT_GT(glm::dot(glm::normalize(changed[0] - start), mv.getVector()), 0.0f);
+	ai->getPathFollower().clear();
+	ASSERT_TRUE(ai::isInfinite(follow->execute(ai, 10.0f).getVector()));
+}
+
+TEST_F(ZoneTest, testPathfinderCache) {
+	const std::shared_ptr<ai::NavigationGrid> grid = std::make_shared<ai::NavigationGrid>(glm::vec3(0.0f), glm::vec3(20.0f, 0.0f, 20.0f), 1.0f);
+	// without workers the searches run right away
+	ai::ThreadPool threadPool(0);
+	ai::Pathfinder pathfinder(grid, threadPool, 3u);
+	// paths with just one waypoint - every request only adds its own cache entry
+	auto request = [&] (int i) {
+		const float z = 0.5f + 2.0f * static_cast<float>(i);
+		return pathfinder.findPath(glm::vec3(0.5f, 0.0f, z), glm::vec3(1.5f, 0.0f, z)).get();
+	};
+	for (int i = 0; i < 3; ++i) {
+		ASSERT_EQ(1u, request(i).size());
+	}
+	ASSERT_EQ(3, pathfinder.getSearches());
+	ASSERT_EQ(1u, request(0).size());
+	ASSERT_EQ(1, pathfinder.getCacheHits());
+
+	// the full cache drops the least recently used entry
+	ASSERT_EQ(1u, request(3).size());
+	ASSERT_EQ(4, pathfinder.getSearches());
+	request(0);
+	request(2);
+	request(3);
+	ASSERT_EQ(4, pathfinder.getSearches());
+	ASSERT_EQ(4, pathfinder.getCacheHits());
+	request(1);
+	ASSERT_EQ(5, pathfinder.getSearches()) << "The second path should have been dropped";
+
+	// a long way only keeps the entries that were used last
+	const ai::Path way = pathfinder.findPath(glm::vec3(0.5f, 0.0f, 10.5f), glm::vec3(10.5f, 0.0f, 10.5f)).get();
+	ASSERT_EQ(10u, way.size());
+	ASSERT_EQ(6, pathfinder.getSearches());
+	ASSERT_EQ(way.size(), pathfinder.findPath(glm::vec3(0.5f, 0.0f, 10.5f), glm::vec3(10.5f, 0.0f, 10.5f)).get().size());
+	const ai::Path suffix = pathfinder.findPath(way[7], glm::vec3(10.5f, 0.0f, 10.5f)).get();
+	ASSERT_EQ(2u, suffix.size());
+	ASSERT_EQ(&way[8], &suffix[0]) << "The waypoints should be shared";
+	ASSERT_EQ(6, pathfinder.getSearches());
+	request(0);
+	ASSERT_EQ(7, pathfinder.getSearches());
+}
+
+TEST_F(ZoneTest, testFlowField) {
+	ai::Zone zone("test1");
+	const std::shared_ptr<ai::NavigationGrid> grid = std::make_shared<ai::NavigationGrid>(glm::vec3(0.0f), glm::vec3(20.0f, 0.0f, 20.0f), 1.0f);
+	// a wall with a gap at the upper end
+	grid->setBlocked(glm::vec3(9.0f, 0.0f, 0.0f), glm::vec3(9.5f, 0.0f, 14.5f), true);
+	// a small budget - the field is built over several updates
+	const std::shared_ptr<ai::FlowFields> flowFields = std::make_shared<ai::FlowFields>(grid, 100, 10u);
+	zone.setFlowFields(flowFields);
+
+	const glm::vec3 goal(17.5f, 0.0f, 2.5f);
+	glm::vec3 direction;
+	ASSERT_FALSE(flowFields->getDirection(goal, glm::vec3(2.5f, 0.0f, 2.5f), direction)) << "The field should only be requested";
+	int updates = 0;
+	while (!flowFields->getDirection(goal, glm::vec3(2.5f, 0.0f, 2.5f), direction)) {
+		ASSERT_LT(updates, 10) << "The field wasn't built";
+		zone.update(1l);
+		++updates;
+	}
+	ASSERT_EQ(4, updates) << "The 385 free cells should be settled in four updates";
+	ASSERT_EQ(1, flowFields->getFields());
+	ASSERT_FLOAT_EQ(15.0f, flowFields->getCost(goal, glm::vec3(17.5f, 0.0f, 17.5f)));
+	ASSERT_FLOAT_EQ(ai::FLOWFIELD_UNREACHABLE, flowFields->getCost(goal, glm::vec3(9.5f, 0.0f, 2.5f)));
+	ASSERT_GT(direction.z, 0.0f) << "The way leads through the gap";
+
+	// a crowd follows the field through the gap
+	const ai::SteeringPtr& seek = std::make_shared<ai::movement::FlowFieldSeek>("17.5:0:2.5");
+	ai::TreeNodePtr root = std::make_shared<ai::PrioritySelector>("test", "", ai::True::get());
+	std::vector<ai::AIPtr> v;
+	for (int i = 0; i < 100; ++i) {
+		ai::ICharacterPtr character = std::make_shared<TestEntity>(i);
+		character->setPosition(glm::vec3(0.5f + static_cast<float>(i % 9), 0.0f, 0.5f + static_cast<float>(i / 9)));
+		ai::AIPtr ai = std::make_shared<ai::AI>(root);
+		ai->setCharacter(character);
+		v.push_back(ai);
+	}
+	ASSERT_TRUE(zone.addAIs(v));
+	zone.update(1l);
+	for (const ai::AIPtr& ai : v) {
+		const ai::ICharacterPtr& character = ai->getCharacter();
+		int steps = 0;
+		while (glm::distance(character->getPosition(), goal) > 0.5f) {
+			ASSERT_LT(steps, 400) << "Entity " << ai->getId() << " didn't reach the goal";
+			const ai::MoveVector& mv = seek->execute(ai, 1.0f);
+			ASSERT_FALSE(ai::isInfinite(mv.getVector())) << "Entity " << ai->getId() << " has no way at " << ::testing::PrintToString(character->getPosition());
+			character->setPosition(character->getPosition() + mv.getVector() * 0.25f);
+			ASSERT_FALSE(grid->isBlocked(grid->getCell(character->getPosition())));
+			++steps;
+		}
+	}
+	ASSERT_EQ(1, flowFields->getFields()) << "The crowd should share one field";
+
+	// closing the gap - the old field is sampled until the new one is built
+	grid->setBlocked(glm::vec3(9.0f, 0.0f, 0.0f), glm::vec3(9.5f, 0.0f, 20.0f), true);
+	ASSERT_TRUE(flowFields->getDirection(goal, glm::vec3(2.5f, 0.0f, 2.5f), direction));
+	for (int i = 0; i < 5; ++i) {
+		zone.update(1l);
+	}
+	ASSERT_FALSE(flowFields->getDirection(goal, glm::vec3(2.5f, 0.0f, 2.5f), direction)) << "There is no way anymore";
+	ASSERT_TRUE(flowFields->getDirection(goal, glm::vec3(12.5f, 0.0f, 12.5f), direction));
+
+	// fields that aren't sampled are dropped
+	for (int i = 0; i < 12; ++i) {
+		zone.update(1l);
+	}
+	ASSERT_EQ(0, flowFields->getFields());
+}
@@ -78,6 +78,16 @@ function luatest:execute(ai, deltaMillis)
 		print("error: could not get ai from zone with id " .. chr:id())
 		return FAILED
 	end
+	local inRadius = zone:inRadius(chr:position(), 1.0)
+	if inRadius[1] ~= chr:id() then
+		print("error: could not find ai with id " .. chr:id() .. " in the radius of its own position")
+		return FAILED
+	end
+	local influence = zone:influence("unknown", chr:position())
+	if influence ~= 0.0 then
+		print("error: expected no influence for an unknown layer - but found " .. influence)
+		return FAILED
+	end
 	local aggroMgr = ai:aggroMgr()
 	aggroMgr:addAggro(3, 0.3)
 	aggroMgr:addAggro(4, 0.4)